@@ -0,0 +1,65 @@
+#include "banded.h"
+#include "profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+bool render_banded(const HeadGeometry& head, const TGAImage& tex, const CubeOverlay& cube,
+                   int width, int height, int bandHeight, const std::string& filename,
+                   BandStats* stats) {
+    auto t0 = std::chrono::steady_clock::now();
+    bandHeight = std::clamp(bandHeight, 1, height);
+    const int nbands = (height + bandHeight - 1) / bandHeight;
+
+    // диапазон полос треугольника, та же обрезка, что у bbox в растеризаторе
+    auto band_range = [&](int i, int& b0, int& b1) {
+        const Vec3f* p = &head.pts[i*3];
+        float ymin = std::min({p[0].y, p[1].y, p[2].y});
+        float ymax = std::max({p[0].y, p[1].y, p[2].y});
+        float xmin = std::min({p[0].x, p[1].x, p[2].x});
+        float xmax = std::max({p[0].x, p[1].x, p[2].x});
+        if (ymax < 0.f || xmax < 0.f || ymin > (float)(height-1) || xmin > (float)(width-1)) return false;
+        b0 = std::clamp((int)ymin, 0, height-1) / bandHeight;
+        b1 = std::clamp((int)ymax, 0, height-1) / bandHeight;
+        return true;
+    };
+
+    // раскладка по полосам в два прохода: счётчики, затем плоский массив
+    std::vector<int> binStart(nbands + 1, 0);
+    for (int i=0; i<head.nfaces(); i++) {
+        int b0, b1;
+        if (!band_range(i, b0, b1)) continue;
+        for (int b=b0; b<=b1; b++) binStart[b+1]++;
+    }
+    for (int b=0; b<nbands; b++) binStart[b+1] += binStart[b];
+
+    std::vector<int> binFaces(binStart[nbands]);
+    std::vector<int> fill(binStart.begin(), binStart.end() - 1);
+    for (int i=0; i<head.nfaces(); i++) {
+        int b0, b1;
+        if (!band_range(i, b0, b1)) continue;
+        for (int b=b0; b<=b1; b++) binFaces[fill[b]++] = i;
+    }
+
+    TGAStreamWriter writer;
+    if (!writer.open(filename, width, height, TGAImage::RGB)) return false;
+
+    TGAImage band;
+    std::vector<float> zbuf((size_t)width*bandHeight);
+    for (int b=0; b<nbands; b++) {
+        CG3_ZONE("band");
+        const int y0 = b*bandHeight;
+        render_region(head, tex, cube, Region{0, y0, width, bandHeight}, band, zbuf.data(),
+                      binFaces.data() + binStart[b], binStart[b+1] - binStart[b]);
+
+        if (!writer.write_rows(band, std::min(bandHeight, height - y0))) return false;
+    }
+
+    if (stats) {
+        stats->bands = nbands;
+        stats->bandBytes = (size_t)width*bandHeight*(TGAImage::RGB + sizeof(float));
+        stats->binBytes = (binStart.size() + binFaces.size()) * sizeof(int);
+        stats->ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    }
+    return writer.close();
+}
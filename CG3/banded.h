@@ -0,0 +1,21 @@
+#pragma once
+#include <string>
+#include <cstddef>
+#include "tgaimage.h"
+#include "scene.h"
+
+// Рендер полосами: треугольники раскладываются по горизонтальным полосам один раз,
+// затем каждая полоса рисуется в свой небольшой буфер цвета и глубины
+// и сразу дописывается в файл. Память растёт с высотой полосы, а не кадра.
+
+struct BandStats {
+    int    bands     = 0;
+    size_t bandBytes = 0;   // цвет + глубина одной полосы
+    size_t binBytes  = 0;   // списки треугольников по полосам
+    double ms        = 0;
+};
+
+// head и cube спроецированы в экран width x height
+bool render_banded(const HeadGeometry& head, const TGAImage& tex, const CubeOverlay& cube,
+                   int width, int height, int bandHeight, const std::string& filename,
+                   BandStats* stats = nullptr);
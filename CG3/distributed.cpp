@@ -0,0 +1,154 @@
+#include "distributed.h"
+#include "tgaimage.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+
+#ifdef _WIN32
+#define popen  _popen
+#define pclose _pclose
+#endif
+
+void print_region_time(double ms) {
+    std::printf("region_ms %f\n", ms);
+    std::fflush(stdout);
+}
+
+std::string shell_quote(const std::string& arg) {
+#ifdef _WIN32
+    // в путях Windows кавычек не бывает
+    return "\"" + arg + "\"";
+#else
+    std::string q = "'";
+    for (char c : arg) {
+        if (c == '\'') q += "'\\''";
+        else q += c;
+    }
+    return q + "'";
+#endif
+}
+
+// файлы регионов удаляются на любом выходе из run_coordinator, в том числе
+// когда воркер упал и сшивка прервалась
+namespace {
+struct RegionFiles {
+    std::vector<std::string> paths;
+    ~RegionFiles() { for (const auto& p : paths) std::remove(p.c_str()); }
+};
+} // namespace
+
+static std::vector<Region> even_regions(int n, int width, int height) {
+    std::vector<Region> r(n);
+    for (int k=0; k<n; k++) {
+        int y0 = height*k / n, y1 = height*(k+1) / n;
+        r[k] = Region{0, y0, width, y1 - y0};
+    }
+    return r;
+}
+
+std::vector<Region> balance_regions(const std::vector<Region>& prev, const std::vector<double>& ms,
+                                    int width, int height) {
+    const int n = (int)prev.size();
+    std::vector<double> rowCost(height, 0.0);
+    double total = 0;
+    for (int k=0; k<n; k++) {
+        if (prev[k].h <= 0) continue;
+        // пустые строки не бесплатны: запуск и запись региона
+        double c = std::max(ms[k], 1e-3) / prev[k].h;
+        for (int y=prev[k].y0; y<prev[k].y0 + prev[k].h; y++) rowCost[y] = c;
+        total += c * prev[k].h;
+    }
+
+    std::vector<Region> r(n);
+    int y = 0;
+    double acc = 0;
+    for (int k=0; k<n; k++) {
+        int y0 = y;
+        double target = total * (k+1) / n;
+        int rowsLeft = height - (n - k - 1);   // хотя бы строка на каждый следующий регион
+        if (k == n-1) y = height;
+        else {
+            while (y < rowsLeft && (y == y0 || acc + rowCost[y]*0.5 < target)) acc += rowCost[y++];
+        }
+        r[k] = Region{0, y0, width, y - y0};
+    }
+    return r;
+}
+
+static double run_worker(const DistributedOptions& opt, int k, const Region& r, const std::string& out) {
+    std::string cmd;
+    if (!opt.launcher.empty()) {
+        std::string l = opt.launcher;
+        size_t p = l.find("{k}");
+        if (p != std::string::npos) l.replace(p, 3, std::to_string(k));
+        cmd = l + " ";
+    }
+    cmd += shell_quote(opt.exe) + " " + opt.workerArgs +
+           " --region " + std::to_string(r.x0) + "," + std::to_string(r.y0) + "," +
+           std::to_string(r.w) + "," + std::to_string(r.h) + " --out " + shell_quote(out);
+
+#ifdef _WIN32
+    cmd = "\"" + cmd + "\"";   // cmd.exe снимает внешние кавычки
+#endif
+
+    FILE* p = popen(cmd.c_str(), "r");
+    if (!p) return -1.0;
+
+    double ms = -1.0;
+    char buf[256];
+    while (std::fgets(buf, sizeof(buf), p)) {
+        double v = 0;
+        if (std::sscanf(buf, "region_ms %lf", &v) == 1) ms = v;
+    }
+    return pclose(p) == 0 ? ms : -1.0;
+}
+
+bool run_coordinator(int width, int height, const DistributedOptions& opt, const std::string& output) {
+    const int n = std::clamp(opt.workers, 1, height);
+    std::vector<Region> regions = even_regions(n, width, height);
+    TGAImage frame;
+    RegionFiles files;
+    for (int k=0; k<n; k++) files.paths.push_back(opt.tmpPrefix + std::to_string(k) + ".tga");
+
+    for (int f=0; f<opt.frames; f++) {
+        auto t0 = std::chrono::steady_clock::now();
+
+        std::vector<double> ms(n, -1.0);
+        std::vector<std::thread> pool;
+        for (int k=0; k<n; k++) {
+            pool.emplace_back([&, k]() {
+                ms[k] = run_worker(opt, k, regions[k], files.paths[k]);
+            });
+        }
+        for (auto& th : pool) th.join();
+
+        // сшивка
+        frame = TGAImage(width, height, TGAImage::RGB);
+        for (int k=0; k<n; k++) {
+            TGAImage part;
+            if (ms[k] < 0 || !part.read_tga_file(files.paths[k])) {
+                std::cout << "worker " << k << " failed\n";
+                return false;
+            }
+            const Region& r = regions[k];
+            for (int y=0; y<std::min(r.h, part.get_height()); y++)
+                for (int x=0; x<std::min(r.w, part.get_width()); x++)
+                    frame.set(r.x0 + x, r.y0 + y, part.get(x, y));
+        }
+
+        double frameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        double maxMs = *std::max_element(ms.begin(), ms.end());
+        double sumMs = 0;
+        for (double m : ms) sumMs += m;
+        std::cout << "frame " << f << ": " << frameMs << " ms, regions";
+        for (int k=0; k<n; k++) std::cout << " [" << regions[k].y0 << "+" << regions[k].h << ": " << ms[k] << "]";
+        std::cout << ", imbalance " << (sumMs > 0 ? maxMs * n / sumMs : 1.0) << "\n";
+
+        regions = balance_regions(regions, ms, width, height);
+    }
+
+    frame.flip_vertically();
+    return frame.write_tga_file(output);
+}
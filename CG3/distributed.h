@@ -0,0 +1,32 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "scene.h"
+
+// Sort-first рендер в нескольких процессах: кадр режется на горизонтальные
+// регионы, каждый рендерит отдельный процесс-воркер (lab3 --region ...),
+// координатор сшивает результаты в один TGA. Границы регионов на следующем
+// кадре подбираются по времени регионов на предыдущем.
+
+struct DistributedOptions {
+    int workers = 4;
+    int frames  = 1;
+    std::string exe;          // путь к lab3 для воркеров
+    std::string workerArgs;   // общие аргументы (--size, --obj), пути - через shell_quote
+    // префикс команды запуска, {k} заменяется номером воркера (например "ssh node{k}").
+    // Для удалённых узлов файлы регионов должны лежать на общем диске.
+    std::string launcher;
+    std::string tmpPrefix = "region_";
+};
+
+// аргумент командной строки popen одним словом: пробелы и кавычки в путях
+std::string shell_quote(const std::string& arg);
+
+// время рендера региона воркер печатает строкой "region_ms <ms>"
+void print_region_time(double ms);
+
+// новые границы: стоимость строки = время региона / его высота
+std::vector<Region> balance_regions(const std::vector<Region>& prev, const std::vector<double>& ms,
+                                    int width, int height);
+
+bool run_coordinator(int width, int height, const DistributedOptions& opt, const std::string& output);
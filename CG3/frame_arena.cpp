@@ -0,0 +1,73 @@
+#include "frame_arena.h"
+#include <algorithm>
+
+FrameArena::FrameArena(size_t capacity) {
+    capacity = std::max<size_t>(capacity, 64);
+    blocks_.push_back({ std::make_unique_for_overwrite<std::byte[]>(capacity), capacity });
+    heapBlocks_ = 1;
+    enter(0);
+}
+
+void FrameArena::enter(size_t block) {
+    cur_ = block;
+    base_ = blocks_[block].data.get();
+    size_ = blocks_[block].size;
+    offset_ = 0;
+}
+
+void* FrameArena::allocate_slow(size_t bytes, size_t align) {
+    // после отката следующие блоки уже есть - сначала они
+    while (cur_ + 1 < blocks_.size()) {
+        enter(cur_ + 1);
+        const uintptr_t at = ((uintptr_t)base_ + align - 1) & ~(uintptr_t)(align - 1);
+        const size_t p = (size_t)(at - (uintptr_t)base_);
+        if (p + bytes <= size_) { offset_ = p + bytes; return base_ + p; }
+    }
+    // новый блок не меньше удвоенного последнего, чтобы переполнений за кадр было мало
+    const size_t size = std::max(blocks_.back().size * 2, bytes + align);
+    blocks_.push_back({ std::make_unique_for_overwrite<std::byte[]>(size), size });
+    heapBlocks_++;
+    enter(blocks_.size() - 1);
+    return allocate(bytes, align);
+}
+
+void FrameArena::reset() {
+    peak_ = std::max(peak_, used());
+    if (blocks_.size() > 1) {
+        // кадр не уместился: один блок на весь объём, следующий кадр обойдётся без кучи
+        const size_t total = capacity();
+        blocks_.clear();
+        blocks_.push_back({ std::make_unique_for_overwrite<std::byte[]>(total), total });
+        heapBlocks_++;
+    }
+    enter(0);
+}
+
+void FrameArena::rewind(const Mark& m) {
+    peak_ = std::max(peak_, used());
+    cur_ = m.block;
+    base_ = blocks_[cur_].data.get();
+    size_ = blocks_[cur_].size;
+    offset_ = m.offset;
+}
+
+size_t FrameArena::used() const {
+    size_t n = offset_;
+    for (size_t i=0; i<cur_; i++) n += blocks_[i].size;
+    return n;
+}
+
+size_t FrameArena::capacity() const {
+    size_t n = 0;
+    for (const Block& b : blocks_) n += b.size;
+    return n;
+}
+
+size_t FrameArena::peak() const {
+    return std::max(peak_, used());
+}
+
+FrameArena& FrameArena::local() {
+    thread_local FrameArena arena;
+    return arena;
+}
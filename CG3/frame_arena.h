@@ -0,0 +1,113 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+// Линейная память кадра: выделение - сдвиг указателя, по одному ничего не освобождается,
+// всё сразу сбрасывает reset() в начале кадра или откат к метке в конце области.
+// Не хватило блока - берётся ещё один из кучи, а на reset() блоки сливаются в один
+// общего размера, так что со следующего кадра глобальный аллокатор не вызывается.
+// Деструкторы не вызываются: только тривиально разрушаемые типы.
+class FrameArena {
+public:
+    explicit FrameArena(size_t capacity = 256 << 10);
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // align - степень двойки
+    void* allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+        const uintptr_t at = ((uintptr_t)(base_ + offset_) + align - 1) & ~(uintptr_t)(align - 1);
+        const size_t p = (size_t)(at - (uintptr_t)base_);
+        if (p + bytes <= size_) { offset_ = p + bytes; return base_ + p; }
+        return allocate_slow(bytes, align);
+    }
+
+    // n объектов, созданных конструктором по умолчанию
+    template <class T>
+    std::span<T> alloc(size_t n) {
+        static_assert(std::is_trivially_destructible_v<T>, "арена не вызывает деструкторы");
+        T* p = static_cast<T*>(allocate(n * sizeof(T), alignof(T)));
+        for (size_t i=0; i<n; i++) new (p + i) T();
+        return { p, n };
+    }
+
+    template <class T>
+    std::span<T> copy(std::span<const T> src) {
+        static_assert(std::is_trivially_copyable_v<T>, "копия арены побайтовая");
+        T* p = static_cast<T*>(allocate(src.size() * sizeof(T), alignof(T)));
+        if (!src.empty()) std::memcpy((void*)p, src.data(), src.size() * sizeof(T));
+        return { p, src.size() };
+    }
+
+    // начало кадра: всё выделенное раньше недействительно
+    void reset();
+
+    // откат к метке: временные данные одной функции внутри кадра
+    struct Mark { size_t block = 0, offset = 0; };
+    Mark mark() const { return { cur_, offset_ }; }
+    void rewind(const Mark& m);
+
+    size_t used() const;            // байт с последнего reset
+    size_t capacity() const;
+    size_t peak() const;            // максимум used за всё время
+    size_t heap_blocks() const { return heapBlocks_; }     // блоков, взятых из кучи
+
+    // арена текущего потока: у каждого рабочего потока своя, без синхронизации
+    static FrameArena& local();
+
+private:
+    void* allocate_slow(size_t bytes, size_t align);
+    void enter(size_t block);
+
+    struct Block {
+        std::unique_ptr<std::byte[]> data;
+        size_t size = 0;
+    };
+    std::vector<Block> blocks_;
+    size_t cur_ = 0;
+    std::byte* base_ = nullptr;     // blocks_[cur_]
+    size_t size_ = 0;
+    size_t offset_ = 0;
+    size_t peak_ = 0;
+    size_t heapBlocks_ = 0;
+};
+
+// откат арены при выходе из области: временные буферы функции и рабочих потоков
+class ArenaScope {
+public:
+    explicit ArenaScope(FrameArena& arena = FrameArena::local()) : arena_(arena), mark_(arena.mark()) {}
+    ~ArenaScope() { arena_.rewind(mark_); }
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+    FrameArena& arena() const { return arena_; }
+
+private:
+    FrameArena& arena_;
+    FrameArena::Mark mark_;
+};
+
+// аллокатор STL поверх арены: растущие за кадр списки (корзины, тайлы) без кучи.
+// deallocate ничего не делает - память вернётся на reset или откате
+template <class T>
+struct ArenaAllocator {
+    using value_type = T;
+
+    FrameArena* arena;
+
+    explicit ArenaAllocator(FrameArena& a = FrameArena::local()) : arena(&a) {}
+    template <class U> ArenaAllocator(const ArenaAllocator<U>& o) : arena(o.arena) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T*, size_t) {}
+
+    template <class U> bool operator==(const ArenaAllocator<U>& o) const { return arena == o.arena; }
+};
+
+template <class T>
+using FrameVector = std::vector<T, ArenaAllocator<T>>;
@@ -0,0 +1,42 @@
+#include "layers.h"
+#include <limits>
+
+LayerKey LayerKey::make(const Model& m, const TGAImage& tex, const Camera& cam,
+                        int width, int height, uint64_t revision) {
+    LayerKey k;
+    k.model = &m;
+    k.texture = &tex;
+    k.revision = revision;
+    k.eye = cam.eye; k.target = cam.target; k.up = cam.up;
+    k.fov_deg = cam.fov_deg; k.aspect = cam.aspect; k.znear = cam.znear; k.zfar = cam.zfar;
+    k.width = width; k.height = height;
+    return k;
+}
+
+static bool same(const Vec3f& a, const Vec3f& b) { return a.x==b.x && a.y==b.y && a.z==b.z; }
+
+bool LayerKey::operator==(const LayerKey& o) const {
+    return model == o.model && texture == o.texture && revision == o.revision &&
+           same(eye, o.eye) && same(target, o.target) && same(up, o.up) &&
+           fov_deg == o.fov_deg && aspect == o.aspect && znear == o.znear && zfar == o.zfar &&
+           width == o.width && height == o.height;
+}
+
+bool StaticLayer::update(const LayerKey& key, const RenderFn& render) {
+    if (valid_ && key == key_) return false;
+
+    const float clear = -std::numeric_limits<float>::max();
+    const size_t n = (size_t)key.width*key.height;
+
+    color_ = TGAImage(key.width, key.height, TGAImage::RGB);
+    depth_.assign(n, clear);
+    render(color_, depth_.data());
+
+    under_.resize(n);
+    for (size_t i=0; i<n; i++)
+        under_[i] = depth_[i] == clear ? clear : std::numeric_limits<float>::max();
+
+    key_ = key;
+    valid_ = true;
+    return true;
+}
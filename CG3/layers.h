@@ -0,0 +1,53 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include "geometry.h"
+#include "tgaimage.h"
+#include "model.h"
+
+// Кэш статического слоя: цвет и глубина головы пересчитываются только
+// при смене модели, текстуры или камеры. Динамические слои (куб, рёбра)
+// каждый кадр накладываются на копию закэшированного цвета.
+
+// всё, от чего зависит картинка статического слоя
+struct LayerKey {
+    const Model*    model   = nullptr;
+    const TGAImage* texture = nullptr;
+    uint64_t revision = 0;     // увеличивать при правке модели/текстуры на месте
+    Vec3f eye, target, up;
+    float fov_deg = 0, aspect = 0, znear = 0, zfar = 0;
+    int width = 0, height = 0;
+
+    static LayerKey make(const Model& m, const TGAImage& tex, const Camera& cam,
+                         int width, int height, uint64_t revision = 0);
+
+    bool operator==(const LayerKey& o) const;
+    bool operator!=(const LayerKey& o) const { return !(*this == o); }
+};
+
+class StaticLayer {
+public:
+    using RenderFn = std::function<void(TGAImage& color, float* depth)>;
+
+    // перерисовывает слой, если ключ изменился; true - был промах кэша
+    bool update(const LayerKey& key, const RenderFn& render);
+    void invalidate() { valid_ = false; }
+
+    const TGAImage& color() const { return color_; }
+    // глубина слоя для z-теста слоёв поверх него
+    const float* depth() const { return depth_.data(); }
+    // глубина для слоёв под ним: закрытые пиксели +max, пустые -max
+    const float* under() const { return under_.data(); }
+
+    // начало кадра: копия закэшированного цвета.
+    // Глубину динамические слои только читают, поэтому она не копируется.
+    void compose(TGAImage& frame) const { frame = color_; }
+
+private:
+    bool valid_ = false;
+    LayerKey key_;
+    TGAImage color_;
+    std::vector<float> depth_;
+    std::vector<float> under_;
+};
@@ -3,200 +3,133 @@
 #include <limits>
 #include <algorithm>
 #include <cmath>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
 
 #include "tgaimage.h"
 #include "model.h"
+#include "mesh_index.h"
+#include "../shared/mesh_lod.h"
+#include "../shared/frame_stats.h"
 #include "geometry.h"
 #include "openfile.h"
+#include "shading_rate.h"
+#include "render.h"
+#include "scene.h"
+#include "layers.h"
+#include "multiview.h"
+#include "banded.h"
+#include "stream_model.h"
+#include "distributed.h"
+#include "sortlast.h"
+#include "profiler.h"
+#include "frame_arena.h"
+
+// параметры командной строки
+struct Options {
+    int  width  = 800;
+    int  height = 800;
+    int  bands  = 0;         // >0 - рендер полосами этой высоты прямо в файл
+    int  streamMB = 0;       // >0 - потоковый рендер OBJ с бюджетом памяти в МБ
+    std::string obj = "resources/african_head.obj";
+    std::string out = "output.tga";
+    bool hasRegion = false;  // воркер: рендер только региона кадра
+    Region region;
+    int  distributed = 0;    // >0 - координатор с таким числом воркеров
+    std::string launcher;
+    int  sortLast = 0;       // >0 - sort-last рендер головы этим числом потоков
+    int  vrs = 0;            // 0 - выкл, 1/2/4 - фиксированная скорость, -1 - авто
+    bool vrsReport = false;  // сравнить с полной скоростью: время и ошибка
+    VrsParams vrsParams;
+    int  frames = 1;         // >1 - анимация куба поверх закэшированной головы
+    std::string stats;       // файл статистики кадров: .json или .csv
+    std::string trace;       // трасса профайлера (сборка с -DCG3_PROFILE)
+    int  views = 0;          // >0 - рендер головы с нескольких камер за один проход
+    int  lod = 0;            // 0 - полный меш, N - уровень N, -1 - авто по размеру на экране
+    float lodError = 1.f;    // допустимая ошибка LOD на экране, пикселей
+};
 
-const int width  = 800;
-const int height = 800;
-
-TGAColor blend_over(const TGAColor& dst, const TGAColor& src, float a) {
-    int r = (int)(dst.bgra[2]*(1.f-a) + src.bgra[2]*a);
-    int g = (int)(dst.bgra[1]*(1.f-a) + src.bgra[1]*a);
-    int b = (int)(dst.bgra[0]*(1.f-a) + src.bgra[0]*a);
-    r = std::clamp(r,0,255); g = std::clamp(g,0,255); b = std::clamp(b,0,255);
-    return TGAColor((uint8_t)r,(uint8_t)g,(uint8_t)b,255);
-}
-
-// проекция вершины 
-Vec3f project_to_screen(const Vec3f& v_world, const Mat4& V, const Mat4& P) {
-    Vec4f vw(v_world.x, v_world.y, v_world.z, 1.f);
-
-    Vec4f vview4 = V * vw;               
-    float depth = -vview4.z;             
-
-    Vec4f vclip = P * vview4;            
-    if (std::abs(vclip.w) < 1e-8f) vclip.w = 1.f;
-
-    float ndc_x = vclip.x / vclip.w;
-    float ndc_y = vclip.y / vclip.w;
-
-    float sx = (ndc_x + 1.f) * width  * 0.5f;
-    float sy = (ndc_y + 1.f) * height * 0.5f;
-
-    return Vec3f(sx, sy, depth);
-}
-
-// треугольник головы
-void triangle_textured(Vec3f* pts, Vec2f* uv, TGAImage& img, TGAImage& tex, float* zbuf) {
-    Vec2i bmin(width-1, height-1), bmax(0,0);
-    for(int i=0;i<3;i++){
-        bmin.x = std::max(0, std::min(bmin.x, (int)pts[i].x));
-        bmin.y = std::max(0, std::min(bmin.y, (int)pts[i].y));
-        bmax.x = std::min(width-1, std::max(bmax.x, (int)pts[i].x));
-        bmax.y = std::min(height-1, std::max(bmax.y, (int)pts[i].y));
-    }
-
-    for(int x=bmin.x; x<=bmax.x; x++){
-        for(int y=bmin.y; y<=bmax.y; y++){
-            Vec3f bc = barycentric(pts, Vec3f((float)x,(float)y,0));
-            if(bc.x<0 || bc.y<0 || bc.z<0) continue;
-
-            float z = pts[0].z*bc.x + pts[1].z*bc.y + pts[2].z*bc.z;
-            int idx = x + y*width;
-
-            if (z > zbuf[idx]) {
-                zbuf[idx] = z;
-
-                Vec2f uvp(
-                    uv[0].x*bc.x + uv[1].x*bc.y + uv[2].x*bc.z,
-                    uv[0].y*bc.x + uv[1].y*bc.y + uv[2].y*bc.z
-                );
-
-                int tx = (int)(uvp.x * (tex.get_width()-1));
-                int ty = (int)((1.f-uvp.y) * (tex.get_height()-1));
-                img.set(x,y, tex.get(tx,ty));
-            }
+static Options parse_options(int argc, char** argv) {
+    Options o;
+    for (int i=1; i<argc; i++) {
+        std::string a = argv[i];
+        bool hasNext = i+1 < argc;
+        if (a == "--size" && hasNext) {
+            int w = 0, h = 0;
+            if (std::sscanf(argv[++i], "%dx%d", &w, &h) == 2 && w > 0 && h > 0) { o.width = w; o.height = h; }
         }
-    }
-}
-
-
-void triangle_alpha_ztest(Vec3f* pts, TGAImage& img, const TGAColor& col, float alpha, const float* zbuf) {
-    Vec2i bmin(width-1, height-1), bmax(0,0);
-    for(int i=0;i<3;i++){
-        bmin.x = std::max(0, std::min(bmin.x, (int)pts[i].x));
-        bmin.y = std::max(0, std::min(bmin.y, (int)pts[i].y));
-        bmax.x = std::min(width-1, std::max(bmax.x, (int)pts[i].x));
-        bmax.y = std::min(height-1, std::max(bmax.y, (int)pts[i].y));
-    }
-
-    for(int x=bmin.x; x<=bmax.x; x++){
-        for(int y=bmin.y; y<=bmax.y; y++){
-            Vec3f bc = barycentric(pts, Vec3f((float)x,(float)y,0));
-            if(bc.x<0 || bc.y<0 || bc.z<0) continue;
-
-            float z = pts[0].z*bc.x + pts[1].z*bc.y + pts[2].z*bc.z;
-            int idx = x + y*width;
-
-            
-            if (z > zbuf[idx]) {
-                TGAColor dst = img.get(x,y);
-                img.set(x,y, blend_over(dst, col, alpha));
-            }
+        else if (a == "--bands" && hasNext)       o.bands = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--obj" && hasNext)         o.obj = argv[++i];
+        else if (a == "--out" && hasNext)         o.out = argv[++i];
+        else if (a == "--region" && hasNext) {
+            Region& r = o.region;
+            o.hasRegion = std::sscanf(argv[++i], "%d,%d,%d,%d", &r.x0, &r.y0, &r.w, &r.h) == 4 && r.w > 0 && r.h > 0;
+        }
+        else if (a == "--distributed" && hasNext) o.distributed = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--launcher" && hasNext)    o.launcher = argv[++i];
+        else if (a == "--sortlast" && hasNext)    o.sortLast = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--stream" && hasNext)      o.streamMB = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--vrs" && hasNext) {
+            std::string m = argv[++i];
+            o.vrs = (m == "auto") ? -1 : std::clamp(std::atoi(m.c_str()), 0, 4);
+            if (o.vrs == 3) o.vrs = 2;
+        }
+        else if (a == "--vrs-tile" && hasNext)    o.vrsParams.tile = std::atoi(argv[++i]);
+        else if (a == "--vrs-flat" && hasNext) {
+            o.vrsParams.flat2 = (float)std::atof(argv[++i]);
+            o.vrsParams.flat4 = o.vrsParams.flat2 * 0.4f;
+        }
+        else if (a == "--vrs-grazing" && hasNext) {
+            o.vrsParams.grazing2 = (float)std::atof(argv[++i]);
+            o.vrsParams.grazing4 = o.vrsParams.grazing2 * 2.5f;
+        }
+        else if (a == "--vrs-report")             o.vrsReport = true;
+        else if (a == "--frames" && hasNext)      o.frames = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--stats" && hasNext)       o.stats = argv[++i];
+        else if (a == "--trace" && hasNext)       o.trace = argv[++i];
+        else if (a == "--views" && hasNext)       o.views = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--lod" && hasNext) {
+            std::string m = argv[++i];
+            o.lod = (m == "auto") ? -1 : std::max(0, std::atoi(m.c_str()));
         }
+        else if (a == "--lod-error" && hasNext)   o.lodError = (float)std::atof(argv[++i]);
+        else std::cout << "Unknown option: " << a << "\n";
     }
+    return o;
 }
 
-
-struct Face {
-    int a,b,c,d;
-    float z;
-    bool front;
-    float alphaMul; 
-};
-
-static void build_cube_faces(std::vector<Face>& faces) {
-    faces.clear();
-
-    
-    faces.push_back({0,1,2,3,0,false,1.0f}); 
-    faces.push_back({4,5,6,7,0,false,1.0f});  
-    faces.push_back({0,1,5,4,0,false,0.25f}); 
-    faces.push_back({2,3,7,6,0,false,1.0f});  
-    faces.push_back({1,2,6,5,0,false,1.0f});  
-    faces.push_back({0,3,7,4,0,false,1.0f});  
-}
-
-static Vec3f face_normal_world(const Vec3f& a, const Vec3f& b, const Vec3f& c) {
-    return normalize(cross(b-a, c-a));
-}
-
-
-void draw_cube_pass_ztest(TGAImage& img,
-                          const std::vector<Vec3f>& Vs,   
-                          std::vector<Face> faces,
-                          bool wantFront,
-                          const TGAColor& col,
-                          float alpha,
-                          const float* zbuf) {
-    for (auto& f : faces) {
-        f.z = (Vs[f.a].z + Vs[f.b].z + Vs[f.c].z + Vs[f.d].z) * 0.25f;
-    }
-
-    
-    std::sort(faces.begin(), faces.end(), [](const Face& x, const Face& y){
-        return x.z < y.z;
-    });
-
-    for (const auto& f : faces) {
-        if (f.front != wantFront) continue;
-
-        Vec3f p0 = Vs[f.a], p1 = Vs[f.b], p2 = Vs[f.c], p3 = Vs[f.d];
-        Vec3f t1[3] = { p0, p1, p2 };
-        Vec3f t2[3] = { p0, p2, p3 };
-
-        float a = alpha * f.alphaMul; 
-
-        triangle_alpha_ztest(t1, img, col, a, zbuf);
-        triangle_alpha_ztest(t2, img, col, a, zbuf);
-    }
+static Camera make_camera(const Vec3f& headCenter, int width, int height) {
+    return Camera(
+        Vec3f(2.8f, 1.8f, 3.8f), 
+        headCenter,              
+        Vec3f(0.f, 1.f, 0.f),    
+        50.f,
+        (float)width/(float)height,
+        0.1f,
+        100.f
+    );
 }
 
-
-void line(Vec2i p0, Vec2i p1, TGAImage& image, const TGAColor& color) {
-    bool steep = false;
-    if (std::abs(p0.x - p1.x) < std::abs(p0.y - p1.y)) {
-        std::swap(p0.x, p0.y);
-        std::swap(p1.x, p1.y);
-        steep = true;
+static int run(const Options& opt, const char* exe) {
+    const int width  = opt.width;
+    const int height = opt.height;
+
+    if (opt.distributed > 0) {
+        DistributedOptions d;
+        d.workers = opt.distributed;
+        d.frames = opt.frames;
+        d.exe = exe;
+        d.workerArgs = "--size " + std::to_string(width) + "x" + std::to_string(height) + " --obj " + shell_quote(opt.obj);
+        d.launcher = opt.launcher;
+        if (!run_coordinator(width, height, d, opt.out)) return 1;
+        openImage(opt.out.c_str());
+        return 0;
     }
-    if (p0.x > p1.x) std::swap(p0, p1);
-
-    int dx = p1.x - p0.x;
-    int dy = std::abs(p1.y - p0.y);
-    int err = dx / 2;
-    int y = p0.y;
-    int ystep = (p0.y < p1.y) ? 1 : -1;
 
-    for (int x = p0.x; x <= p1.x; x++) {
-        if (steep) image.set(y, x, color);
-        else       image.set(x, y, color);
-
-        err -= dy;
-        if (err < 0) { y += ystep; err += dx; }
-    }
-}
+    auto tLoad = std::chrono::steady_clock::now();
 
-void drawCubeEdges(const std::vector<Vec3f>& cubeS, TGAImage& image, const TGAColor& color) {
-    static const int E[12][2] = {
-        {0,1},{1,2},{2,3},{3,0},
-        {4,5},{5,6},{6,7},{7,4},
-        {0,4},{1,5},{2,6},{3,7}
-    };
-
-    for (int i=0;i<12;i++) {
-        int a = E[i][0];
-        int b = E[i][1];
-        Vec2i p0((int)cubeS[a].x, (int)cubeS[a].y);
-        Vec2i p1((int)cubeS[b].x, (int)cubeS[b].y);
-        line(p0, p1, image, color);
-    }
-}
-
-int main() {
     // texture
     TGAImage texture;
     if (!texture.read_tga_file("resources/african_head_diffuse.tga")) {
@@ -204,13 +137,58 @@ int main() {
         return 1;
     }
 
+    if (opt.streamMB > 0) {
+        MeshStore store;
+        if (!store.build_or_open(opt.obj)) {
+            std::cout << "Model store failed\n";
+            return 1;
+        }
+        float headScale = 1.0f;
+        Vec3f bbmin = store.bbmin(), bbmax = store.bbmax();
+        Vec3f headCenter((bbmin.x+bbmax.x)*0.5f, (bbmin.y+bbmax.y)*0.5f, (bbmin.z+bbmax.z)*0.5f);
+        Camera cam = make_camera(headCenter, width, height);
+        Mat4 V = cam.view();
+        Mat4 P = cam.proj();
+
+        CubeOverlay cube;
+        cube.build(headCenter * headScale, 1.25f, cam, V, P, width, height);
+
+        TGAImage image(width, height, TGAImage::RGB);
+        std::vector<float> zbuffer((size_t)width*height, -std::numeric_limits<float>::max());
+
+        StreamStats st;
+        draw_cube_under(cube, image, zbuffer.data());
+        if (!render_streamed(store, texture, headScale, V, P, image, zbuffer.data(),
+                             (size_t)opt.streamMB << 20, &st)) {
+            std::cout << "Streamed render failed: read " << st.tris << " of " << store.ntris() << " tris\n";
+            return 1;
+        }
+        draw_cube_over(cube, image, zbuffer.data());
+
+        std::cout << "streamed " << st.tris << " tris in " << st.chunks << " chunks: "
+                  << st.ms << " ms, " << st.mbps << " MB/s\n";
+
+        image.flip_vertically();
+        image.write_tga_file(opt.out);
+        openImage(opt.out.c_str());
+        return 0;
+    }
+
     // model
-    Model model("resources/african_head.obj");
+    Model model(opt.obj.c_str());
     if (model.nfaces()==0) {
         std::cout << "Model load failed\n";
         return 1;
     }
 
+    // уникальные вершины: дальше всё повершинное считается по ним
+    IndexedMesh mesh;
+    IndexStats ist = index_mesh(model, mesh);
+    std::cout << "indexed " << ist.corners << " corners -> " << ist.unique << " vertices ("
+              << ist.threads << " threads, " << ist.ms << " ms)\n";
+
+    double loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tLoad).count();
+
     float headScale = 1.0f;
 
     
@@ -228,100 +206,280 @@ int main() {
     }
     Vec3f headCenter((bbmin.x+bbmax.x)*0.5f, (bbmin.y+bbmax.y)*0.5f, (bbmin.z+bbmax.z)*0.5f);
 
-    
-    Camera cam(
-        Vec3f(2.8f, 1.8f, 3.8f), 
-        headCenter,              
-        Vec3f(0.f, 1.f, 0.f),    
-        50.f,
-        (float)width/(float)height,
-        0.1f,
-        100.f
-    );
+    Camera cam = make_camera(headCenter, width, height);
+
+    if (opt.views > 0) {
+        std::vector<Camera> cams = orbit_cameras(cam, opt.views);
+
+        // N отдельных рендеров: загрузка + проекция по граням + растеризация на камеру
+        double separateMs = loadMs * cams.size();
+        for (const Camera& c : cams) {
+            auto t0 = std::chrono::steady_clock::now();
+            HeadGeometry h;
+            project_head(mesh, headScale, c.view(), c.proj(), width, height, h);
+            TGAImage img(width, height, TGAImage::RGB);
+            std::vector<float> zb((size_t)width*height, -std::numeric_limits<float>::max());
+            draw_head(h, texture, img, zb.data());
+            separateMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        }
+
+        std::vector<TGAImage> views;
+        auto t0 = std::chrono::steady_clock::now();
+        MultiViewStats st = render_multiview(model, texture, headScale, cams, width, height, views);
+        double multiMs = loadMs + std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+        for (size_t k=0; k<views.size(); k++) {
+            views[k].flip_vertically();
+            views[k].write_tga_file("output_view" + std::to_string(k) + ".tga");
+        }
+        // растеризация на вид та же, что у отдельного рендера: выигрыш - загрузка
+        // и проекция, которые делаются один раз, а не на каждую камеру
+        double separateLoadMs = loadMs * cams.size();
+        std::cout << "multi-view x" << cams.size() << ": " << multiMs << " ms"
+                  << " (load " << loadMs << ", world " << st.worldMs << ", project " << st.projectMs
+                  << ", raster " << st.rasterMs << "), separate: " << separateMs << " ms"
+                  << " (load " << separateLoadMs << ", render " << separateMs - separateLoadMs << ")\n";
+        return 0;
+    }
 
     Mat4 V = cam.view();
     Mat4 P = cam.proj();
 
-    TGAImage image(width, height, TGAImage::RGB);
+    // LOD: цепочка упрощений, уровень по ошибке на экране или явно
+    std::vector<int> lodIndices;
+    if (opt.lod != 0) {
+        CG3_ZONE("lod_chain");
+        auto t0 = std::chrono::steady_clock::now();
+        std::vector<uint32_t> idx(mesh.indices.begin(), mesh.indices.end());
+        meshlod::Chain chain = meshlod::build_chain(&mesh.pos[0].x, sizeof(Vec3f), mesh.pos.size(), idx.data(), idx.size());
+        double lodMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+        Vec3f ext = (bbmax - bbmin) * (0.5f * headScale);
+        float radius = std::sqrt(dot(ext, ext));
+        float dist = std::sqrt(dot(cam.eye - headCenter*headScale, cam.eye - headCenter*headScale));
+        float fovY = cam.fov_deg * 3.14159265f / 180.f;
+        int level = opt.lod < 0 ? meshlod::select_level(chain, radius, dist, fovY, (float)height, opt.lodError)
+                                : std::min(opt.lod, (int)chain.levels.size() - 1);
+
+        for (size_t i=0; i<chain.levels.size(); i++)
+            std::cout << "lod " << i << ": " << chain.levels[i].count/3 << " tris, error " << chain.levels[i].error << "\n";
+        const meshlod::Level& l = chain.levels[level];
+        std::cout << "lod chain " << lodMs << " ms; sphere " << meshlod::projected_radius(radius, dist, fovY, (float)height)
+                  << " px -> level " << level << " (" << l.count/3 << " of " << mesh.nfaces() << " tris)\n";
+        lodIndices.assign(chain.indices.begin() + l.first, chain.indices.begin() + l.first + l.count);
+    }
 
-    
-    float* zbuffer = new float[width*height];
-    for(int i=0;i<width*height;i++) zbuffer[i] = -std::numeric_limits<float>::max();
+    HeadGeometry head;
+    project_head(mesh, headScale, V, P, width, height, head,
+                 lodIndices.empty() ? nullptr : lodIndices.data(), (int)lodIndices.size());
 
-    
-    float cubeSize = 1.25f;
-    Vec3f C = headCenter * headScale;
+    if (opt.hasRegion) {
+        CubeOverlay cube;
+        cube.build(headCenter * headScale, 1.25f, cam, V, P, width, height);
 
-    std::vector<Vec3f> cubeW = {
-        C + Vec3f(-cubeSize,-cubeSize,-cubeSize),
-        C + Vec3f( cubeSize,-cubeSize,-cubeSize),
-        C + Vec3f( cubeSize, cubeSize,-cubeSize),
-        C + Vec3f(-cubeSize, cubeSize,-cubeSize),
-        C + Vec3f(-cubeSize,-cubeSize, cubeSize),
-        C + Vec3f( cubeSize,-cubeSize, cubeSize),
-        C + Vec3f( cubeSize, cubeSize, cubeSize),
-        C + Vec3f(-cubeSize, cubeSize, cubeSize)
-    };
-
-    
-    std::vector<Vec3f> cubeS(8);
-    for(int i=0;i<8;i++) cubeS[i] = project_to_screen(cubeW[i], V, P);
+        auto t0 = std::chrono::steady_clock::now();
+        TGAImage part;
+        std::vector<float> zb((size_t)opt.region.w*opt.region.h);
+        render_region(head, texture, cube, opt.region, part, zb.data());
+        print_region_time(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
 
-    
-    std::vector<Face> faces;
-    build_cube_faces(faces);
-    for (auto& f : faces) {
-        Vec3f a = cubeW[f.a], b = cubeW[f.b], c = cubeW[f.c];
-        Vec3f n = face_normal_world(a,b,c);
-        Vec3f center = (cubeW[f.a] + cubeW[f.b] + cubeW[f.c] + cubeW[f.d]) * 0.25f;
-        Vec3f toCam = normalize(cam.eye - center);
-        f.front = (dot(n, toCam) > 0.f);
+        return part.write_tga_file(opt.out) ? 0 : 1;
     }
 
-    
-    TGAColor cubeBlue(50, 130, 255, 255);
-
-    
-    float alphaBack  = 0.10f;
-    float alphaFront = 0.22f;
-
-    
-    draw_cube_pass_ztest(image, cubeS, faces, false, cubeBlue, alphaBack, zbuffer);
-
-    
-    for (int i=0; i<model.nfaces(); i++) {
-        auto f = model.face(i);
+    if (opt.sortLast > 0) {
+        const float clear = -std::numeric_limits<float>::max();
+
+        // эталон: последовательный draw_head
+        TGAImage serial(width, height, TGAImage::RGB);
+        std::vector<float> serialZ((size_t)width*height, clear);
+        auto t0 = std::chrono::steady_clock::now();
+        draw_head(head, texture, serial, serialZ.data());
+        double serialMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        std::cout << "sort-last serial: " << serialMs << " ms\n";
+
+        // масштабирование по числу потоков, результат сверяется с эталоном
+        for (int n=1; ; n = std::min(n*2, opt.sortLast)) {
+            TGAImage img(width, height, TGAImage::RGB);
+            std::vector<float> zb((size_t)width*height, clear);
+            SortLastStats st;
+            render_sort_last(head, texture, n, img, zb.data(), &st);
+            bool exact = zb == serialZ && image_error(serial, img).maxDiff == 0;
+            std::cout << "sort-last x" << n << ": " << st.totalMs << " ms (raster " << st.rasterMs
+                      << ", composite " << st.compositeMs << "), speedup " << serialMs / st.totalMs
+                      << (exact ? ", exact" : ", MISMATCH") << "\n";
+            if (n == opt.sortLast) break;
+        }
 
-        Vec3f pts[3];
-        Vec2f uv[3];
+        CubeOverlay cube;
+        cube.build(headCenter * headScale, 1.25f, cam, V, P, width, height);
+        TGAImage image(width, height, TGAImage::RGB);
+        std::vector<float> zbuffer((size_t)width*height, clear);
+        draw_cube_under(cube, image, zbuffer.data());
+        render_sort_last(head, texture, opt.sortLast, image, zbuffer.data());
+        draw_cube_over(cube, image, zbuffer.data());
+
+        image.flip_vertically();
+        image.write_tga_file(opt.out);
+        openImage(opt.out.c_str());
+        return 0;
+    }
 
-        for (int j=0; j<3; j++) {
-            int vidx = f[j*2];
-            int tidx = f[j*2 + 1];
+    if (opt.bands > 0) {
+        CubeOverlay cube;
+        cube.build(headCenter * headScale, 1.25f, cam, V, P, width, height);
 
-            Vec3f v = model.vert(vidx) * headScale;
+        BandStats st;
+        if (!render_banded(head, texture, cube, width, height, opt.bands, opt.out, &st)) {
+            std::cout << "Can't write " << opt.out << "\n";
+            return 1;
+        }
+        std::cout << "banded " << width << "x" << height << ": " << st.bands << " bands, "
+                  << st.bandBytes / 1024 << " KB per band, bins " << st.binBytes / 1024
+                  << " KB, " << st.ms << " ms\n";
+        openImage(opt.out.c_str());
+        return 0;
+    }
 
-            
-            v = Vec3f(-v.x, v.y, -v.z);
+    // карта скоростей шейдинга
+    ShadingRateImage rates;
+    double texVarMs = 0;    // СКО текстуры: один раз на текстуру
+    double mapMs = 0;       // карта по граням: на каждый вид, часть цены VRS
+    if (opt.vrs > 0) {
+        rates = ShadingRateImage(width, height, opt.vrsParams.tile, opt.vrs);
+    }
+    else if (opt.vrs < 0) {
+        CG3_ZONE("vrs_map");
+        auto t0 = std::chrono::steady_clock::now();
+        TextureVariance texVar(texture);
+        texVarMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        t0 = std::chrono::steady_clock::now();
+        std::vector<float> faceTexStd(head.nfaces()), faceSlope(head.nfaces());
+
+        for (int i=0; i<head.nfaces(); i++) {
+            const Vec3f* pts = &head.pts[i*3];
+            const Vec2f* uv  = &head.uv[i*3];
+            Vec2f uvmin(std::min({uv[0].x,uv[1].x,uv[2].x}), std::min({uv[0].y,uv[1].y,uv[2].y}));
+            Vec2f uvmax(std::max({uv[0].x,uv[1].x,uv[2].x}), std::max({uv[0].y,uv[1].y,uv[2].y}));
+            faceTexStd[i] = texVar.max_stddev(uvmin, uvmax);
+            faceSlope[i]  = depth_slope(pts);
+        }
+        rates = build_shading_rate(head.pts.data(), head.nfaces(), width, height, faceTexStd, faceSlope, opt.vrsParams);
+        mapMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    }
+    const ShadingRateImage* headRates = opt.vrs ? &rates : nullptr;
+
+    // статический слой: голова
+    StaticLayer headLayer;
+    long long shaded = 0;
+    double headMs = 0;
+    // std::function из лямбды с захватом по ссылке выделяет память - собирается один раз
+    const StaticLayer::RenderFn render_head = [&](TGAImage& img, float* zb) {
+        auto t0 = std::chrono::steady_clock::now();
+        shaded = draw_head(head, texture, img, zb, headRates);
+        headMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    };
 
-            pts[j] = project_to_screen(v, V, P);
-            uv[j]  = model.uv(tidx);
+    TGAImage image;
+    Vec3f C = headCenter * headScale;
+    CubeOverlay cube;
+    framestats::Params statsParams;
+    statsParams.window = (size_t)opt.frames;
+    framestats::Collector frameStats(statsParams);
+
+    FrameArena& arena = FrameArena::local();
+    for (int frame=0; frame<opt.frames; frame++) {
+        CG3_ZONE("frame");
+        auto t0 = std::chrono::steady_clock::now();
+        arena.reset();
+
+        bool rebuilt = headLayer.update(LayerKey::make(model, texture, cam, width, height), render_head);
+
+        // динамические слои: куб меняется каждый кадр
+        float cubeSize = 1.25f + 0.1f*std::sin(0.3f*frame);
+        cube.build(C, cubeSize, cam, V, P, width, height);
+
+        {
+            CG3_ZONE("compose");
+            headLayer.compose(image);
         }
+        draw_cube_under(cube, image, headLayer.under());
+        draw_cube_over(cube, image, headLayer.depth());
 
-        triangle_textured(pts, uv, image, texture, zbuffer);
+        if (opt.frames > 1) {
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+            std::cout << "frame " << frame << (rebuilt ? " full" : " overlay") << ": " << ms << " ms\n";
+            frameStats.add(ms / 1000.0);
+        }
+    }
+    if (opt.frames > 1) {
+        std::cout << "frames: " << framestats::format(frameStats.summary()) << "\n";
+        std::cout << "frame arena: peak " << arena.peak() / 1024 << " KB of " << arena.capacity() / 1024
+                  << " KB, heap blocks " << arena.heap_blocks() << "\n";
+        if (!opt.stats.empty()) {
+            bool json = opt.stats.size() >= 5 && opt.stats.compare(opt.stats.size() - 5, 5, ".json") == 0;
+            bool ok = json ? frameStats.write_json(opt.stats) : frameStats.write_csv(opt.stats);
+            std::cout << (ok ? "frame stats: " : "cannot write frame stats: ") << opt.stats << "\n";
+        }
     }
 
-    
-    draw_cube_pass_ztest(image, cubeS, faces, true, cubeBlue, alphaFront, zbuffer);
-
-   
-    TGAColor edgeBlue(15, 70, 190, 255);
-    drawCubeEdges(cubeS, image, edgeBlue);
+    if (opt.vrsReport && headRates) {
+        // эталон с полной скоростью
+        TGAImage refImage(width, height, TGAImage::RGB);
+        std::vector<float> refZ((size_t)width*height, -std::numeric_limits<float>::max());
+        long long refShaded = draw_head(head, texture, refImage, refZ.data(), nullptr);
+
+        // время - лучшее из нескольких прогонов в одни и те же буферы: первый прогон
+        // в свежий буфер платит за страницы памяти, а не за растеризацию
+        TGAImage scratch(width, height, TGAImage::RGB);
+        std::vector<float> scratchZ((size_t)width*height);
+        auto best_ms = [&](const ShadingRateImage* r) {
+            double best = std::numeric_limits<double>::max();
+            for (int k=0; k<5; k++) {
+                std::fill(scratchZ.begin(), scratchZ.end(), -std::numeric_limits<float>::max());
+                auto t0 = std::chrono::steady_clock::now();
+                draw_head(head, texture, scratch, scratchZ.data(), r);
+                best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+            }
+            return best;
+        };
+        double refMs = best_ms(nullptr);
+        headMs = best_ms(headRates);
+
+        float hist[3];
+        rates.histogram(hist);
+        ImageError err = image_error(refImage, headLayer.color());
+        std::cout << "VRS tiles: 1x1=" << hist[0]*100.f << "% 2x2=" << hist[1]*100.f
+                  << "% 4x4=" << hist[2]*100.f << "%\n";
+        // вызовы шейдера не равны времени: сравнивается и растеризация, и с предпроходом
+        std::cout << "VRS shading: full=" << refShaded << " coarse=" << shaded
+                  << " saved=" << (refShaded ? 100.0*(refShaded - shaded)/refShaded : 0.0) << "% of calls\n";
+        std::cout << "VRS time: full=" << refMs << " ms coarse=" << headMs << " ms";
+        if (opt.vrs < 0) std::cout << " + map " << mapMs << " ms";
+        std::cout << ", saved=" << (refMs > 0 ? 100.0*(refMs - headMs - mapMs)/refMs : 0.0) << "%";
+        if (opt.vrs < 0) std::cout << " (texture variance once per texture: " << texVarMs << " ms)";
+        std::cout << "\n";
+        std::cout << "VRS error: rmse=" << err.rmse << " psnr=" << err.psnr
+                  << " dB max=" << err.maxDiff << "\n";
+    }
 
     image.flip_vertically();
-    image.write_tga_file("output.tga");
-    openImage("output.tga");
+    image.write_tga_file(opt.out);
+    openImage(opt.out.c_str());
 
-    delete[] zbuffer;
     return 0;
 }
+
+int main(int argc, char** argv) {
+    Options opt = parse_options(argc, argv);
+    profiler::set_thread_name("main");
+    int rc = run(opt, argv[0]);
+
+    // рабочие потоки к этому моменту завершены, их счётчики можно складывать
+    if (profiler::enabled) profiler::print_summary(std::cout);
+    if (!opt.trace.empty()) {
+        if (profiler::write_chrome_trace(opt.trace)) std::cout << "trace: " << opt.trace << "\n";
+        else std::cout << (profiler::enabled ? "Can't write trace: " : "Trace needs a -DCG3_PROFILE build: ")
+                       << opt.trace << "\n";
+    }
+    return rc;
+}
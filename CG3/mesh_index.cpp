@@ -0,0 +1,76 @@
+#include "mesh_index.h"
+#include "profiler.h"
+#include "../shared/parallel.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace {
+
+uint64_t mix(uint64_t h) {
+    h ^= h >> 33; h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33; h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+uint64_t key_hash(int v, int t, int n) {
+    uint64_t h = (uint64_t)(uint32_t)v;
+    h = h * 0x9E3779B97F4A7C15ull + (uint32_t)t;
+    h = h * 0x9E3779B97F4A7C15ull + (uint32_t)n;
+    return mix(h);
+}
+
+// кортеж (v, vt, vn) угла
+struct CornerKey {
+    int v = 0, t = 0, n = 0;
+    bool operator==(const CornerKey& o) const { return v == o.v && t == o.t && n == o.n; }
+};
+
+} // namespace
+
+IndexStats index_mesh(const Model& model, IndexedMesh& out, int threads) {
+    CG3_ZONE("index_mesh");
+    auto t0 = std::chrono::steady_clock::now();
+
+    const int* vidx = model.vert_indices().data();
+    const int* tidx = model.uv_indices().data();
+    const int* nidx = model.normal_indices().data();
+    const int C = (int)model.vert_indices().size();
+
+    if (threads <= 0) threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    threads = std::clamp(threads, 1, std::min(parallel::kMaxDedupThreads, std::max(1, C / 4096)));
+
+    // углы с одинаковым кортежем - одна вершина, номера по первому вхождению
+    parallel::Dedup d = parallel::dedup((size_t)C, threads,
+        [&](size_t c) { return CornerKey{ vidx[c], tidx[c], nidx[c] }; },
+        [&](size_t c) { return key_hash(vidx[c], tidx[c], nidx[c]); },
+        [](size_t) { return false; });
+    const int unique = (int)d.first.size();
+
+    // вершины и индексы
+    out.pos.resize(unique);
+    out.uv.resize(unique);
+    out.normal.resize(unique);
+    out.indices.resize(C);
+    parallel::run_threads(threads, [&](int t) {
+        int b = (int)((long long)unique * t / threads), e = (int)((long long)unique * (t+1) / threads);
+        for (int g=b; g<e; g++) {
+            size_t c = d.first[g];
+            out.pos[g]    = model.vert(vidx[c]);
+            out.uv[g]     = model.uv(tidx[c]);
+            out.normal[g] = model.normal(nidx[c]);
+        }
+        b = (int)((long long)C * t / threads); e = (int)((long long)C * (t+1) / threads);
+        for (int c=b; c<e; c++) out.indices[c] = (int)d.index[c];
+    });
+
+    IndexStats st;
+    st.corners = C;
+    st.unique = unique;
+    st.threads = threads;
+    st.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    return st;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <vector>
+#include "geometry.h"
+#include "model.h"
+
+// Индексированный меш: уникальные кортежи (v, vt, vn) OBJ и один индексный буфер.
+// Углы граней с одинаковым кортежем делят вершину, поэтому преобразования
+// и прочая повершинная работа делаются один раз на вершину, а не на угол.
+struct IndexedMesh {
+    std::vector<Vec3f> pos;
+    std::vector<Vec2f> uv;
+    std::vector<Vec3f> normal;
+    std::vector<int>   indices;     // по 3 на треугольник, порядок граней как в Model
+
+    int nverts() const { return (int)pos.size(); }
+    int nfaces() const { return (int)indices.size() / 3; }
+};
+
+struct IndexStats {
+    int    corners = 0;
+    int    unique = 0;
+    int    threads = 0;
+    double ms = 0;
+};
+
+// Параллельная дедупликация: углы разбиты по хэшу на части, у каждого потока
+// своя плоская таблица с открытой адресацией. Номера вершин - по первому вхождению,
+// как у последовательного обхода, и не зависят от числа потоков.
+// threads <= 0 - по числу ядер.
+IndexStats index_mesh(const Model& model, IndexedMesh& out, int threads = 0);
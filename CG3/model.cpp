@@ -1,90 +1,314 @@
 #include "model.h"
-#include <fstream>
-#include <sstream>
-#include <string>
-#include <cstdio>   // sscanf
+#include "profiler.h"
+#include "../shared/mapped_file.h"
+#include "../shared/mesh_normals.h"
+#include "../shared/obj_tokens.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <iostream>
 
-// парсер OBJ:
+Model::Model(const char* filename) {
+    CG3_ZONE("load_obj");
+    auto t0 = std::chrono::steady_clock::now();
+
+    // первый запуск разбирает OBJ и пишет кэш, следующие отображают кэш
+    meshcache::SourceStamp stamp;
+    bool stamped = meshcache::stamp_source(filename, stamp);
+    std::filesystem::path cache = meshcache::cache_path(filename, "cg3");
+    bool cached = stamped && load_cache(cache, stamp);
+
+    size_t bytes = 0;
+    if (!cached) {
+        if (!parse_obj(filename, bytes)) return;
+        if (stamped) save_cache(cache, stamp);
+    }
+    // свойства материалов всегда из .mtl: его правка не сбрасывает кэш
+    if (!usage_.empty() && materials_.empty()) materials_ = objmat::resolve(filename, usage_);
+
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << (cached ? "Loaded OBJ cache: " : "Loaded OBJ: ") << filename << "\n";
+    std::cout << "verts=" << nverts_ << " uv=" << nuv_ << " normals=" << nnorms_ << " faces=" << nfaces();
+    if (!batches_.empty()) std::cout << " materials=" << materials_.size() << " batches=" << batches_.size();
+    if (!cached) std::cout << " (" << (sec > 0 ? bytes / (1024.0*1024.0) / sec : 0.0) << " MB/s)";
+    else         std::cout << " (" << sec*1000.0 << " ms)";
+    std::cout << "\n";
+}
+
+// парсер OBJ прямо по отображённому файлу:
 // v  x y z
 // vt u v
-Model::Model(const char* filename) {
-    std::ifstream in(filename);
-    if(!in) {
+// vn x y z
+// f  v | v/vt | v//vn | v/vt/vn, многоугольники веером, отрицательные индексы от конца
+// mtllib файл / usemtl имя
+bool Model::parse_obj(const char* filename, size_t& bytes) {
+    CG3_ZONE("parse_obj");
+    MappedFile file;
+    if (!file.open(filename)) {
         std::cerr << "Cannot open OBJ: " << filename << "\n";
-        return;
+        return false;
+    }
+    bytes = file.size();
+
+    const char* p = file.data();
+    const char* end = p + file.size();
+
+    // предварительный подсчёт строк, чтобы массивы не переаллоцировались
+    size_t nv = 0, nvt = 0, nvn = 0, nf = 0;
+    for (const char* q = p; q < end; ) {
+        const char* e = obj::line_end(q, end);
+        const char* s = obj::skip_ws(q, e);
+        if (e - s > 1 && s[0] == 'v') { if (s[1] == ' ') nv++; else if (s[1] == 't') nvt++; else if (s[1] == 'n') nvn++; }
+        else if (e - s > 1 && s[0] == 'f') nf++;
+        q = e + 1;
     }
+    verts_.reserve(nv + 1);
+    uv_.reserve(nvt + 1);
+    norms_.reserve(nvn + 1);
+    vidx_.reserve(nf*3);
+    tidx_.reserve(nf*3);
+    nidx_.reserve(nf*3);
 
-    std::string line;
-    while (std::getline(in, line)) {
-        std::istringstream iss(line);
-        std::string tag;
-        iss >> tag;
+    std::vector<int> v_idx;
+    std::vector<int> vt_idx;
+    std::vector<int> vn_idx;
 
-        if (tag == "v") {
+    // материал каждого треугольника; none - грани до первого usemtl
+    const uint32_t none = UINT32_MAX;
+    uint32_t material = none;
+    std::vector<uint32_t> face_mat;
+    auto rest = [](const char* s, const char* e) {
+        s = obj::skip_ws(s, e);
+        while (e > s && (e[-1] == ' ' || e[-1] == '\t' || e[-1] == '\r')) e--;
+        return std::string_view(s, (size_t)(e - s));
+    };
+
+    while (p < end) {
+        const char* e = obj::line_end(p, end);
+        const char* s = obj::skip_ws(p, e);
+        p = e + 1;
+
+        if (obj::tag(s, e, "v")) {
             Vec3f v;
-            iss >> v.x >> v.y >> v.z;
+            obj::parse_float(s, e, v.x);
+            obj::parse_float(s, e, v.y);
+            obj::parse_float(s, e, v.z);
             verts_.push_back(v);
         }
-        else if (tag == "vt") {
+        else if (obj::tag(s, e, "vt")) {
             Vec2f t;
-            iss >> t.x >> t.y;
+            obj::parse_float(s, e, t.x);
+            obj::parse_float(s, e, t.y);
             uv_.push_back(t);
         }
-        else if (tag == "f") {
-            std::vector<int> v_idx;
-            std::vector<int> vt_idx;
-
-            std::string token;
-            while (iss >> token) {
-                int v=0, vt=0, vn=0;
-
-                // v/vt/vn
-                if (sscanf(token.c_str(), "%d/%d/%d", &v, &vt, &vn) == 3) {
-                    v_idx.push_back(v-1);
-                    vt_idx.push_back(vt-1);
-                }
-                // v//vn
-                else if (sscanf(token.c_str(), "%d//%d", &v, &vn) == 2) {
-                    v_idx.push_back(v-1);
-                    vt_idx.push_back(0);
-                }
-                // v/vt
-                else if (sscanf(token.c_str(), "%d/%d", &v, &vt) == 2) {
-                    v_idx.push_back(v-1);
-                    vt_idx.push_back(vt-1);
-                }
-                // v
-                else if (sscanf(token.c_str(), "%d", &v) == 1) {
-                    v_idx.push_back(v-1);
-                    vt_idx.push_back(0);
-                }
+        else if (obj::tag(s, e, "vn")) {
+            Vec3f n;
+            obj::parse_float(s, e, n.x);
+            obj::parse_float(s, e, n.y);
+            obj::parse_float(s, e, n.z);
+            norms_.push_back(n);
+        }
+        else if (obj::tag(s, e, "f")) {
+            v_idx.clear();
+            vt_idx.clear();
+            vn_idx.clear();
+
+            long v, vt, vn;
+            while (obj::parse_corner(s, e, v, vt, vn)) {
+                v_idx.push_back(obj::fix_index(v, verts_.size()));
+                vt_idx.push_back(vt ? obj::fix_index(vt, uv_.size()) : 0);
+                vn_idx.push_back(obj::fix_index(vn, norms_.size()));
             }
 
             if ((int)v_idx.size() < 3) continue;
 
             // Триангуляция
             for (int i=1; i+1 < (int)v_idx.size(); i++) {
-                std::vector<int> f;
-                f.push_back(v_idx[0]);   f.push_back(vt_idx[0]);
-                f.push_back(v_idx[i]);   f.push_back(vt_idx[i]);
-                f.push_back(v_idx[i+1]); f.push_back(vt_idx[i+1]);
-                faces_.push_back(f);
+                vidx_.insert(vidx_.end(), { v_idx[0], v_idx[i], v_idx[i+1] });
+                tidx_.insert(tidx_.end(), { vt_idx[0], vt_idx[i], vt_idx[i+1] });
+                nidx_.insert(nidx_.end(), { vn_idx[0], vn_idx[i], vn_idx[i+1] });
+                face_mat.push_back(material);
             }
         }
+        else if (obj::tag(s, e, "usemtl")) {
+            material = usage_.use(rest(s, e));
+        }
+        else if (obj::tag(s, e, "mtllib")) {
+            usage_.add_lib(rest(s, e));
+        }
+    }
+
+    // грани одного материала подряд; без usemtl порядок не трогаем
+    if (!usage_.empty()) {
+        if (std::find(face_mat.begin(), face_mat.end(), none) != face_mat.end()) {
+            uint32_t untagged = usage_.use("");
+            for (uint32_t& m : face_mat) if (m == none) m = untagged;
+        }
+        materials_ = objmat::resolve(filename, usage_);
+        std::vector<uint32_t> order;
+        batches_ = objmat::group_faces(face_mat, materials_, order);
+        objmat::reorder_faces(vidx_, order);
+        objmat::reorder_faces(tidx_, order);
+        objmat::reorder_faces(nidx_, order);
+    }
+
+    // нулевые элементы в конце: на них указывают битые индексы,
+    // поэтому vert()/uv() обходятся без проверок
+    nverts_ = (int)verts_.size();
+    nuv_ = (int)uv_.size();
+    nnorms_ = (int)norms_.size();
+    verts_.push_back(Vec3f(0,0,0));
+    uv_.push_back(Vec2f(0,0));
+    norms_.push_back(Vec3f(0,0,0));
+    for (int& i : vidx_) if (i < 0 || i >= nverts_) i = nverts_;
+    for (int& i : tidx_) if (i < 0 || i >= nuv_) i = nuv_;
+    for (int& i : nidx_) if (i < 0 || i >= nnorms_) i = nnorms_;
+
+    // без vn нормали считаем по геометрии (сглаживание с изломом, как в CG4)
+    if (nnorms_ == 0 && !vidx_.empty()) {
+        meshnormals::Result n = meshnormals::generate(&verts_[0].x, sizeof(Vec3f), verts_.size(),
+                                                      vidx_.data(), vidx_.size());
+        nnorms_ = (int)n.count();
+        norms_.resize(n.count() + 1);
+        for (size_t i=0; i<n.count(); i++) norms_[i] = Vec3f(n.normals[i*3], n.normals[i*3 + 1], n.normals[i*3 + 2]);
+        norms_[nnorms_] = Vec3f(0,0,0);
+        nidx_.assign(n.corner.begin(), n.corner.end());
+    }
+
+    return true;
+}
+
+bool Model::load_cache(const std::filesystem::path& path, const meshcache::SourceStamp& stamp) {
+    using namespace meshcache;
+    Reader r;
+    if (!r.open(path, stamp)) return false;
+
+    uint32_t fmt = r.header().vertexFormat;
+    const Stream* vs = r.stream(StreamKind::Vertices);
+    const Stream* is = r.stream(StreamKind::Indices);
+    const Stream* ts = r.stream(StreamKind::TexCoords);
+    const Stream* tis = r.stream(StreamKind::TexIndices);
+    const Stream* ns = r.stream(StreamKind::Normals);
+    const Stream* nis = r.stream(StreamKind::NormalIndices);
+    int posOff = attribute_offset(fmt, Position);
+    int uvOff = attribute_offset(fmt, TexCoord);
+    int nOff = attribute_offset(fmt, Normal);
+    if (!vs || !is || posOff < 0 || vs->stride != vertex_stride(fmt) || is->stride != 4 || is->count % 3) return false;
+    bool ownUv = ts && tis && ts->stride == 8 && tis->stride == 4 && tis->count == is->count;
+    bool ownN  = ns && nis && ns->stride == 12 && nis->stride == 4 && nis->count == is->count;
+    // без uv голова осталась бы без текстуры: такой кэш пересобираем
+    if (!ownUv && uvOff < 0) return false;
+
+    // батчи должны покрыть все грани подряд. Проверяются до записи в члены:
+    // после отказа конструктор разбирает OBJ заново в эти же массивы
+    const Stream* ms = r.stream(StreamKind::Materials);
+    const Stream* bs = r.stream(StreamKind::Batches);
+    objmat::Usage usage;
+    std::vector<objmat::Batch> batches;
+    if (ms && bs) {
+        if (ms->stride != 1 || bs->stride != sizeof(objmat::Batch)) return false;
+        usage = objmat::Usage::parse(std::string_view((const char*)r.data(*ms), (size_t)ms->count));
+        const objmat::Batch* b = (const objmat::Batch*)r.data(*bs);
+        batches.assign(b, b + bs->count);
+        uint64_t next = 0;
+        for (auto& batch : batches) {
+            if (batch.first != next || batch.material >= usage.names.size()) return false;
+            next += batch.count;
+        }
+        if (next * 3 != is->count) return false;
+    }
+    usage_ = std::move(usage);
+    batches_ = std::move(batches);
+
+    // атрибут из общей вершины: индексы те же, что у позиций
+    const char* vp = (const char*)r.data(*vs);
+    auto gather = [&](auto& dst, int off) {
+        for (size_t i = 0; i < vs->count; i++) std::memcpy(&dst[i], vp + i*vs->stride + off, sizeof(dst[i]));
+    };
+
+    nverts_ = (int)vs->count;
+    verts_.resize(vs->count + 1);
+    if (vs->stride == sizeof(Vec3f)) std::memcpy(verts_.data(), vp, vs->count * sizeof(Vec3f));
+    else gather(verts_, posOff);
+    verts_[nverts_] = Vec3f(0,0,0);
+
+    vidx_.resize(is->count);
+    std::memcpy(vidx_.data(), r.data(*is), is->count * 4);
+
+    if (ownUv) {
+        nuv_ = (int)ts->count;
+        uv_.resize(ts->count + 1);
+        std::memcpy(uv_.data(), r.data(*ts), ts->count * sizeof(Vec2f));
+        tidx_.resize(tis->count);
+        std::memcpy(tidx_.data(), r.data(*tis), tis->count * 4);
+    } else {
+        nuv_ = nverts_;
+        uv_.resize(vs->count + 1);
+        gather(uv_, uvOff);
+        tidx_ = vidx_;
+    }
+    uv_[nuv_] = Vec2f(0,0);
+
+    if (ownN) {
+        nnorms_ = (int)ns->count;
+        norms_.resize(ns->count + 1);
+        std::memcpy(norms_.data(), r.data(*ns), ns->count * sizeof(Vec3f));
+        nidx_.resize(nis->count);
+        std::memcpy(nidx_.data(), r.data(*nis), nis->count * 4);
+    } else if (nOff >= 0) {
+        nnorms_ = nverts_;
+        norms_.resize(vs->count + 1);
+        gather(norms_, nOff);
+        nidx_ = vidx_;
+    } else {
+        nnorms_ = 0;
+        norms_.assign(1, Vec3f(0,0,0));
+        nidx_.assign(vidx_.size(), 0);
+    }
+    norms_[nnorms_] = Vec3f(0,0,0);
+
+    // кэш мог быть испорчен: инвариант "битый индекс -> нулевой элемент" восстанавливаем
+    for (int& i : vidx_) if (i < 0 || i > nverts_) i = nverts_;
+    for (int& i : tidx_) if (i < 0 || i > nuv_) i = nuv_;
+    for (int& i : nidx_) if (i < 0 || i > nnorms_) i = nnorms_;
+    return true;
+}
+
+void Model::save_cache(const std::filesystem::path& path, const meshcache::SourceStamp& stamp) const {
+    using namespace meshcache;
+    Vec3f bmin(0,0,0), bmax(0,0,0);
+    if (nverts_ > 0) {
+        bmin = bmax = verts_[0];
+        for (int i = 1; i < nverts_; i++) {
+            const Vec3f& v = verts_[i];
+            bmin = Vec3f(std::min(bmin.x, v.x), std::min(bmin.y, v.y), std::min(bmin.z, v.z));
+            bmax = Vec3f(std::max(bmax.x, v.x), std::max(bmax.y, v.y), std::max(bmax.z, v.z));
+        }
     }
+    float lo[3] = { bmin.x, bmin.y, bmin.z }, hi[3] = { bmax.x, bmax.y, bmax.z };
 
-    std::cout << "Loaded OBJ: " << filename << "\n";
-    std::cout << "verts=" << verts_.size() << " uv=" << uv_.size() << " faces=" << faces_.size() << "\n";
+    // нулевые элементы в кэш не пишем, индексы на них равны nverts/nuv/nnormals
+    std::string names = usage_.serialize();
+    StreamData streams[] = {
+        { StreamKind::Vertices,   sizeof(Vec3f), (uint64_t)nverts_,     verts_.data() },
+        { StreamKind::Indices,    4,             (uint64_t)vidx_.size(), vidx_.data() },
+        { StreamKind::TexCoords,  sizeof(Vec2f), (uint64_t)nuv_,        uv_.data() },
+        { StreamKind::TexIndices, 4,             (uint64_t)tidx_.size(), tidx_.data() },
+        { StreamKind::Normals,    sizeof(Vec3f), (uint64_t)nnorms_,     norms_.data() },
+        { StreamKind::NormalIndices, 4,          (uint64_t)nidx_.size(), nidx_.data() },
+        { StreamKind::Materials,  1,             (uint64_t)names.size(), names.data() },
+        { StreamKind::Batches,    sizeof(objmat::Batch), (uint64_t)batches_.size(), batches_.data() },
+    };
+    if (!write(path, stamp, Position, lo, hi, streams, batches_.empty() ? 6 : 8))
+        std::cerr << "Cannot write OBJ cache: " << path.string() << "\n";
 }
 
-Vec3f Model::vert(int i) const {
-    if (i < 0 || i >= (int)verts_.size()) return Vec3f(0,0,0);
+Vec3f Model::vert_checked(int i) const {
+    if (i < 0 || i >= nverts_) return Vec3f(0,0,0);
     return verts_[i];
 }
 
-Vec2f Model::uv(int i) const {
-    if (uv_.empty()) return Vec2f(0,0);
-    if (i < 0 || i >= (int)uv_.size()) return Vec2f(0,0);
+Vec2f Model::uv_checked(int i) const {
+    if (i < 0 || i >= nuv_) return Vec2f(0,0);
     return uv_[i];
 }
@@ -1,25 +1,66 @@
 #pragma once
 #include <vector>
 #include <string>
+#include <span>
+#include <cassert>
 #include "geometry.h"
+#include "../shared/mesh_cache.h"
+#include "../shared/obj_material.h"
 
 class Model {
 public:
     Model(const char* filename);
 
-    int nfaces() const { return (int)faces_.size(); }
-    int nverts() const { return (int)verts_.size(); }
-    int nuv()    const { return (int)uv_.size(); }
+    int nfaces() const { return (int)vidx_.size() / 3; }
+    int nverts() const { return nverts_; }
+    int nuv()    const { return nuv_; }
+    int nnormals() const { return nnorms_; }
 
-    std::vector<int> face(int idx) const { return faces_[idx]; }
+    // индексы грани без копирования: 3 позиции и 3 uv
+    std::span<const int, 3> face_verts(int idx) const { return std::span<const int, 3>(vidx_.data() + idx*3, 3); }
+    std::span<const int, 3> face_uvs(int idx)   const { return std::span<const int, 3>(tidx_.data() + idx*3, 3); }
+    std::span<const int, 3> face_normals(int idx) const { return std::span<const int, 3>(nidx_.data() + idx*3, 3); }
 
-    Vec3f vert(int i) const;
-    Vec2f uv(int i) const;
+    // доступ без проверок: битые индексы при загрузке указывают на нулевой элемент в конце
+    Vec3f vert(int i) const { assert(i >= 0 && i <= nverts_); return verts_[i]; }
+    Vec2f uv(int i)   const { assert(i >= 0 && i <= nuv_);    return uv_[i]; }
+    Vec3f normal(int i) const { assert(i >= 0 && i <= nnorms_); return norms_[i]; }
+
+    // с проверкой диапазона, для отладки
+    Vec3f vert_checked(int i) const;
+    Vec2f uv_checked(int i) const;
+
+    // массивы целиком для пакетной обработки
+    std::span<const Vec3f> verts()       const { return std::span<const Vec3f>(verts_.data(), nverts_); }
+    std::span<const Vec2f> uvs()         const { return std::span<const Vec2f>(uv_.data(), nuv_); }
+    std::span<const int>   vert_indices() const { return vidx_; }
+    std::span<const int>   uv_indices()   const { return tidx_; }
+    std::span<const int>   normal_indices() const { return nidx_; }
+
+    // материалы usemtl; грани сгруппированы, батч - подряд идущие грани одного материала.
+    // Без usemtl оба пусты и порядок граней файловый
+    const std::vector<objmat::Material>& materials() const { return materials_; }
+    std::span<const objmat::Batch> batches() const { return batches_; }
 
 private:
+    bool parse_obj(const char* filename, size_t& bytes);
+    // кэш CGMB рядом с OBJ: позиции, uv и нормали со своими индексами, имена материалов и батчи
+    bool load_cache(const std::filesystem::path& path, const meshcache::SourceStamp& stamp);
+    void save_cache(const std::filesystem::path& path, const meshcache::SourceStamp& stamp) const;
+
+    int nverts_ = 0;
+    int nuv_ = 0;
+    int nnorms_ = 0;
     std::vector<Vec3f> verts_;
     std::vector<Vec2f> uv_;
+    std::vector<Vec3f> norms_;
+
+    // по 3 индекса на треугольник, одним массивом
+    std::vector<int> vidx_;
+    std::vector<int> tidx_;
+    std::vector<int> nidx_;    // угол без vn указывает на нулевую нормаль
 
-   
-    std::vector<std::vector<int>> faces_;
+    objmat::Usage usage_;
+    std::vector<objmat::Material> materials_;
+    std::vector<objmat::Batch> batches_;
 };
@@ -0,0 +1,89 @@
+#include "multiview.h"
+#include "frame_arena.h"
+#include "profiler.h"
+#include "render.h"
+#include "scene.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <thread>
+
+static double ms_since(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+MultiViewStats render_multiview(const Model& model, const TGAImage& tex, float headScale,
+                                const std::vector<Camera>& cams, int width, int height,
+                                std::vector<TGAImage>& out, int threads) {
+    MultiViewStats st;
+    const int nv = model.nverts();
+    const int nviews = (int)cams.size();
+
+    // мировые координаты - один раз на вершину
+    auto t0 = std::chrono::steady_clock::now();
+    // +1: нулевая вершина, на которую указывают битые индексы
+    std::vector<Vec3f> world(nv + 1);
+    for (int i=0; i<=nv; i++) world[i] = head_to_world(model.vert(i), headScale);
+    st.worldMs = ms_since(t0);
+
+    // проекция во все виды одним проходом по вершинам: screen[view*nv + i]
+    t0 = std::chrono::steady_clock::now();
+    std::vector<Mat4> Vs(nviews), Ps(nviews);
+    for (int k=0; k<nviews; k++) { Vs[k] = cams[k].view(); Ps[k] = cams[k].proj(); }
+
+    const size_t stride = (size_t)nv + 1;
+    std::vector<Vec3f> screen((size_t)nviews*stride);
+    for (size_t i=0; i<stride; i++)
+        for (int k=0; k<nviews; k++)
+            screen[k*stride + i] = project_to_screen(world[i], Vs[k], Ps[k], width, height);
+    st.projectMs = ms_since(t0);
+
+    // растеризация видов параллельно
+    t0 = std::chrono::steady_clock::now();
+    out.assign(nviews, TGAImage(width, height, TGAImage::RGB));
+
+    if (threads <= 0) threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, std::max(1, nviews));
+
+    std::atomic<int> next(0);
+    auto worker = [&]() {
+        ArenaScope scope;
+        std::span<float> zbuf = scope.arena().alloc<float>((size_t)width*height);
+        for (int k = next++; k < nviews; k = next++) {
+            CG3_ZONE("multiview_raster");
+            std::fill(zbuf.begin(), zbuf.end(), -std::numeric_limits<float>::max());
+            const Vec3f* s = &screen[k*stride];
+            const int* vidx = model.vert_indices().data();
+            const int* tidx = model.uv_indices().data();
+
+            for (int i=0; i<model.nfaces(); i++) {
+                Vec3f pts[3] = { s[vidx[i*3]], s[vidx[i*3+1]], s[vidx[i*3+2]] };
+                Vec2f uv[3]  = { model.uv(tidx[i*3]), model.uv(tidx[i*3+1]), model.uv(tidx[i*3+2]) };
+                triangle_textured(pts, uv, out[k], tex, zbuf.data());
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int t=1; t<threads; t++) pool.emplace_back(worker);
+    worker();
+    for (auto& th : pool) th.join();
+    st.rasterMs = ms_since(t0);
+
+    return st;
+}
+
+std::vector<Camera> orbit_cameras(const Camera& base, int count) {
+    std::vector<Camera> cams;
+    Vec3f d = base.eye - base.target;
+    float r = std::sqrt(d.x*d.x + d.z*d.z);
+    float a0 = std::atan2(d.z, d.x);
+
+    for (int k=0; k<count; k++) {
+        float a = a0 + 2.f*3.14159265f*k / count;
+        Vec3f eye = base.target + Vec3f(r*std::cos(a), d.y, r*std::sin(a));
+        cams.emplace_back(eye, base.target, base.up, base.fov_deg, base.aspect, base.znear, base.zfar);
+    }
+    return cams;
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <vector>
+#include "geometry.h"
+#include "tgaimage.h"
+#include "model.h"
+
+// Рендер одной модели с нескольких камер за один проход:
+// вершины переводятся в мировые координаты один раз, проецируются сразу
+// во все виды, затем виды растеризуются параллельно в свои цели.
+// Растеризация вида стоит столько же, сколько у отдельного рендера, а доля
+// вершин у головы мала: выигрыш против N отдельных запусков - в основном
+// загрузка модели, которая делается один раз.
+
+struct MultiViewStats {
+    double worldMs   = 0;
+    double projectMs = 0;
+    double rasterMs  = 0;
+};
+
+// out получает по изображению на камеру; threads = 0 - по числу ядер
+MultiViewStats render_multiview(const Model& model, const TGAImage& tex, float headScale,
+                                const std::vector<Camera>& cams, int width, int height,
+                                std::vector<TGAImage>& out, int threads = 0);
+
+// камеры по окружности вокруг center в плоскости XZ, на высоте eye.y
+std::vector<Camera> orbit_cameras(const Camera& base, int count);
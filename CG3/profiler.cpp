@@ -0,0 +1,155 @@
+#include "profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace profiler {
+
+#ifdef CG3_PROFILE
+namespace {
+
+const char* const kCounterNames[CounterCount] = {
+    "triangles submitted", "triangles culled", "pixels tested", "pixels passed z",
+    "pixels shaded", "pixels blended", "pixels covered"
+};
+
+struct Event {
+    const char* name;
+    int64_t begin, end;         // нс от старта программы
+};
+
+// журнал потока: пишет только свой поток, читается после join
+struct ThreadLog {
+    int id = 0;
+    std::string name;
+    std::vector<Event> events;
+    int64_t counters[CounterCount] = {};
+};
+
+std::mutex g_mutex;
+std::vector<std::unique_ptr<ThreadLog>> g_threads;     // переживают свои потоки
+const std::chrono::steady_clock::time_point g_start = std::chrono::steady_clock::now();
+
+int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - g_start).count();
+}
+
+ThreadLog& thread_log() {
+    thread_local ThreadLog* self = nullptr;
+    if (!self) {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        g_threads.push_back(std::make_unique<ThreadLog>());
+        self = g_threads.back().get();
+        self->id = (int)g_threads.size() - 1;
+        self->name = self->id == 0 ? "main" : "worker " + std::to_string(self->id);
+    }
+    return *self;
+}
+
+} // namespace
+
+Zone::Zone(const char* name) : name_(name), begin_(now_ns()) {}
+
+Zone::~Zone() {
+    thread_log().events.push_back({ name_, begin_, now_ns() });
+}
+
+void add(Counter c, int64_t n) {
+    thread_log().counters[c] += n;
+}
+
+void set_thread_name(const std::string& name) {
+    thread_log().name = name;
+}
+
+void print_summary(std::ostream& os) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+
+    // зоны с одним именем из разных потоков и вызовов складываются;
+    // вложенная зона входит и в родителя
+    struct Stat { int calls = 0; int64_t total = 0, max = 0; std::vector<int> threads; };
+    std::map<std::string, Stat> zones;
+    int64_t counters[CounterCount] = {};
+    for (const auto& t : g_threads) {
+        for (const Event& e : t->events) {
+            Stat& s = zones[e.name];
+            s.calls++;
+            s.total += e.end - e.begin;
+            s.max = std::max(s.max, e.end - e.begin);
+            if (std::find(s.threads.begin(), s.threads.end(), t->id) == s.threads.end()) s.threads.push_back(t->id);
+        }
+        for (int c=0; c<CounterCount; c++) counters[c] += t->counters[c];
+    }
+
+    std::vector<std::pair<std::string, Stat>> rows(zones.begin(), zones.end());
+    std::stable_sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) { return a.second.total > b.second.total; });
+
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-24s %7s %7s %11s %10s %10s\n", "zone", "calls", "threads", "total ms", "avg ms", "max ms");
+    os << line;
+    for (const auto& [name, s] : rows) {
+        std::snprintf(line, sizeof(line), "%-24s %7d %7d %11.3f %10.3f %10.3f\n", name.c_str(), s.calls,
+                      (int)s.threads.size(), s.total * 1e-6, s.total * 1e-6 / s.calls, s.max * 1e-6);
+        os << line;
+    }
+    for (int c=0; c<CounterCount; c++) {
+        std::snprintf(line, sizeof(line), "%-24s %lld\n", kCounterNames[c], (long long)counters[c]);
+        os << line;
+    }
+    if (counters[TrianglesSubmitted] > 0) {
+        std::snprintf(line, sizeof(line), "%-24s %.1f%%\n", "culled",
+                      100.0 * counters[TrianglesCulled] / counters[TrianglesSubmitted]);
+        os << line;
+    }
+    if (counters[PixelsCovered] > 0) {
+        std::snprintf(line, sizeof(line), "%-24s %.3f\n", "overdraw",
+                      (double)counters[PixelsPassedZ] / counters[PixelsCovered]);
+        os << line;
+    }
+}
+
+bool write_chrome_trace(const std::string& path) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) return false;
+
+    // время в микросекундах; счётчики - одно событие "C" в конце трассы
+    char buf[256];
+    int64_t last = 0;
+    bool first = true;
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    for (const auto& t : g_threads) {
+        std::snprintf(buf, sizeof(buf), "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                      first ? "" : ",\n", t->id, t->name.c_str());
+        out << buf;
+        first = false;
+        for (const Event& e : t->events) {
+            std::snprintf(buf, sizeof(buf), ",\n{\"name\":\"%s\",\"cat\":\"cg3\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                          e.name, t->id, e.begin * 1e-3, (e.end - e.begin) * 1e-3);
+            out << buf;
+            last = std::max(last, e.end);
+        }
+    }
+    int64_t counters[CounterCount] = {};
+    for (const auto& t : g_threads)
+        for (int c=0; c<CounterCount; c++) counters[c] += t->counters[c];
+    std::snprintf(buf, sizeof(buf), "%s{\"name\":\"pipeline\",\"ph\":\"C\",\"pid\":1,\"tid\":0,\"ts\":%.3f,\"args\":{",
+                  first ? "" : ",\n", last * 1e-3);
+    out << buf;
+    for (int c=0; c<CounterCount; c++) {
+        std::snprintf(buf, sizeof(buf), "%s\"%s\":%lld", c ? "," : "", kCounterNames[c], (long long)counters[c]);
+        out << buf;
+    }
+    out << "}}\n]}\n";
+    return (bool)out;
+}
+
+#endif
+
+} // namespace profiler
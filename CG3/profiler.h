@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+// Встроенный профайлер CG3: зоны времени по этапам и потокам и счётчики конвейера.
+// Собирается только с -DCG3_PROFILE. Без флага макросы раскрываются в ничто, а локальные
+// счётчики растеризатора оптимизатор выбрасывает как неиспользуемые - цена нулевая.
+//   CG3_ZONE("draw_head");               - зона до конца области видимости
+//   CG3_COUNT(PixelsTested, n);          - прибавить n к счётчику текущего потока
+// Счётчики копятся в потоке без синхронизации и складываются при отчёте,
+// поэтому отчёт снимается после join рабочих потоков.
+namespace profiler {
+
+enum Counter {
+    TrianglesSubmitted,     // треугольники, переданные растеризатору
+    TrianglesCulled,        // отброшены до обхода пикселей: вне экрана или нулевой площади
+    PixelsTested,           // пиксели внутри треугольника, дошедшие до z-теста
+    PixelsPassedZ,          // прошли z-тест с записью глубины
+    PixelsShaded,           // вызовы шейдера (с VRS меньше, чем прошедших z-тест)
+    PixelsBlended,          // прозрачные пиксели куба, прошедшие z-тест
+    PixelsCovered,          // первая запись глубины в пиксель: перерисовка = PassedZ / Covered
+    CounterCount
+};
+
+#ifdef CG3_PROFILE
+constexpr bool enabled = true;
+
+class Zone {
+public:
+    explicit Zone(const char* name);    // name - строковый литерал, хранится указатель
+    ~Zone();
+    Zone(const Zone&) = delete;
+    Zone& operator=(const Zone&) = delete;
+private:
+    const char* name_;
+    int64_t begin_;
+};
+
+void add(Counter c, int64_t n);
+
+// имя потока в трассе; по умолчанию "main" у первого потока и "worker N" у остальных
+void set_thread_name(const std::string& name);
+// таблица зон (вызовы, сумма, среднее, максимум) и счётчиков
+void print_summary(std::ostream& os);
+// трасса в формате Chrome trace event (chrome://tracing, Perfetto); false - ошибка записи
+bool write_chrome_trace(const std::string& path);
+#else
+constexpr bool enabled = false;
+
+inline void set_thread_name(const std::string&) {}
+inline void print_summary(std::ostream&) {}
+inline bool write_chrome_trace(const std::string&) { return false; }
+#endif
+
+} // namespace profiler
+
+#ifdef CG3_PROFILE
+#define CG3_PROFILE_CAT2(a, b) a##b
+#define CG3_PROFILE_CAT(a, b) CG3_PROFILE_CAT2(a, b)
+#define CG3_ZONE(name) ::profiler::Zone CG3_PROFILE_CAT(cg3Zone, __LINE__)(name)
+#define CG3_COUNT(counter, n) ::profiler::add(::profiler::counter, (int64_t)(n))
+#else
+#define CG3_ZONE(name) ((void)0)
+#define CG3_COUNT(counter, n) ((void)sizeof(n))   // n не вычисляется, но считается использованным
+#endif
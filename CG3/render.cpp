@@ -0,0 +1,379 @@
+#include "render.h"
+#include "frame_arena.h"
+#include "profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+TGAColor blend_over(const TGAColor& dst, const TGAColor& src, float a) {
+    int r = (int)(dst.bgra[2]*(1.f-a) + src.bgra[2]*a);
+    int g = (int)(dst.bgra[1]*(1.f-a) + src.bgra[1]*a);
+    int b = (int)(dst.bgra[0]*(1.f-a) + src.bgra[0]*a);
+    r = std::clamp(r,0,255); g = std::clamp(g,0,255); b = std::clamp(b,0,255);
+    return TGAColor((uint8_t)r,(uint8_t)g,(uint8_t)b,255);
+}
+
+// проекция вершины 
+Vec3f project_to_screen(const Vec3f& v_world, const Mat4& V, const Mat4& P, int width, int height) {
+    Vec4f vw(v_world.x, v_world.y, v_world.z, 1.f);
+
+    Vec4f vview4 = V * vw;               
+    float depth = -vview4.z;             
+
+    Vec4f vclip = P * vview4;            
+    if (std::abs(vclip.w) < 1e-8f) vclip.w = 1.f;
+
+    float ndc_x = vclip.x / vclip.w;
+    float ndc_y = vclip.y / vclip.w;
+
+    float sx = (ndc_x + 1.f) * width  * 0.5f;
+    float sy = (ndc_y + 1.f) * height * 0.5f;
+
+    return Vec3f(sx, sy, depth);
+}
+
+// вне экрана или нулевой площади: barycentric() для такого треугольника
+// не покрывает ни одного пикселя, обход рамки можно не начинать
+static bool culled(const Vec3f* pts, Vec2i bmin, Vec2i bmax) {
+    if (bmin.x > bmax.x || bmin.y > bmax.y) return true;
+    float area = (pts[2].x - pts[0].x)*(pts[1].y - pts[0].y) - (pts[1].x - pts[0].x)*(pts[2].y - pts[0].y);
+    return std::abs(area) < 1e-6f;
+}
+
+// треугольник головы
+int triangle_textured(Vec3f* pts, Vec2f* uv, TGAImage& img, const TGAImage& tex, float* zbuf,
+                      const ShadingRateImage* rates) {
+    const int width = img.get_width(), height = img.get_height();
+    Vec2i bmin(width-1, height-1), bmax(0,0);
+    for(int i=0;i<3;i++){
+        bmin.x = std::max(0, std::min(bmin.x, (int)pts[i].x));
+        bmin.y = std::max(0, std::min(bmin.y, (int)pts[i].y));
+        bmax.x = std::min(width-1, std::max(bmax.x, (int)pts[i].x));
+        bmax.y = std::min(height-1, std::max(bmax.y, (int)pts[i].y));
+    }
+    CG3_COUNT(TrianglesSubmitted, 1);
+    if (culled(pts, bmin, bmax)) { CG3_COUNT(TrianglesCulled, 1); return 0; }
+
+    auto shade = [&](const Vec3f& bc) {
+        Vec2f uvp(
+            uv[0].x*bc.x + uv[1].x*bc.y + uv[2].x*bc.z,
+            uv[0].y*bc.x + uv[1].y*bc.y + uv[2].y*bc.z
+        );
+
+        int tx = (int)(uvp.x * (tex.get_width()-1));
+        int ty = (int)((1.f-uvp.y) * (tex.get_height()-1));
+        return tex.get(tx,ty);
+    };
+
+    int shaded = 0;
+    // счётчики профайлера; без CG3_PROFILE не используются и исчезают при оптимизации
+    const float clear = -std::numeric_limits<float>::max();
+    int tested = 0, passed = 0, covered = 0;
+    auto count = [&]() {
+        CG3_COUNT(PixelsTested, tested);
+        CG3_COUNT(PixelsPassedZ, passed);
+        CG3_COUNT(PixelsShaded, shaded);
+        CG3_COUNT(PixelsCovered, covered);
+    };
+
+    if (!rates) {
+        for(int x=bmin.x; x<=bmax.x; x++){
+            for(int y=bmin.y; y<=bmax.y; y++){
+                Vec3f bc = barycentric(pts, Vec3f((float)x,(float)y,0));
+                if(bc.x<0 || bc.y<0 || bc.z<0) continue;
+
+                float z = pts[0].z*bc.x + pts[1].z*bc.y + pts[2].z*bc.z;
+                int idx = x + y*width;
+                tested++;
+
+                if (z > zbuf[idx]) {
+                    covered += zbuf[idx] == clear;
+                    passed++;
+                    zbuf[idx] = z;
+                    img.set(x,y, shade(bc));
+                    shaded++;
+                }
+            }
+        }
+        count();
+        return shaded;
+    }
+
+    // Грубый путь: барицентрики аффинны по x,y, поэтому считаются парой умножений
+    // без barycentric() на пиксель, а подблок r x r, не задевающий треугольник,
+    // отбрасывается по оценке на углах целиком. Глубина и покрытие - попиксельно.
+    const float inv = 1.f / ((pts[2].x-pts[0].x)*(pts[1].y-pts[0].y) - (pts[1].x-pts[0].x)*(pts[2].y-pts[0].y));
+    const float b1x = -(pts[2].y-pts[0].y)*inv, b1y =  (pts[2].x-pts[0].x)*inv;   // bc.y
+    const float b2x =  (pts[1].y-pts[0].y)*inv, b2y = -(pts[1].x-pts[0].x)*inv;   // bc.z
+    const float dz1 = pts[1].z - pts[0].z, dz2 = pts[2].z - pts[0].z;
+    auto bary = [&](float dx, float dy) {
+        float b1 = b1x*dx + b1y*dy, b2 = b2x*dx + b2y*dy;
+        return Vec3f(1.f - b1 - b2, b1, b2);
+    };
+    // хотя бы одна барицентрика отрицательна во всём прямоугольнике [x0,x1]x[y0,y1]
+    auto outside = [&](int x0, int y0, int x1, int y1) {
+        float hx = 0.5f*(x1 - x0), hy = 0.5f*(y1 - y0);
+        Vec3f c = bary(0.5f*(x0 + x1) - pts[0].x, 0.5f*(y0 + y1) - pts[0].y);
+        float e1 = std::abs(b1x)*hx + std::abs(b1y)*hy;
+        float e2 = std::abs(b2x)*hx + std::abs(b2y)*hy;
+        float e0 = std::abs(b1x + b2x)*hx + std::abs(b1y + b2y)*hy;
+        return c.x + e0 < 0.f || c.y + e1 < 0.f || c.z + e2 < 0.f;
+    };
+
+    // блоки 4x4 выровнены по сетке, тайл кратен 4 - блок целиком в одном тайле
+    for(int by=bmin.y & ~3; by<=bmax.y; by+=4){
+        const uint8_t* rateRow = &rates->rate[(size_t)(by / rates->tile) * rates->tilesX];
+        for(int bx=bmin.x & ~3; bx<=bmax.x; bx+=4){
+            const int bx0 = std::max(bx, bmin.x), bx1 = std::min(bx+3, bmax.x);
+            const int by0 = std::max(by, bmin.y), by1 = std::min(by+3, bmax.y);
+            if (outside(bx0, by0, bx1, by1)) continue;
+            const int r = rateRow[bx / rates->tile];
+
+            for(int sy=by; sy<by+4; sy+=r){
+                for(int sx=bx; sx<bx+4; sx+=r){
+                    const int x0 = std::max(sx, bmin.x), x1 = std::min(sx+r-1, bmax.x);
+                    const int y0 = std::max(sy, bmin.y), y1 = std::min(sy+r-1, bmax.y);
+                    if (x0 > x1 || y0 > y1 || (r > 1 && outside(x0, y0, x1, y1))) continue;
+                    bool have = false;
+                    TGAColor c;
+
+                    for(int y=y0; y<=y1; y++){
+                        const float dy = (float)y - pts[0].y;
+                        for(int x=x0; x<=x1; x++){
+                            Vec3f bc = bary((float)x - pts[0].x, dy);
+                            if(bc.x<0 || bc.y<0 || bc.z<0) continue;
+
+                            float z = pts[0].z + dz1*bc.y + dz2*bc.z;
+                            int idx = x + y*width;
+                            tested++;
+
+                            if (z > zbuf[idx]) {
+                                covered += zbuf[idx] == clear;
+                                passed++;
+                                zbuf[idx] = z;
+                                // шейдим в первом покрытом пикселе блока
+                                if (!have) { c = shade(bc); have = true; shaded++; }
+                                img.set(x,y, c);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    count();
+    return shaded;
+}
+
+
+// Растеризация полупрозрачной грани по строкам с тем же результатом, что и у
+// barycentric() на каждом пикселе рамки.
+// Барицентрики и глубина аффинны по x, y и считаются в double. Погрешность
+// barycentric() во float оценивается сверху (tolB для координат, zTol для
+// глубины); пиксель, который по аффинной оценке решается с запасом больше
+// погрешности, barycentric() не нужен. Ближе к ребру или к глубине слоя -
+// точный barycentric(), как раньше.
+namespace {
+struct AlphaRaster {
+    bool exactOnly = false;     // тонкий треугольник: оценка бесполезна, всё точно
+    double tolB = 0, zTol = 0;
+    double b1x = 0, b1y = 0, b1c = 0;   // b1 = b1x*x + b1y*y + b1c
+    double b2x = 0, b2y = 0, b2c = 0;
+    double zx = 0, zy = 0, zc = 0;
+
+    AlphaRaster(const Vec3f* pts, Vec2i bmin, Vec2i bmax) {
+        const double eps = std::ldexp(1.0, -24);
+        const double e1x = pts[1].x - pts[0].x, e1y = pts[1].y - pts[0].y;
+        const double e2x = pts[2].x - pts[0].x, e2y = pts[2].y - pts[0].y;
+        const double uz = e2x*e1y - e1x*e2y;
+        // модуль любой разности в cross() внутри barycentric(): рёбра и p0 - P по рамке
+        const double px = pts[0].x, py = pts[0].y;
+        double d = std::max({ std::abs(e1x), std::abs(e1y), std::abs(e2x), std::abs(e2y),
+                              std::abs(px - bmin.x), std::abs(px - bmax.x),
+                              std::abs(py - bmin.y), std::abs(py - bmax.y) }) + 1.0;
+        tolB = 64.0*eps*d*d / std::abs(uz) + 8.0*eps;
+        exactOnly = !(tolB < 0.25);
+        if (exactOnly) return;
+        zTol = 2.0*(std::abs(pts[0].z) + std::abs(pts[1].z) + std::abs(pts[2].z))*(tolB + 16.0*eps);
+
+        b1x = -e2y/uz; b1y = e2x/uz; b1c = -(b1x*pts[0].x + b1y*pts[0].y);
+        b2x =  e1y/uz; b2y = -e1x/uz; b2c = -(b2x*pts[0].x + b2y*pts[0].y);
+        const double dz1 = pts[1].z - pts[0].z, dz2 = pts[2].z - pts[0].z;
+        zx = dz1*b1x + dz2*b2x; zy = dz1*b1y + dz2*b2y; zc = pts[0].z + dz1*b1c + dz2*b2c;
+    }
+
+    // строка y: [x0, x1] - пиксели, которые могут быть покрыты, [in0, in1] - покрыты
+    // наверняка (пустой, если in0 > in1). false - строка пуста
+    bool row(int y, int xmin, int xmax, int& x0, int& x1, int& in0, int& in1) const {
+        const double a1 = b1x, c1 = b1y*y + b1c, a2 = b2x, c2 = b2y*y + b2c;
+        const double a[3] = { a1, a2, -a1 - a2 };
+        const double c[3] = { c1, c2, 1.0 - c1 - c2 };
+        double lo = xmin, hi = xmax, loIn = xmin, hiIn = xmax;
+        for (int i=0; i<3; i++) {
+            if (a[i] > 0) {
+                lo   = std::max(lo,   (-tolB - c[i]) / a[i]);
+                loIn = std::max(loIn, ( tolB - c[i]) / a[i]);
+            } else if (a[i] < 0) {
+                hi   = std::min(hi,   (-tolB - c[i]) / a[i]);
+                hiIn = std::min(hiIn, ( tolB - c[i]) / a[i]);
+            } else {
+                if (c[i] < -tolB) return false;
+                if (c[i] < tolB) { loIn = 1; hiIn = 0; }
+            }
+        }
+        if (lo > hi) return false;
+        x0 = std::max(xmin, (int)std::floor(lo));
+        x1 = std::min(xmax, (int)std::ceil(hi));
+        in0 = loIn > hiIn ? 1 : (int)std::floor(loIn) + 1;
+        in1 = loIn > hiIn ? 0 : (int)std::ceil(hiIn) - 1;
+        return x0 <= x1;
+    }
+};
+} // namespace
+
+void triangle_alpha_ztest(Vec3f* pts, TGAImage& img, const TGAColor& col, float alpha, const float* zbuf) {
+    const int width = img.get_width(), height = img.get_height();
+    Vec2i bmin(width-1, height-1), bmax(0,0);
+    for(int i=0;i<3;i++){
+        bmin.x = std::max(0, std::min(bmin.x, (int)pts[i].x));
+        bmin.y = std::max(0, std::min(bmin.y, (int)pts[i].y));
+        bmax.x = std::min(width-1, std::max(bmax.x, (int)pts[i].x));
+        bmax.y = std::min(height-1, std::max(bmax.y, (int)pts[i].y));
+    }
+    CG3_COUNT(TrianglesSubmitted, 1);
+    if (culled(pts, bmin, bmax)) { CG3_COUNT(TrianglesCulled, 1); return; }
+    int tested = 0, blended = 0;
+
+    // смешивание зависит только от байта цели: таблица на канал
+    uint8_t lut[3][256];
+    for (int v=0; v<256; v++) {
+        TGAColor c = blend_over(TGAColor((uint8_t)v, (uint8_t)v, (uint8_t)v), col, alpha);
+        lut[0][v] = c.bgra[0]; lut[1][v] = c.bgra[1]; lut[2][v] = c.bgra[2];
+    }
+    const int bpp = img.get_bytespp();
+    uint8_t* pixels = img.buffer();
+    auto blend = [&](int idx) {
+        uint8_t* px = pixels + (size_t)idx*bpp;
+        px[0] = lut[0][px[0]]; px[1] = lut[1][px[1]]; px[2] = lut[2][px[2]];
+        if (bpp == 4) px[3] = 255;
+        blended++;
+    };
+
+    const AlphaRaster r(pts, bmin, bmax);
+    for(int y=bmin.y; y<=bmax.y; y++){
+        int x0 = bmin.x, x1 = bmax.x, in0 = 1, in1 = 0;
+        if (!r.exactOnly && !r.row(y, bmin.x, bmax.x, x0, x1, in0, in1)) continue;
+        const double zRow = r.zy*y + r.zc;
+        for(int x=x0; x<=x1; x++){
+            int idx = x + y*width;
+            if (x >= in0 && x <= in1) {
+                tested++;
+                const double dz = r.zx*x + zRow - zbuf[idx];
+                if (dz > r.zTol) { blend(idx); continue; }
+                if (dz < -r.zTol) continue;
+            }
+            Vec3f bc = barycentric(pts, Vec3f((float)x,(float)y,0));
+            if(bc.x<0 || bc.y<0 || bc.z<0) continue;
+
+            float z = pts[0].z*bc.x + pts[1].z*bc.y + pts[2].z*bc.z;
+            if (x < in0 || x > in1) tested++;
+
+            if (z > zbuf[idx]) blend(idx);
+        }
+    }
+    CG3_COUNT(PixelsTested, tested);
+    CG3_COUNT(PixelsBlended, blended);
+}
+
+
+
+void build_cube_faces(std::vector<Face>& faces) {
+    faces.clear();
+
+    
+    faces.push_back({0,1,2,3,0,false,1.0f}); 
+    faces.push_back({4,5,6,7,0,false,1.0f});  
+    faces.push_back({0,1,5,4,0,false,0.25f}); 
+    faces.push_back({2,3,7,6,0,false,1.0f});  
+    faces.push_back({1,2,6,5,0,false,1.0f});  
+    faces.push_back({0,3,7,4,0,false,1.0f});  
+}
+
+Vec3f face_normal_world(const Vec3f& a, const Vec3f& b, const Vec3f& c) {
+    return normalize(cross(b-a, c-a));
+}
+
+
+void draw_cube_pass_ztest(TGAImage& img,
+                          std::span<const Vec3f> Vs,
+                          std::span<const Face> cubeFaces,
+                          bool wantFront,
+                          const TGAColor& col,
+                          float alpha,
+                          const float* zbuf) {
+    ArenaScope scope;
+    std::span<Face> faces = scope.arena().copy(cubeFaces);
+    for (auto& f : faces) {
+        f.z = (Vs[f.a].z + Vs[f.b].z + Vs[f.c].z + Vs[f.d].z) * 0.25f;
+    }
+
+    
+    std::sort(faces.begin(), faces.end(), [](const Face& x, const Face& y){
+        return x.z < y.z;
+    });
+
+    for (const auto& f : faces) {
+        if (f.front != wantFront) continue;
+
+        Vec3f p0 = Vs[f.a], p1 = Vs[f.b], p2 = Vs[f.c], p3 = Vs[f.d];
+        Vec3f t1[3] = { p0, p1, p2 };
+        Vec3f t2[3] = { p0, p2, p3 };
+
+        float a = alpha * f.alphaMul; 
+
+        triangle_alpha_ztest(t1, img, col, a, zbuf);
+        triangle_alpha_ztest(t2, img, col, a, zbuf);
+    }
+}
+
+
+void line(Vec2i p0, Vec2i p1, TGAImage& image, const TGAColor& color) {
+    bool steep = false;
+    if (std::abs(p0.x - p1.x) < std::abs(p0.y - p1.y)) {
+        std::swap(p0.x, p0.y);
+        std::swap(p1.x, p1.y);
+        steep = true;
+    }
+    if (p0.x > p1.x) std::swap(p0, p1);
+
+    int dx = p1.x - p0.x;
+    int dy = std::abs(p1.y - p0.y);
+    int err = dx / 2;
+    int y = p0.y;
+    int ystep = (p0.y < p1.y) ? 1 : -1;
+
+    for (int x = p0.x; x <= p1.x; x++) {
+        if (steep) image.set(y, x, color);
+        else       image.set(x, y, color);
+
+        err -= dy;
+        if (err < 0) { y += ystep; err += dx; }
+    }
+}
+
+void drawCubeEdges(const std::vector<Vec3f>& cubeS, TGAImage& image, const TGAColor& color,
+                   Vec2i origin) {
+    static const int E[12][2] = {
+        {0,1},{1,2},{2,3},{3,0},
+        {4,5},{5,6},{6,7},{7,4},
+        {0,4},{1,5},{2,6},{3,7}
+    };
+
+    for (int i=0;i<12;i++) {
+        int a = E[i][0];
+        int b = E[i][1];
+        Vec2i p0((int)cubeS[a].x - origin.x, (int)cubeS[a].y - origin.y);
+        Vec2i p1((int)cubeS[b].x - origin.x, (int)cubeS[b].y - origin.y);
+        line(p0, p1, image, color);
+    }
+}
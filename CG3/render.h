@@ -0,0 +1,48 @@
+#pragma once
+#include <span>
+#include <vector>
+#include "geometry.h"
+#include "tgaimage.h"
+#include "shading_rate.h"
+
+// растеризация CG3: размеры цели берутся из img, zbuf - width*height float
+
+TGAColor blend_over(const TGAColor& dst, const TGAColor& src, float a);
+
+// проекция вершины в экран width x height, z = расстояние вдоль взгляда
+Vec3f project_to_screen(const Vec3f& v_world, const Mat4& V, const Mat4& P, int width, int height);
+
+// текстурированный треугольник с z-тестом и записью глубины.
+// rates != nullptr - грубый шейдинг: выборка текстуры один раз на блок rate x rate,
+// глубина и покрытие попиксельно. Возвращает число вызовов "шейдера".
+int triangle_textured(Vec3f* pts, Vec2f* uv, TGAImage& img, const TGAImage& tex, float* zbuf,
+                      const ShadingRateImage* rates = nullptr);
+
+// полупрозрачный треугольник, z-тест без записи глубины
+void triangle_alpha_ztest(Vec3f* pts, TGAImage& img, const TGAColor& col, float alpha, const float* zbuf);
+
+// грань куба
+struct Face {
+    int a,b,c,d;
+    float z;
+    bool front;
+    float alphaMul;
+};
+
+void build_cube_faces(std::vector<Face>& faces);
+Vec3f face_normal_world(const Vec3f& a, const Vec3f& b, const Vec3f& c);
+
+// faces сортируются по глубине в копии на арене кадра потока
+void draw_cube_pass_ztest(TGAImage& img,
+                          std::span<const Vec3f> Vs,
+                          std::span<const Face> faces,
+                          bool wantFront,
+                          const TGAColor& col,
+                          float alpha,
+                          const float* zbuf);
+
+void line(Vec2i p0, Vec2i p1, TGAImage& image, const TGAColor& color);
+// origin - угол цели в координатах полного кадра, вычитается после округления,
+// чтобы линии в полосах и регионах совпадали с полным кадром
+void drawCubeEdges(const std::vector<Vec3f>& cubeS, TGAImage& image, const TGAColor& color,
+                   Vec2i origin = Vec2i());
@@ -0,0 +1,126 @@
+#include "scene.h"
+#include "frame_arena.h"
+#include "profiler.h"
+#include <algorithm>
+#include <limits>
+
+void project_head(const IndexedMesh& mesh, float headScale, const Mat4& V, const Mat4& P,
+                  int width, int height, HeadGeometry& out, const int* indices, int count) {
+    CG3_ZONE("project_head");
+    if (!indices) { indices = mesh.indices.data(); count = (int)mesh.indices.size(); }
+
+    ArenaScope scope;
+    std::span<Vec3f> screen = scope.arena().alloc<Vec3f>(mesh.nverts());
+    for (int i=0; i<mesh.nverts(); i++)
+        screen[i] = project_to_screen(head_to_world(mesh.pos[i], headScale), V, P, width, height);
+
+    out.pts.resize(count);
+    out.uv.resize(count);
+    for (int k=0; k<count; k++) {
+        int i = indices[k];
+        out.pts[k] = screen[i];
+        out.uv[k]  = mesh.uv[i];
+    }
+}
+
+long long draw_head(const HeadGeometry& head, const TGAImage& tex, TGAImage& img, float* zbuf,
+                    const ShadingRateImage* rates) {
+    CG3_ZONE("draw_head");
+    long long shaded = 0;
+    for (int i=0; i<head.nfaces(); i++) {
+        Vec3f pts[3] = { head.pts[i*3], head.pts[i*3+1], head.pts[i*3+2] };
+        Vec2f uv[3]  = { head.uv[i*3],  head.uv[i*3+1],  head.uv[i*3+2] };
+        shaded += triangle_textured(pts, uv, img, tex, zbuf, rates);
+    }
+    return shaded;
+}
+
+long long draw_head_faces(const HeadGeometry& head, const int* faces, int count,
+                          const TGAImage& tex, TGAImage& img, float* zbuf, Vec2i origin) {
+    CG3_ZONE("draw_head_faces");
+    const Vec3f o((float)origin.x, (float)origin.y, 0.f);
+    long long shaded = 0;
+    for (int k=0; k<count; k++) {
+        int i = faces[k];
+        Vec3f pts[3] = { head.pts[i*3] - o, head.pts[i*3+1] - o, head.pts[i*3+2] - o };
+        Vec2f uv[3]  = { head.uv[i*3],      head.uv[i*3+1],      head.uv[i*3+2] };
+        shaded += triangle_textured(pts, uv, img, tex, zbuf);
+    }
+    return shaded;
+}
+
+void CubeOverlay::build(const Vec3f& C, float cubeSize, const Camera& cam,
+                        const Mat4& V, const Mat4& P, int width, int height) {
+    CG3_ZONE("cube_build");
+    world = {
+        C + Vec3f(-cubeSize,-cubeSize,-cubeSize),
+        C + Vec3f( cubeSize,-cubeSize,-cubeSize),
+        C + Vec3f( cubeSize, cubeSize,-cubeSize),
+        C + Vec3f(-cubeSize, cubeSize,-cubeSize),
+        C + Vec3f(-cubeSize,-cubeSize, cubeSize),
+        C + Vec3f( cubeSize,-cubeSize, cubeSize),
+        C + Vec3f( cubeSize, cubeSize, cubeSize),
+        C + Vec3f(-cubeSize, cubeSize, cubeSize)
+    };
+
+    screen.resize(8);
+    for(int i=0;i<8;i++) screen[i] = project_to_screen(world[i], V, P, width, height);
+
+    build_cube_faces(faces);
+    for (auto& f : faces) {
+        Vec3f a = world[f.a], b = world[f.b], c = world[f.c];
+        Vec3f n = face_normal_world(a,b,c);
+        Vec3f center = (world[f.a] + world[f.b] + world[f.c] + world[f.d]) * 0.25f;
+        Vec3f toCam = normalize(cam.eye - center);
+        f.front = (dot(n, toCam) > 0.f);
+    }
+}
+
+// вершины куба в координатах цели, на арене вызывающего
+static std::span<const Vec3f> to_target(FrameArena& arena, const std::vector<Vec3f>& screen, Vec2i origin) {
+    std::span<Vec3f> s = arena.copy(std::span<const Vec3f>(screen));
+    for (auto& v : s) { v.x -= (float)origin.x; v.y -= (float)origin.y; }
+    return s;
+}
+
+void draw_cube_under(const CubeOverlay& cube, TGAImage& img, const float* zbuf, Vec2i origin) {
+    CG3_ZONE("cube_under");
+    ArenaScope scope;
+    draw_cube_pass_ztest(img, to_target(scope.arena(), cube.screen, origin), cube.faces, false, cube.color, cube.alphaBack, zbuf);
+}
+
+void draw_cube_over(const CubeOverlay& cube, TGAImage& img, const float* zbuf, Vec2i origin) {
+    CG3_ZONE("cube_over");
+    ArenaScope scope;
+    draw_cube_pass_ztest(img, to_target(scope.arena(), cube.screen, origin), cube.faces, true, cube.color, cube.alphaFront, zbuf);
+    drawCubeEdges(cube.screen, img, cube.edge, origin);
+}
+
+void render_region(const HeadGeometry& head, const TGAImage& tex, const CubeOverlay& cube,
+                   const Region& r, TGAImage& img, float* zbuf,
+                   const int* faces, int count) {
+    CG3_ZONE("render_region");
+    const Vec2i origin(r.x0, r.y0);
+    img = TGAImage(r.w, r.h, TGAImage::RGB);
+    std::fill(zbuf, zbuf + (size_t)r.w*r.h, -std::numeric_limits<float>::max());
+
+    ArenaScope scope;
+    FrameVector<int> visible{ ArenaAllocator<int>(scope.arena()) };
+    if (!faces) {
+        visible.reserve(head.nfaces());
+        for (int i=0; i<head.nfaces(); i++) {
+            const Vec3f* p = &head.pts[i*3];
+            float xmin = std::min({p[0].x, p[1].x, p[2].x}), xmax = std::max({p[0].x, p[1].x, p[2].x});
+            float ymin = std::min({p[0].y, p[1].y, p[2].y}), ymax = std::max({p[0].y, p[1].y, p[2].y});
+            if (xmax < (float)(r.x0 - 1) || ymax < (float)(r.y0 - 1) ||
+                xmin > (float)(r.x0 + r.w) || ymin > (float)(r.y0 + r.h)) continue;
+            visible.push_back(i);
+        }
+        faces = visible.data();
+        count = (int)visible.size();
+    }
+
+    draw_cube_under(cube, img, zbuf, origin);
+    draw_head_faces(head, faces, count, tex, img, zbuf, origin);
+    draw_cube_over(cube, img, zbuf, origin);
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <vector>
+#include "geometry.h"
+#include "tgaimage.h"
+#include "model.h"
+#include "mesh_index.h"
+#include "render.h"
+
+// сцена CG3: текстурированная голова и полупрозрачный куб с рёбрами поверх неё
+
+// вершина головы в мировых координатах (модель развёрнута к камере)
+inline Vec3f head_to_world(const Vec3f& v, float headScale) {
+    Vec3f s = v * headScale;
+    return Vec3f(-s.x, s.y, -s.z);
+}
+
+// экранные треугольники головы, 3 вершины на грань
+struct HeadGeometry {
+    std::vector<Vec3f> pts;
+    std::vector<Vec2f> uv;
+
+    int nfaces() const { return (int)pts.size() / 3; }
+};
+
+// каждая уникальная вершина проецируется один раз, затем раздаётся по углам.
+// indices == nullptr - индексы меша, иначе свои (уровень LOD над теми же вершинами)
+void project_head(const IndexedMesh& mesh, float headScale, const Mat4& V, const Mat4& P,
+                  int width, int height, HeadGeometry& out,
+                  const int* indices = nullptr, int count = 0);
+
+// возвращает число вызовов шейдера
+long long draw_head(const HeadGeometry& head, const TGAImage& tex, TGAImage& img, float* zbuf,
+                    const ShadingRateImage* rates = nullptr);
+
+// часть кадра: только грани из списка, цель img начинается в точке origin полного кадра.
+// Сдвиг на целое точен во float, поэтому пиксели совпадают с полным рендером.
+long long draw_head_faces(const HeadGeometry& head, const int* faces, int count,
+                          const TGAImage& tex, TGAImage& img, float* zbuf, Vec2i origin);
+
+struct CubeOverlay {
+    std::vector<Vec3f> world;
+    std::vector<Vec3f> screen;
+    std::vector<Face>  faces;
+
+    TGAColor color = TGAColor(50, 130, 255, 255);
+    TGAColor edge  = TGAColor(15, 70, 190, 255);
+    float alphaBack  = 0.10f;
+    float alphaFront = 0.22f;
+
+    void build(const Vec3f& center, float size, const Camera& cam,
+               const Mat4& V, const Mat4& P, int width, int height);
+};
+
+// задние грани - под головой, передние грани и рёбра - поверх
+void draw_cube_under(const CubeOverlay& cube, TGAImage& img, const float* zbuf, Vec2i origin = Vec2i());
+void draw_cube_over(const CubeOverlay& cube, TGAImage& img, const float* zbuf, Vec2i origin = Vec2i());
+
+// прямоугольник полного кадра
+struct Region {
+    int x0 = 0, y0 = 0;
+    int w = 0, h = 0;
+};
+
+// Рендер только региона кадра: голова и куб спроецированы в полный кадр,
+// img получает r.w x r.h пикселей, zbuf - r.w*r.h значений.
+// faces == nullptr - берутся все грани, задевающие регион.
+void render_region(const HeadGeometry& head, const TGAImage& tex, const CubeOverlay& cube,
+                   const Region& r, TGAImage& img, float* zbuf,
+                   const int* faces = nullptr, int count = 0);
@@ -0,0 +1,139 @@
+#include "shading_rate.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+ShadingRateImage::ShadingRateImage(int w, int h, int tileSize, int fill)
+    : tile(std::max(4, tileSize & ~3)) {
+    tilesX = (w + tile - 1) / tile;
+    tilesY = (h + tile - 1) / tile;
+    rate.assign((size_t)tilesX*tilesY, (uint8_t)fill);
+}
+
+void ShadingRateImage::fill(int r) {
+    std::fill(rate.begin(), rate.end(), (uint8_t)r);
+}
+
+void ShadingRateImage::histogram(float out[3]) const {
+    out[0] = out[1] = out[2] = 0.f;
+    if (rate.empty()) return;
+    for (uint8_t r : rate) out[r==1 ? 0 : (r==2 ? 1 : 2)] += 1.f;
+    for (int i=0;i<3;i++) out[i] /= (float)rate.size();
+}
+
+static float luma(const TGAColor& c) {
+    return 0.299f*c.bgra[2] + 0.587f*c.bgra[1] + 0.114f*c.bgra[0];
+}
+
+TextureVariance::TextureVariance(const TGAImage& tex, int block)
+    : block_(std::max(1, block)), texW_(tex.get_width()), texH_(tex.get_height()) {
+    gw_ = (texW_ + block_ - 1) / block_;
+    gh_ = (texH_ + block_ - 1) / block_;
+    stddev_.assign((size_t)gw_*gh_, 0.f);
+
+    for (int gy=0; gy<gh_; gy++) {
+        for (int gx=0; gx<gw_; gx++) {
+            double s = 0, s2 = 0;
+            int n = 0;
+            for (int y=gy*block_; y<std::min(texH_, (gy+1)*block_); y++) {
+                for (int x=gx*block_; x<std::min(texW_, (gx+1)*block_); x++) {
+                    float l = luma(tex.get(x,y));
+                    s += l; s2 += (double)l*l; n++;
+                }
+            }
+            double mean = n ? s/n : 0.0;
+            double var  = n ? s2/n - mean*mean : 0.0;
+            stddev_[gy*gw_ + gx] = (float)std::sqrt(std::max(0.0, var));
+        }
+    }
+}
+
+float TextureVariance::max_stddev(Vec2f uvmin, Vec2f uvmax) const {
+    if (stddev_.empty()) return 0.f;
+    // та же адресация, что и в triangle_textured
+    auto tx = [&](float u){ return std::clamp((int)(u * (texW_-1)), 0, texW_-1) / block_; };
+    auto ty = [&](float v){ return std::clamp((int)((1.f-v) * (texH_-1)), 0, texH_-1) / block_; };
+    int x0 = tx(uvmin.x), x1 = tx(uvmax.x);
+    int y0 = ty(uvmax.y), y1 = ty(uvmin.y);
+
+    float m = 0.f;
+    for (int y=y0; y<=y1; y++)
+        for (int x=x0; x<=x1; x++)
+            m = std::max(m, stddev_[y*gw_ + x]);
+    return m;
+}
+
+ShadingRateImage build_shading_rate(const Vec3f* pts, int nfaces, int width, int height,
+                                    const std::vector<float>& faceTexStd,
+                                    const std::vector<float>& faceSlope,
+                                    const VrsParams& params) {
+    // пустой тайл шейдить нечего
+    ShadingRateImage sri(width, height, params.tile, 4);
+    const size_t n = sri.rate.size();
+    std::vector<float> texStd(n, 0.f), slope(n, std::numeric_limits<float>::max());
+    std::vector<uint8_t> covered(n, 0);
+
+    for (int i=0; i<nfaces; i++) {
+        const Vec3f* p = &pts[i*3];
+        // голова замкнута: задние грани закрыты лицевыми
+        float area = (p[2].x-p[0].x)*(p[1].y-p[0].y) - (p[1].x-p[0].x)*(p[2].y-p[0].y);
+        if (area < 0.f) continue;
+        int x0 = std::max(0, (int)std::min({p[0].x, p[1].x, p[2].x}));
+        int y0 = std::max(0, (int)std::min({p[0].y, p[1].y, p[2].y}));
+        int x1 = std::min(width-1,  (int)std::max({p[0].x, p[1].x, p[2].x}));
+        int y1 = std::min(height-1, (int)std::max({p[0].y, p[1].y, p[2].y}));
+        if (x0 > x1 || y0 > y1) continue;
+
+        for (int ty=y0/sri.tile; ty<=y1/sri.tile; ty++) {
+            for (int tx=x0/sri.tile; tx<=x1/sri.tile; tx++) {
+                size_t t = (size_t)ty*sri.tilesX + tx;
+                covered[t] = 1;
+                texStd[t] = std::max(texStd[t], faceTexStd[i]);
+                slope[t]  = std::min(slope[t], faceSlope[i]);
+            }
+        }
+    }
+
+    for (size_t t=0; t<n; t++) {
+        if (!covered[t]) continue;
+        int rTex   = texStd[t] < params.flat4 ? 4 : (texStd[t] < params.flat2 ? 2 : 1);
+        int rSlope = slope[t] > params.grazing4 ? 4 : (slope[t] > params.grazing2 ? 2 : 1);
+        sri.rate[t] = (uint8_t)std::max(rTex, rSlope);
+    }
+    return sri;
+}
+
+float depth_slope(const Vec3f* pts) {
+    Vec3f e1 = pts[1] - pts[0];
+    Vec3f e2 = pts[2] - pts[0];
+    float det = e1.x*e2.y - e2.x*e1.y;
+    if (std::abs(det) < 1e-6f) return std::numeric_limits<float>::max(); // ребром к камере
+
+    float dzdx = (e1.z*e2.y - e2.z*e1.y) / det;
+    float dzdy = (e1.x*e2.z - e2.x*e1.z) / det;
+    float z = std::abs(pts[0].z + pts[1].z + pts[2].z) / 3.f;
+    if (z < 1e-6f) return 0.f;
+    return std::sqrt(dzdx*dzdx + dzdy*dzdy) / z;
+}
+
+ImageError image_error(const TGAImage& ref, const TGAImage& img) {
+    ImageError e;
+    int w = std::min(ref.get_width(), img.get_width());
+    int h = std::min(ref.get_height(), img.get_height());
+    double se = 0;
+    long long n = 0;
+    for (int y=0; y<h; y++) {
+        for (int x=0; x<w; x++) {
+            TGAColor a = ref.get(x,y), b = img.get(x,y);
+            for (int c=0;c<3;c++) {
+                int d = std::abs((int)a.bgra[c] - (int)b.bgra[c]);
+                e.maxDiff = std::max(e.maxDiff, d);
+                se += (double)d*d;
+                n++;
+            }
+        }
+    }
+    e.rmse = n ? std::sqrt(se / n) : 0.0;
+    e.psnr = e.rmse > 0 ? 20.0*std::log10(255.0 / e.rmse) : std::numeric_limits<double>::infinity();
+    return e;
+}
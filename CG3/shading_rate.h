@@ -0,0 +1,72 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "geometry.h"
+#include "tgaimage.h"
+
+// Программный variable-rate shading:
+// для каждого тайла экрана задаётся, как часто вызывать "шейдер" (выборку текстуры):
+// 1 - каждый пиксель, 2 - один раз на блок 2x2, 4 - один раз на блок 4x4.
+// Глубина и покрытие при этом всегда считаются попиксельно.
+
+struct ShadingRateImage {
+    int tile = 16;        // размер тайла в пикселях, кратен 4
+    int tilesX = 0;
+    int tilesY = 0;
+    std::vector<uint8_t> rate;
+
+    ShadingRateImage() = default;
+    ShadingRateImage(int w, int h, int tileSize = 16, int fill = 1);
+
+    int at(int x, int y) const { return rate[(y/tile)*tilesX + x/tile]; }
+    void set_tile(int tx, int ty, int r) { rate[ty*tilesX + tx] = (uint8_t)r; }
+    void fill(int r);
+
+    // доля площади экрана с rate 1/2/4
+    void histogram(float out[3]) const;
+};
+
+// пороги автоматического выбора скорости
+struct VrsParams {
+    int   tile      = 16;
+    float flat2     = 10.f;   // СКО яркости текстуры под треугольником (0..255), ниже - 2x2
+    float flat4     = 4.f;    // ниже - 4x4
+    float grazing2  = 0.02f;  // относительный наклон глубины на пиксель, выше - 2x2
+    float grazing4  = 0.05f;  // выше - 4x4
+};
+
+// СКО яркости текстуры по блокам texel-ов, считается один раз на текстуру
+class TextureVariance {
+public:
+    explicit TextureVariance(const TGAImage& tex, int block = 16);
+
+    // максимум СКО по блокам, которые задевает uv-прямоугольник
+    float max_stddev(Vec2f uvmin, Vec2f uvmax) const;
+
+private:
+    int block_ = 16;
+    int gw_ = 0, gh_ = 0;
+    int texW_ = 0, texH_ = 0;
+    std::vector<float> stddev_;
+};
+
+// скорость по лицевым треугольникам, рамка которых задевает тайл:
+// плоская текстура под всеми или скользящий угол -> грубее.
+// Без предпрохода видимости: закрытая лицевая грань может только измельчить тайл,
+// а карта стоит обход граней вместо второй растеризации и буфера id на кадр.
+// pts - по 3 экранные вершины на грань, как в HeadGeometry
+ShadingRateImage build_shading_rate(const Vec3f* pts, int nfaces, int width, int height,
+                                    const std::vector<float>& faceTexStd,
+                                    const std::vector<float>& faceSlope,
+                                    const VrsParams& params);
+
+// относительный наклон глубины треугольника в экранных координатах: |grad z| / z
+float depth_slope(const Vec3f* pts);
+
+// ошибка грубого шейдинга относительно эталона
+struct ImageError {
+    double rmse = 0;
+    double psnr = 0;
+    int    maxDiff = 0;
+};
+ImageError image_error(const TGAImage& ref, const TGAImage& img);
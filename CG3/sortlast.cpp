@@ -0,0 +1,128 @@
+#include "sortlast.h"
+#include "frame_arena.h"
+#include "profiler.h"
+#include <algorithm>
+#include <barrier>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// больше потоков, чем кусков работы на кадр, только добавляет слоёв и барьеров
+constexpr int kMaxWorkers = 32;
+
+// личный буфер потока: цвет и глубина только в рамке его граней
+struct Layer {
+    int x0 = 0, y0 = 0, w = 0, h = 0;
+    TGAImage color;
+    std::vector<float> depth;
+};
+
+using Clock = std::chrono::steady_clock;
+
+double ms_between(Clock::time_point a, Clock::time_point b) {
+    return std::chrono::duration<double, std::milli>(b - a).count();
+}
+
+// рамка граней [f0, f1) в пикселях кадра, та же обрезка, что у bbox в растеризаторе
+void face_bounds(const HeadGeometry& head, int f0, int f1, int width, int height, Layer& L) {
+    int x0 = width, y0 = height, x1 = -1, y1 = -1;
+    for (int i=f0*3; i<f1*3; i++) {
+        const Vec3f& p = head.pts[i];
+        x0 = std::min(x0, std::max(0, (int)p.x));
+        y0 = std::min(y0, std::max(0, (int)p.y));
+        x1 = std::max(x1, std::min(width-1, (int)p.x));
+        y1 = std::max(y1, std::min(height-1, (int)p.y));
+    }
+    L.x0 = x0; L.y0 = y0;
+    L.w = std::max(0, x1 - x0 + 1);
+    L.h = std::max(0, y1 - y0 + 1);
+}
+
+} // namespace
+
+void render_sort_last(const HeadGeometry& head, const TGAImage& tex, int workers,
+                      TGAImage& img, float* zbuf, SortLastStats* stats) {
+    const int w = img.get_width(), h = img.get_height();
+    const int nf = head.nfaces();
+    const int n = std::clamp(workers, 1, kMaxWorkers);
+    const float clear = -std::numeric_limits<float>::max();
+    auto t0 = Clock::now();
+
+    // один поток: слой и сборка ничего не дают, это draw_head
+    if (n == 1) {
+        draw_head(head, tex, img, zbuf);
+        if (stats) {
+            stats->rasterMs = stats->totalMs = ms_between(t0, Clock::now());
+            stats->compositeMs = 0;
+        }
+        return;
+    }
+
+    // собирать имеет смысл только строки, которые задевает голова
+    float ymin = (float)h, ymax = -1.f;
+    for (const Vec3f& p : head.pts) { ymin = std::min(ymin, p.y); ymax = std::max(ymax, p.y); }
+    const int firstRow = std::clamp((int)ymin, 0, h);
+    const int lastRow  = std::clamp((int)ymax + 1, 0, h);
+
+    std::vector<Layer> layers(n);
+    std::vector<Clock::time_point> rasterDone(n);
+
+    std::barrier sync(n);
+    auto worker = [&](int k) {
+        Layer& L = layers[k];
+        const int f0 = (int)((long long)nf*k / n), f1 = (int)((long long)nf*(k+1) / n);
+        face_bounds(head, f0, f1, w, h, L);
+        if (L.w > 0 && L.h > 0) {
+            L.color = TGAImage(L.w, L.h, TGAImage::RGB);
+            L.depth.assign((size_t)L.w*L.h, clear);
+
+            ArenaScope scope;
+            std::span<int> faces = scope.arena().alloc<int>(f1 - f0);
+            for (int i=f0; i<f1; i++) faces[i - f0] = i;
+            draw_head_faces(head, faces.data(), (int)faces.size(), tex, L.color, L.depth.data(), Vec2i(L.x0, L.y0));
+        }
+        rasterDone[k] = Clock::now();
+        sync.arrive_and_wait();
+
+        // каждый поток собирает свою полосу строк кадра из всех слоёв, задевающих её.
+        // Слои по порядку кусков и строгое "больше": при равной глубине остаётся
+        // более ранний кусок, как в последовательном draw_head
+        CG3_ZONE("sortlast_composite");
+        const int r0 = firstRow + (int)((long long)(lastRow - firstRow)*k / n);
+        const int r1 = firstRow + (int)((long long)(lastRow - firstRow)*(k+1) / n);
+        const int bpp = img.get_bytespp();
+        for (const Layer& S : layers) {
+            const int y0 = std::max(r0, S.y0), y1 = std::min(r1, S.y0 + S.h);
+            const uint8_t* sc = S.color.buffer();
+            for (int y=y0; y<y1; y++) {
+                const size_t srow = (size_t)(y - S.y0)*S.w;
+                const size_t drow = (size_t)y*w + S.x0;
+                for (int x=0; x<S.w; x++) {
+                    const float z = S.depth[srow + x];
+                    if (z > zbuf[drow + x]) {
+                        zbuf[drow + x] = z;
+                        std::memcpy(img.buffer() + (drow + x)*bpp, sc + (srow + x)*bpp, bpp);
+                    }
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int k=1; k<n; k++) pool.emplace_back(worker, k);
+    worker(0);
+    for (auto& th : pool) th.join();
+
+    if (stats) {
+        auto t1 = Clock::now();
+        auto rasterEnd = *std::max_element(rasterDone.begin(), rasterDone.end());
+        stats->rasterMs = ms_between(t0, rasterEnd);
+        stats->compositeMs = ms_between(rasterEnd, t1);
+        stats->totalMs = ms_between(t0, t1);
+    }
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "tgaimage.h"
+#include "scene.h"
+
+// Sort-last рендер головы: грани делятся на N подряд идущих кусков, каждый
+// поток растеризует свой кусок в личные цвет и глубину размером с рамку
+// своих граней, затем каждый поток собирает свою полосу строк кадра из всех
+// слоёв по глубине. При равной глубине побеждает более ранний кусок, поэтому
+// результат совпадает с последовательным draw_head бит в бит. Потоков не
+// больше 32; один поток рисует прямо в кадр.
+
+struct SortLastStats {
+    double rasterMs    = 0;
+    double compositeMs = 0;
+    double totalMs     = 0;
+};
+
+// как draw_head: пиксели головы проходят тест глубины по zbuf и пишутся в img и zbuf
+void render_sort_last(const HeadGeometry& head, const TGAImage& tex, int workers,
+                      TGAImage& img, float* zbuf, SortLastStats* stats = nullptr);
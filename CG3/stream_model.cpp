@@ -0,0 +1,193 @@
+#include "stream_model.h"
+#include "profiler.h"
+#include "render.h"
+#include "scene.h"
+#include "../shared/obj_tokens.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+struct StoreHeader {
+    char     magic[4] = {'C','G','S','1'};
+    uint32_t version  = 1;
+    uint64_t nverts = 0, nuv = 0, ntris = 0;
+    float    bbmin[3] = {0,0,0};
+    float    bbmax[3] = {0,0,0};
+};
+
+// буфер записи фиксированного размера
+template<class T>
+struct ChunkWriter {
+    std::ofstream out;
+    std::vector<T> buf;
+
+    explicit ChunkWriter(const std::string& path) : out(path, std::ios::binary) { buf.reserve(1 << 14); }
+    void push(const T& v) { buf.push_back(v); if (buf.size() == buf.capacity()) flush(); }
+    void flush() {
+        out.write((const char*)buf.data(), (std::streamsize)(buf.size()*sizeof(T)));
+        buf.clear();
+    }
+};
+
+struct Tri { int32_t i[6]; };
+
+} // namespace
+
+bool MeshStore::build_or_open(const std::string& objPath) {
+    namespace fs = std::filesystem;
+    base_ = objPath + ".store";
+    triPath_ = base_ + ".tri";
+
+    std::error_code ec;
+    auto hdrTime = fs::last_write_time(base_ + ".hdr", ec);
+    bool fresh = !ec;
+    auto objTime = fs::last_write_time(objPath, ec);
+    if (fresh && !ec && hdrTime >= objTime && open_store()) return true;
+
+    return build(objPath) && open_store();
+}
+
+bool MeshStore::build(const std::string& objPath) {
+    // отображённые страницы OBJ ОС может вытеснить, память остаётся ограниченной
+    MappedFile file;
+    if (!file.open(objPath)) {
+        std::cerr << "Cannot open OBJ: " << objPath << "\n";
+        return false;
+    }
+
+    ChunkWriter<Vec3f> pos(base_ + ".pos");
+    ChunkWriter<Vec2f> uvs(base_ + ".uv");
+    ChunkWriter<Tri>   tris(triPath_);
+
+    StoreHeader h;
+    Vec3f bmin( 1e9f, 1e9f, 1e9f);
+    Vec3f bmax(-1e9f,-1e9f,-1e9f);
+
+    const char* p = file.data();
+    const char* end = p + file.size();
+    std::vector<int32_t> v_idx, vt_idx;
+    while (p < end) {
+        const char* e = obj::line_end(p, end);
+        const char* s = obj::skip_ws(p, e);
+        p = e + 1;
+
+        if (obj::tag(s, e, "v")) {
+            Vec3f v;
+            obj::parse_float(s, e, v.x);
+            obj::parse_float(s, e, v.y);
+            obj::parse_float(s, e, v.z);
+            bmin = Vec3f(std::min(bmin.x, v.x), std::min(bmin.y, v.y), std::min(bmin.z, v.z));
+            bmax = Vec3f(std::max(bmax.x, v.x), std::max(bmax.y, v.y), std::max(bmax.z, v.z));
+            pos.push(v);
+            h.nverts++;
+        }
+        else if (obj::tag(s, e, "vt")) {
+            Vec2f t;
+            obj::parse_float(s, e, t.x);
+            obj::parse_float(s, e, t.y);
+            uvs.push(t);
+            h.nuv++;
+        }
+        else if (obj::tag(s, e, "f")) {
+            v_idx.clear(); vt_idx.clear();
+            long v, vt, vn;
+            while (obj::parse_corner(s, e, v, vt, vn)) {
+                v_idx.push_back(obj::fix_index(v, h.nverts));
+                vt_idx.push_back(vt ? obj::fix_index(vt, h.nuv) : 0);
+            }
+
+            for (size_t i=1; i+1 < v_idx.size(); i++) {
+                Tri t = {{ v_idx[0], vt_idx[0], v_idx[i], vt_idx[i], v_idx[i+1], vt_idx[i+1] }};
+                tris.push(t);
+                h.ntris++;
+            }
+        }
+    }
+    pos.flush(); uvs.flush(); tris.flush();
+
+    h.bbmin[0] = bmin.x; h.bbmin[1] = bmin.y; h.bbmin[2] = bmin.z;
+    h.bbmax[0] = bmax.x; h.bbmax[1] = bmax.y; h.bbmax[2] = bmax.z;
+
+    // заголовок пишется последним: его наличие означает целое хранилище
+    std::ofstream hdr(base_ + ".hdr", std::ios::binary);
+    hdr.write((const char*)&h, sizeof(h));
+    return (bool)hdr && (bool)pos.out && (bool)uvs.out && (bool)tris.out;
+}
+
+bool MeshStore::open_store() {
+    std::ifstream hdr(base_ + ".hdr", std::ios::binary);
+    StoreHeader h;
+    hdr.read((char*)&h, sizeof(h));
+    if (!hdr || std::memcmp(h.magic, "CGS1", 4) != 0 || h.version != 1) return false;
+
+    if (!pos_.open(base_ + ".pos") || !uvs_.open(base_ + ".uv")) return false;
+    if (pos_.size() != h.nverts*sizeof(Vec3f) || uvs_.size() != h.nuv*sizeof(Vec2f)) return false;
+    // .tri читается потоком и не отображается: обрезанный файл иначе дал бы часть головы без ошибки
+    std::error_code ec;
+    if (std::filesystem::file_size(triPath_, ec) != h.ntris*sizeof(Tri) || ec) return false;
+
+    nverts_ = h.nverts; nuv_ = h.nuv; ntris_ = h.ntris;
+    bbmin_ = Vec3f(h.bbmin[0], h.bbmin[1], h.bbmin[2]);
+    bbmax_ = Vec3f(h.bbmax[0], h.bbmax[1], h.bbmax[2]);
+    return true;
+}
+
+Vec3f MeshStore::vert(int64_t i) const {
+    if (i < 0 || (uint64_t)i >= nverts_) return Vec3f(0,0,0);
+    Vec3f v;
+    std::memcpy(&v, pos_.data() + i*sizeof(Vec3f), sizeof(Vec3f));
+    return v;
+}
+
+Vec2f MeshStore::uv(int64_t i) const {
+    if (i < 0 || (uint64_t)i >= nuv_) return Vec2f(0,0);
+    Vec2f t;
+    std::memcpy(&t, uvs_.data() + i*sizeof(Vec2f), sizeof(Vec2f));
+    return t;
+}
+
+bool render_streamed(const MeshStore& store, const TGAImage& tex, float headScale,
+                     const Mat4& V, const Mat4& P, TGAImage& img, float* zbuf,
+                     size_t budgetBytes, StreamStats* stats) {
+    CG3_ZONE("render_streamed");
+    auto t0 = std::chrono::steady_clock::now();
+
+    std::ifstream in(store.tri_path(), std::ios::binary);
+    if (!in) return false;
+
+    const size_t chunkTris = std::max<size_t>(1, budgetBytes / sizeof(Tri));
+    std::vector<Tri> chunk(chunkTris);
+
+    StreamStats st;
+    for (;;) {
+        in.read((char*)chunk.data(), (std::streamsize)(chunkTris*sizeof(Tri)));
+        size_t n = (size_t)in.gcount() / sizeof(Tri);
+        if (n == 0) break;
+        st.chunks++;
+
+        for (size_t k=0; k<n; k++) {
+            Vec3f pts[3];
+            Vec2f uv[3];
+            for (int j=0; j<3; j++) {
+                Vec3f v = head_to_world(store.vert(chunk[k].i[j*2]), headScale);
+                pts[j] = project_to_screen(v, V, P, img.get_width(), img.get_height());
+                uv[j]  = store.uv(chunk[k].i[j*2 + 1]);
+            }
+            triangle_textured(pts, uv, img, tex, zbuf);
+        }
+        st.tris += n;
+        if (n < chunkTris) break;
+    }
+
+    st.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    st.mbps = st.ms > 0 ? (st.tris*sizeof(Tri) / (1024.0*1024.0)) / (st.ms / 1000.0) : 0.0;
+    if (stats) *stats = st;
+    // ошибка чтения или файл изменился после open_store
+    return !in.bad() && st.tris == store.ntris();
+}
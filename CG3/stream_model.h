@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include "geometry.h"
+#include "tgaimage.h"
+#include "../shared/mapped_file.h"
+
+// Потоковая работа с OBJ больше оперативной памяти.
+// Один проход по OBJ раскладывает его в двоичное хранилище рядом с файлом:
+// .pos (Vec3f), .uv (Vec2f), .tri (6 int на треугольник: v,vt x3).
+// Вершины читаются через отображение файла, треугольники - блоками
+// в пределах бюджета памяти.
+
+class MeshStore {
+public:
+    // открывает готовое хранилище, если оно новее OBJ, иначе строит заново
+    bool build_or_open(const std::string& objPath);
+
+    uint64_t nverts() const { return nverts_; }
+    uint64_t nuv()    const { return nuv_; }
+    uint64_t ntris()  const { return ntris_; }
+    Vec3f bbmin() const { return bbmin_; }
+    Vec3f bbmax() const { return bbmax_; }
+
+    // те же правила для плохих индексов, что у Model
+    Vec3f vert(int64_t i) const;
+    Vec2f uv(int64_t i) const;
+
+    const std::string& tri_path() const { return triPath_; }
+
+private:
+    bool build(const std::string& objPath);
+    bool open_store();
+
+    std::string base_, triPath_;
+    uint64_t nverts_ = 0, nuv_ = 0, ntris_ = 0;
+    Vec3f bbmin_, bbmax_;
+    MappedFile pos_, uvs_;
+};
+
+struct StreamStats {
+    uint64_t tris   = 0;
+    int      chunks = 0;
+    double   ms     = 0;
+    double   mbps   = 0;   // скорость чтения треугольников
+};
+
+// растеризация головы блоками треугольников по budgetBytes в общий z-буфер;
+// false - .tri не открылся, не дочитан или короче ntris
+bool render_streamed(const MeshStore& store, const TGAImage& tex, float headScale,
+                     const Mat4& V, const Mat4& P, TGAImage& img, float* zbuf,
+                     size_t budgetBytes, StreamStats* stats = nullptr);
@@ -1,4 +1,5 @@
 #include "tgaimage.h"
+#include "profiler.h"
 #include <fstream>
 #include <cstring>
 #include <algorithm>
@@ -25,6 +26,7 @@ TGAImage::TGAImage(int w, int h, int bpp) : width(w), height(h), bytespp(bpp) {
 }
 
 bool TGAImage::read_tga_file(const std::string& filename) {
+    CG3_ZONE("read_tga");
     std::ifstream in(filename, std::ios::binary);
     if (!in) return false;
 
@@ -52,6 +54,7 @@ bool TGAImage::read_tga_file(const std::string& filename) {
 }
 
 bool TGAImage::write_tga_file(const std::string& filename) const {
+    CG3_ZONE("write_tga");
     std::ofstream out(filename, std::ios::binary);
     if (!out) return false;
 
@@ -102,3 +105,35 @@ void TGAImage::flip_vertically() {
         std::memcpy(bot, line.data(), bytes_per_line);
     }
 }
+
+bool TGAStreamWriter::open(const std::string& filename, int w, int h, int bpp) {
+    // размеры в заголовке 16-битные: больший кадр записался бы с обрезанными размерами
+    if (w <= 0 || h <= 0 || w > 0xFFFF || h > 0xFFFF || (bpp != 3 && bpp != 4)) return false;
+    out.open(filename, std::ios::binary);
+    if (!out) return false;
+    width = w; height = h; bytespp = bpp; written = 0;
+
+    TGAHeader header{};
+    header.datatypecode = 2;
+    header.width  = (uint16_t)width;
+    header.height = (uint16_t)height;
+    header.bitsperpixel = (uint8_t)(bytespp*8);
+    header.imagedescriptor = 0x00; // origin внизу
+
+    out.write((char*)&header, sizeof(header));
+    return (bool)out;
+}
+
+bool TGAStreamWriter::write_rows(const TGAImage& band, int rows) {
+    if (band.get_width() != width || band.get_bytespp() != bytespp) return false;
+    rows = std::min(rows, std::min(band.get_height(), height - written));
+    out.write((const char*)band.buffer(), (std::streamsize)((size_t)rows*width*bytespp));
+    written += rows;
+    return (bool)out;
+}
+
+bool TGAStreamWriter::close() {
+    bool ok = (bool)out && written == height;
+    out.close();
+    return ok;
+}
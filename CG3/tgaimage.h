@@ -2,6 +2,7 @@
 #include <cstdint>
 #include <vector>
 #include <string>
+#include <fstream>
 
 struct TGAColor {
     uint8_t bgra[4] = {0,0,0,255};
@@ -33,9 +34,32 @@ public:
 
     void flip_vertically();
 
+    const uint8_t* buffer() const { return data.data(); }
+    uint8_t* buffer() { return data.data(); }
+
 private:
     int width  = 0;
     int height = 0;
     int bytespp = 0; // 3 or 4
     std::vector<uint8_t> data;
 };
+
+// Потоковая запись TGA по полосам, весь кадр в памяти не нужен.
+// Строки пишутся снизу вверх (origin внизу), как их выдаёт растеризатор.
+class TGAStreamWriter {
+public:
+    // false - файл не открылся или w, h вне 1..65535, bpp не 3 и не 4
+    bool open(const std::string& filename, int w, int h, int bpp);
+    // первые rows строк band; ширина и формат должны совпадать
+    bool write_rows(const TGAImage& band, int rows);
+    bool close();
+
+    int rows_written() const { return written; }
+
+private:
+    std::ofstream out;
+    int width = 0;
+    int height = 0;
+    int bytespp = 0;
+    int written = 0;
+};
@@ -37,6 +37,7 @@ int App::Run()
             {
                 Update();
                 Draw();
+                UpdateFrameStats();
             }
             else
             {
@@ -75,6 +76,12 @@ LRESULT App::HandleMsg(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
         mInput.OnKeyDown(static_cast<uint8_t>(wParam));
         if(wParam == VK_ESCAPE)
             DestroyWindow(hwnd);
+        if(wParam == VK_F2)
+        {
+            // окно последних кадров - в рабочую папку
+            bool ok = mFrameStats.write_csv("frame_stats.csv") && mFrameStats.write_json("frame_stats.json");
+            OutputDebugStringW(ok ? L"[CG] frame_stats.csv/json записаны\n" : L"[CG] не удалось записать frame_stats\n");
+        }
         return 1;
 
     case WM_KEYUP:
@@ -147,6 +154,20 @@ void App::Update()
     mRenderer.Update(dt, t);
 }
 
+void App::UpdateFrameStats()
+{
+    // время кадра - каждый кадр, заголовок раз в секунду: по нему видны выбросы, а не только среднее
+    mFrameStats.add(mTimer.DeltaSeconds());
+
+    const double t = mTimer.TotalSeconds();
+    if(t - mStatsShownAt < 1.0)
+        return;
+    mStatsShownAt = t;
+
+    const std::string s = framestats::format(mFrameStats.summary());
+    mWindow.SetTitle(L"CG4Unique - DX12 | " + std::wstring(s.begin(), s.end()) + L" | F2 - CSV/JSON");
+}
+
 void App::Draw()
 {
     // очистка бэк-буфера цветом.
@@ -4,6 +4,7 @@
 #include "Timer.h"
 #include "InputDevice.h"
 #include "Dx12Renderer.h"
+#include "../shared/frame_stats.h"
 
 // окно + цикл сообщений + таймер + рендер
 class App
@@ -19,12 +20,15 @@ private:
 
     void Update();
     void Draw();
+    void UpdateFrameStats();
 
 private:
     HINSTANCE mHinst = nullptr;
 
     WinWindow mWindow;
     Timer mTimer;
+    framestats::Collector mFrameStats;
+    double mStatsShownAt = 0.0;
     InputDevice mInput;
     Dx12Renderer mRenderer;
 
@@ -1,14 +1,17 @@
 #include "Dx12Renderer.h"
 
 #include <algorithm>
-#include <cfloat>
+#include <cstring>
 #include <filesystem>
-#include <fstream>
-#include <sstream>
-#include <unordered_map>
 
 using namespace DirectX;
 
+static constexpr float kFovY = 0.25f * XM_PI;
+
+// материал без usemtl: прежний цвет шейдера, блик 0.35 со степенью 64
+const Dx12Renderer::MaterialConstants Dx12Renderer::kDefaultMaterial = {
+    XMFLOAT4(0.85f, 0.75f, 0.55f, 1.0f), XMFLOAT4(0.35f, 0.35f, 0.35f, 64.0f) };
+
 //поиск ассета
 static std::wstring FindAssetPath(const std::wstring& relative)
 {
@@ -116,7 +119,9 @@ void Dx12Renderer::Initialize(HWND hwnd, int width, int height, const Settings&
 
     BuildRootSignature();
     BuildShadersAndPSO();
-    BuildSponzaGeometry();
+    // первый кадр не ждёт разбора OBJ: куб сразу, Sponza - когда догрузится
+    BuildCubeGeometry();
+    StartSponzaLoad();
 
     mSceneCB = std::make_unique<UploadBuffer<SceneCB>>(mDevice.Get(), 1, true);
 
@@ -134,218 +139,69 @@ void Dx12Renderer::Initialize(HWND hwnd, int width, int height, const Settings&
     Resize(width, height);
 }
 
-bool Dx12Renderer::LoadObjSimple(const std::wstring& path,
-    std::vector<Vertex>& outVertices,
-    std::vector<uint32_t>& outIndices,
-    XMFLOAT3& outMin,
-    XMFLOAT3& outMax)
+void Dx12Renderer::StartSponzaLoad()
 {
-    namespace fs = std::filesystem;
-
-    std::ifstream file(path);
-    if(!file.is_open())
-        return false;
-
-    std::vector<XMFLOAT3> positions;
-    std::vector<XMFLOAT3> normals;
-
-    positions.reserve(100000);
-    normals.reserve(100000);
-
-    outVertices.clear();
-    outIndices.clear();
-    outVertices.reserve(200000);
-    outIndices.reserve(400000);
-
-    outMin = XMFLOAT3(+FLT_MAX, +FLT_MAX, +FLT_MAX);
-    outMax = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
-
-    struct Key
-    {
-        int v = 0;
-        int n = 0;
-        bool operator==(const Key& o) const noexcept { return v == o.v && n == o.n; }
-    };
-
-    struct KeyHash
-    {
-        size_t operator()(const Key& k) const noexcept
-        {
-            return (static_cast<size_t>(k.v) * 73856093u) ^ (static_cast<size_t>(k.n) * 19349663u);
-        }
-    };
-
-    std::unordered_map<Key, uint32_t, KeyHash> remap;
-    remap.reserve(200000);
-
-    auto fixIndex = [](int idx, int count) -> int {
-        if(idx > 0) return idx - 1;
-        if(idx < 0) return count + idx;
-        return -1;
-    };
-
-    auto parseFaceVertex = [](const std::string& token, int& outV, int& outN)
-    {
-        outV = 0;
-        outN = 0;
-
-        int v = 0, vt = 0, vn = 0;
-
-        size_t s1 = token.find('/');
-        if(s1 == std::string::npos)
-        {
-            v = std::stoi(token);
-        }
-        else
-        {
-            std::string a = token.substr(0, s1);
-            v = a.empty() ? 0 : std::stoi(a);
-
-            size_t s2 = token.find('/', s1 + 1);
-            if(s2 == std::string::npos)
-            {
-                std::string b = token.substr(s1 + 1);
-                vt = b.empty() ? 0 : std::stoi(b);
-            }
-            else
-            {
-                std::string b = token.substr(s1 + 1, s2 - (s1 + 1));
-                std::string c = token.substr(s2 + 1);
-                vt = b.empty() ? 0 : std::stoi(b);
-                vn = c.empty() ? 0 : std::stoi(c);
-            }
-        }
-
-        outV = v;
-        outN = vn;
-        (void)vt;
-    };
+    const std::wstring rel = L"Assets\\sponza.obj";
+    const std::filesystem::path objPath = FindAssetPath(rel);
 
-    std::string line;
-    while(std::getline(file, line))
+    // разбор и подготовка на рабочем потоке; до готовности рисуется куб
+    mLoader = std::make_unique<JobQueue>(1);
+    // при закрытии окна ~JobQueue запрашивает остановку, и загрузка выходит после текущего этапа
+    mLoader->Push([objPath, &loaded = mLoaded](std::stop_token stop)
     {
-        if(line.empty())
-            continue;
-
-
-        if(line[0] == '#')
-            continue;
-
-        std::istringstream iss(line);
-        std::string tag;
-        iss >> tag;
-
-        if(tag == "v")
-        {
-            XMFLOAT3 p{};
-            iss >> p.x >> p.y >> p.z;
-            positions.push_back(p);
-        }
-        else if(tag == "vn")
+        std::unique_ptr<MeshAsset> asset = std::make_unique<MeshAsset>();
+        try
         {
-            XMFLOAT3 n{};
-            iss >> n.x >> n.y >> n.z;
-            normals.push_back(n);
+            if(!BuildMeshAsset(objPath, *asset, 50.0f, stop))
+                asset.reset();
         }
-        else if(tag == "f")
+        catch(const std::exception&)
         {
-            std::vector<std::string> tokens;
-            tokens.reserve(8);
-
-            std::string tok;
-            while(iss >> tok)
-                tokens.push_back(tok);
-
-            if(tokens.size() < 3)
-                continue;
-
-            auto emit = [&](const std::string& t) -> uint32_t
-            {
-                int vRaw = 0, nRaw = 0;
-                parseFaceVertex(t, vRaw, nRaw);
-
-                int vi = fixIndex(vRaw, (int)positions.size());
-                int ni = fixIndex(nRaw, (int)normals.size());
-
-                if(vi < 0 || vi >= (int)positions.size())
-                    return 0;
-
-                Key key{vi, ni};
-                auto it = remap.find(key);
-                if(it != remap.end())
-                    return it->second;
-
-                Vertex vx{};
-                vx.pos = positions[vi];
-                if(ni >= 0 && ni < (int)normals.size())
-                    vx.normal = normals[ni];
-                else
-                    vx.normal = XMFLOAT3(0, 1, 0);
-
-                outMin.x = std::min(outMin.x, vx.pos.x);
-                outMin.y = std::min(outMin.y, vx.pos.y);
-                outMin.z = std::min(outMin.z, vx.pos.z);
-                outMax.x = std::max(outMax.x, vx.pos.x);
-                outMax.y = std::max(outMax.y, vx.pos.y);
-                outMax.z = std::max(outMax.z, vx.pos.z);
-
-                uint32_t newIndex = (uint32_t)outVertices.size();
-                outVertices.push_back(vx);
-                remap.emplace(key, newIndex);
-                return newIndex;
-            };
-
-            for(size_t k = 1; k + 1 < tokens.size(); ++k)
-            {
-                uint32_t i0 = emit(tokens[0]);
-                uint32_t i1 = emit(tokens[k]);
-                uint32_t i2 = emit(tokens[k + 1]);
-                outIndices.push_back(i0);
-                outIndices.push_back(i1);
-                outIndices.push_back(i2);
-            }
+            asset.reset();
         }
-    }
-
-    return !outVertices.empty() && !outIndices.empty();
+        if(stop.stop_requested())
+            return;
+        loaded.Post(std::move(asset));
+    });
 }
 
-void Dx12Renderer::BuildSponzaGeometry()
+void Dx12Renderer::PollLoadedAssets()
 {
-    const std::wstring rel = L"Assets\\sponza.obj";
-    const std::wstring objPath = FindAssetPath(rel);
-
-    std::vector<Vertex> verts;
-    std::vector<uint32_t> inds;
-    XMFLOAT3 bmin{}, bmax{};
-
-    if(!LoadObjSimple(objPath, verts, inds, bmin, bmax))
+    // граница кадра: прошлый кадр уже дождался GPU (MoveToNextFrame), буферы куба можно заменить
+    for(std::unique_ptr<MeshAsset>& asset : mLoaded.TakeAll())
     {
-        OutputDebugStringW(L"[CG] Sponza OBJ не найден. Используется куб (fallback).\n");
-        BuildCubeGeometry();
-        return;
-    }
-
-    XMFLOAT3 center{ (bmin.x + bmax.x) * 0.5f, (bmin.y + bmax.y) * 0.5f, (bmin.z + bmax.z) * 0.5f };
-    XMFLOAT3 ext{ (bmax.x - bmin.x), (bmax.y - bmin.y), (bmax.z - bmin.z) };
-    float maxExtent = std::max(ext.x, std::max(ext.y, ext.z));
-    float inv = (maxExtent > 0.00001f) ? (1.0f / maxExtent) : 1.0f;
-    float scale = inv * 50.0f; 
-
-    for(auto& v : verts)
-    {
-        v.pos.x = (v.pos.x - center.x) * scale;
-        v.pos.y = (v.pos.y - center.y) * scale;
-        v.pos.z = (v.pos.z - center.z) * scale;
+        if(asset)
+            UploadMeshAsset(*asset);
+        else
+            OutputDebugStringW(L"[CG] Sponza OBJ не найден. Используется куб (fallback).\n");
     }
+}
 
-    mIndexCount = (UINT)inds.size();
+void Dx12Renderer::UploadMeshAsset(MeshAsset& asset)
+{
+    mLod = std::move(asset.lod);
+    mGroupBounds = std::move(asset.groupBounds);
+    mMeshlets = std::move(asset.meshlets);
+    mBatchMeshlets = std::move(asset.batchMeshlets);
+    mOccluders = std::move(asset.occluders);
+    mSubmeshes = std::move(asset.submeshes);
+    mQuant = asset.quant;
+    mIndexCount = mLod.levels[0].count;
+    mCullReported = false;
+
+    mMaterials.clear();
+    for(const MeshAssetMaterial& m : asset.materials)
+        mMaterials.push_back({ XMFLOAT4(m.baseColor), XMFLOAT4(m.specular) });
+    if(mMaterials.empty())
+        mMaterials.push_back(kDefaultMaterial);
 
     ThrowIfFailed(mCmdAlloc->Reset());
     ThrowIfFailed(mCmdList->Reset(mCmdAlloc.Get(), nullptr));
 
-    mVB = CreateDefaultBuffer(mDevice.Get(), mCmdList.Get(), verts.data(), sizeof(Vertex) * verts.size(), mVBUpload);
-    mIB = CreateDefaultBuffer(mDevice.Get(), mCmdList.Get(), inds.data(), sizeof(uint32_t) * inds.size(), mIBUpload);
+    mVB = CreateDefaultBuffer(mDevice.Get(), mCmdList.Get(), asset.vertices.data(),
+        sizeof(PackedVertex) * asset.vertices.size(), mVBUpload);
+    mIB = CreateDefaultBuffer(mDevice.Get(), mCmdList.Get(), asset.indices.data(),
+        sizeof(uint16_t) * asset.indices.size(), mIBUpload);
 
     ThrowIfFailed(mCmdList->Close());
     ID3D12CommandList* lists[] = { mCmdList.Get() };
@@ -353,15 +209,21 @@ void Dx12Renderer::BuildSponzaGeometry()
     Flush();
 
     mVBV.BufferLocation = mVB->GetGPUVirtualAddress();
-    mVBV.StrideInBytes = sizeof(Vertex);
-    mVBV.SizeInBytes = (UINT)(sizeof(Vertex) * verts.size());
+    mVBV.StrideInBytes = sizeof(PackedVertex);
+    mVBV.SizeInBytes = (UINT)(sizeof(PackedVertex) * asset.vertices.size());
 
     mIBV.BufferLocation = mIB->GetGPUVirtualAddress();
-    mIBV.Format = DXGI_FORMAT_R32_UINT;
-    mIBV.SizeInBytes = (UINT)(sizeof(uint32_t) * inds.size());
-
-    OutputDebugStringW((L"[CG] Sponza загружена: verts=" + std::to_wstring(verts.size()) +
-        L" inds=" + std::to_wstring(inds.size()) + L"\n").c_str());
+    mIBV.Format = DXGI_FORMAT_R16_UINT;
+    mIBV.SizeInBytes = (UINT)(sizeof(uint16_t) * asset.indices.size());
+
+    const MeshOptimizeReport& opt = asset.optimize;
+    OutputDebugStringW((L"[CG] Sponza загружена: verts=" + std::to_wstring(asset.vertices.size()) +
+        L" inds=" + std::to_wstring(mLod.levels[0].count) + L" lods=" + std::to_wstring(mLod.levels.size()) +
+        L" materials=" + std::to_wstring(asset.objBatches) +
+        L" submeshes=" + std::to_wstring(mSubmeshes.size()) + L" (+" + std::to_wstring(asset.duplicatedVertices) + L" verts)" +
+        L" quant err pos " + std::to_wstring(asset.quantError.maxPosition) + L" nrm " + std::to_wstring(asset.quantError.maxNormalDegrees) + L" deg" +
+        L" ACMR " + std::to_wstring(opt.before.acmr) + L" -> " + std::to_wstring(opt.after.acmr) +
+        L" ATVR " + std::to_wstring(opt.before.atvr) + L" -> " + std::to_wstring(opt.after.atvr) + L"\n").c_str());
 }
 
 void Dx12Renderer::InitDevice()
@@ -511,15 +373,22 @@ void Dx12Renderer::Resize(int width, int height)
 
 void Dx12Renderer::BuildRootSignature()
 {
-    D3D12_ROOT_PARAMETER param{};
-    param.ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
-    param.Descriptor.ShaderRegister = 0;
-    param.Descriptor.RegisterSpace = 0;
-    param.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+    D3D12_ROOT_PARAMETER params[2]{};
+    params[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
+    params[0].Descriptor.ShaderRegister = 0;
+    params[0].Descriptor.RegisterSpace = 0;
+    params[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+    // материал батча - корневые константы b1, меняются между вызовами без буферов
+    params[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+    params[1].Constants.ShaderRegister = 1;
+    params[1].Constants.RegisterSpace = 0;
+    params[1].Constants.Num32BitValues = kMaterialConstants;
+    params[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
 
     D3D12_ROOT_SIGNATURE_DESC desc{};
-    desc.NumParameters = 1;
-    desc.pParameters = &param;
+    desc.NumParameters = _countof(params);
+    desc.pParameters = params;
     desc.NumStaticSamplers = 0;
     desc.pStaticSamplers = nullptr;
     desc.Flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT;
@@ -552,8 +421,8 @@ void Dx12Renderer::BuildShadersAndPSO()
         "PSMain", "ps_5_0", flags, 0, &mPS, &errors));
 
     D3D12_INPUT_ELEMENT_DESC layout[] = {
-        {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
-        {"NORMAL",   0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+        {"POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+        {"NORMAL",   0, DXGI_FORMAT_R16G16_SNORM,       0, 8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
     };
 
     D3D12_GRAPHICS_PIPELINE_STATE_DESC pso{};
@@ -645,11 +514,13 @@ void Dx12Renderer::BuildCubeGeometry()
     }
 
     mIndexCount = static_cast<UINT>(i.size());
+    mQuant = MakeQuantizeBounds(Float3(-s, -s, -s), Float3(s, s, s));
+    std::vector<PackedVertex> packed = PackVertices(v.data(), v.size(), mQuant);
 
     ThrowIfFailed(mCmdAlloc->Reset());
     ThrowIfFailed(mCmdList->Reset(mCmdAlloc.Get(), nullptr));
 
-    mVB = CreateDefaultBuffer(mDevice.Get(), mCmdList.Get(), v.data(), sizeof(Vertex) * v.size(), mVBUpload);
+    mVB = CreateDefaultBuffer(mDevice.Get(), mCmdList.Get(), packed.data(), sizeof(PackedVertex) * packed.size(), mVBUpload);
     mIB = CreateDefaultBuffer(mDevice.Get(), mCmdList.Get(), i.data(), sizeof(uint16_t) * i.size(), mIBUpload);
 
     ThrowIfFailed(mCmdList->Close());
@@ -658,8 +529,8 @@ void Dx12Renderer::BuildCubeGeometry()
     Flush();
 
     mVBV.BufferLocation = mVB->GetGPUVirtualAddress();
-    mVBV.StrideInBytes = sizeof(Vertex);
-    mVBV.SizeInBytes = static_cast<UINT>(sizeof(Vertex) * v.size());
+    mVBV.StrideInBytes = sizeof(PackedVertex);
+    mVBV.SizeInBytes = static_cast<UINT>(sizeof(PackedVertex) * packed.size());
 
     mIBV.BufferLocation = mIB->GetGPUVirtualAddress();
     mIBV.Format = DXGI_FORMAT_R16_UINT;
@@ -669,6 +540,7 @@ void Dx12Renderer::BuildCubeGeometry()
 void Dx12Renderer::Update(float dt, float totalTime)
 {
     (void)dt;
+    PollLoadedAssets();
 
 
     float x = mRadius * sinf(mPhi) * cosf(mTheta);
@@ -680,17 +552,21 @@ void Dx12Renderer::Update(float dt, float totalTime)
     XMVECTOR up = XMVectorSet(0, 1, 0, 0);
 
     XMMATRIX view = XMMatrixLookAtLH(eye, at, up);
-    XMMATRIX proj = XMMatrixPerspectiveFovLH(0.25f * XM_PI, (float)mWidth / (float)mHeight, 0.1f, 1000.0f);
+    XMMATRIX proj = XMMatrixPerspectiveFovLH(kFovY, (float)mWidth / (float)mHeight, 0.1f, 1000.0f);
 
     XMMATRIX world = XMMatrixIdentity();
 
     SceneCB cb{};
     XMStoreFloat4x4(&cb.world, XMMatrixTranspose(world));
     XMStoreFloat4x4(&cb.viewProj, XMMatrixTranspose(view * proj));
+    XMStoreFloat4x4(&mViewProj, view * proj);
+    mEye = XMFLOAT3(x, y, z);
 
     cb.eyePos = XMFLOAT3(x, y, z);
     cb.lightDir = XMFLOAT3(0.577f, -0.577f, 0.577f);
     cb.lightColor = XMFLOAT3(1.0f, 1.0f, 1.0f);
+    cb.posMin = XMFLOAT3(mQuant.min.x, mQuant.min.y, mQuant.min.z);
+    cb.posExtent = XMFLOAT3(mQuant.extent.x, mQuant.extent.y, mQuant.extent.z);
 
     mSceneCB->CopyData(0, cb);
 }
@@ -727,7 +603,95 @@ void Dx12Renderer::Render(float r, float g, float b)
     mCmdList->IASetVertexBuffers(0, 1, &mVBV);
     mCmdList->IASetIndexBuffer(&mIBV);
 
-    mCmdList->DrawIndexedInstanced(mIndexCount, 1, 0, 0, 0);
+    // без материалов (куб) - один вызов с материалом по умолчанию
+    if(mLod.levels.empty())
+    {
+        mCmdList->SetGraphicsRoot32BitConstants(1, kMaterialConstants, &kDefaultMaterial, 0);
+        DrawIndexRange(0, mIndexCount);
+    }
+    else
+    {
+        // уровень LOD каждого батча по ошибке на экране: расстояние от глаза до бокса батча.
+        // Камера орбиты всегда внутри Sponza, а дальние батчи от неё в десятках единиц
+        const size_t groupCount = mMaterials.size();
+        const float eye[3] = { mEye.x, mEye.y, mEye.z };
+        bool exact = false;
+        mGroupLevels.resize(groupCount);
+        for(size_t g = 0; g < groupCount; ++g)
+        {
+            mGroupLevels[g] = (UINT)meshlod::select_group_level(mLod, g, mGroupBounds[g], eye, kFovY, (float)mHeight);
+            exact = exact || mGroupLevels[g] == 0;
+        }
+        // мешлеты есть только у уровня 0 - отсекать стоит, если хоть один батч на нём
+        const bool cull = exact && !mMeshlets.meshlets.empty();
+        if(cull)
+        {
+            Frustum frustum = FrustumFromViewProj(&mViewProj.m[0][0]);
+            CullMeshlets(mMeshlets, frustum, Float3(mEye.x, mEye.y, mEye.z), mVisibleMeshlets, &mCullStats);
+            if(!mOccluders.indices.empty())
+            {
+                mOcclusion.Begin(&mViewProj.m[0][0]);
+                mOcclusion.Rasterize(mOccluders);
+                mOcclusion.Finish();
+                mCullStats.occlusionCulled = RemoveOccludedMeshlets(mMeshlets, mOcclusion, mVisibleMeshlets);
+                mCullStats.visibleMeshlets = mVisibleMeshlets.size();
+            }
+
+            if(!mCullReported)
+            {
+                mCullReported = true;
+                OutputDebugStringW((L"[CG] мешлеты: " + std::to_wstring(mCullStats.visibleMeshlets) + L"/" +
+                    std::to_wstring(mCullStats.meshlets) + L" видно, отсечено треугольников: пирамида " +
+                    std::to_wstring(mCullStats.frustumCulled) + L", конус " + std::to_wstring(mCullStats.backfaceCulled) +
+                    L", перекрытие " + std::to_wstring(mCullStats.occlusionCulled) +
+                    L" из " + std::to_wstring(mCullStats.triangles) + L"\n").c_str());
+            }
+        }
+
+        // батчи идут в порядке состояний: одинаковый материал подряд не переустанавливается
+        const MaterialConstants* bound = nullptr;
+        size_t k = 0;
+        for(size_t g = 0; g < groupCount; ++g)
+        {
+            const MaterialConstants& mat = mMaterials[g];
+            auto bind = [&]()
+            {
+                if(bound && memcmp(bound, &mat, sizeof(mat)) == 0)
+                    return;
+                mCmdList->SetGraphicsRoot32BitConstants(1, kMaterialConstants, &mat, 0);
+                bound = &mat;
+            };
+
+            const uint32_t end = cull ? mBatchMeshlets[g + 1] : 0;
+            if(!cull || mGroupLevels[g] != 0)
+            {
+                // грубый батч рисуется целиком, его видимые мешлеты уровня 0 пропускаются
+                while(k < mVisibleMeshlets.size() && mVisibleMeshlets[k] < end)
+                    ++k;
+                const meshlod::Level& range = mLod.groups[mGroupLevels[g] * groupCount + g];
+                if(range.count == 0)
+                    continue;
+                bind();
+                DrawIndexRange(range.first, range.count);
+                continue;
+            }
+
+            // соседние видимые мешлеты батча лежат в буфере подряд - один вызов на серию
+            while(k < mVisibleMeshlets.size() && mVisibleMeshlets[k] < end)
+            {
+                const Meshlet& m = mMeshlets.meshlets[mVisibleMeshlets[k]];
+                UINT start = mMeshlets.FirstIndex(m);
+                UINT count = m.triangleCount * 3;
+                size_t j = k + 1;
+                while(j < mVisibleMeshlets.size() && mVisibleMeshlets[j] < end &&
+                    mVisibleMeshlets[j] == mVisibleMeshlets[j - 1] + 1)
+                    count += mMeshlets.meshlets[mVisibleMeshlets[j++]].triangleCount * 3;
+                bind();
+                DrawIndexRange(start, count);
+                k = j;
+            }
+        }
+    }
 
 
     barrier = Transition(CurrentBackBuffer(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
@@ -742,6 +706,24 @@ void Dx12Renderer::Render(float r, float g, float b)
     MoveToNextFrame();
 }
 
+void Dx12Renderer::DrawIndexRange(UINT firstIndex, UINT indexCount)
+{
+    if(mSubmeshes.empty())
+    {
+        mCmdList->DrawIndexedInstanced(indexCount, 1, firstIndex, 0, 0);
+        return;
+    }
+
+    const UINT end = firstIndex + indexCount;
+    for(size_t i = FindSubmesh16(mSubmeshes, firstIndex); i < mSubmeshes.size() && firstIndex < end; ++i)
+    {
+        const Submesh16& s = mSubmeshes[i];
+        UINT stop = std::min(end, s.firstIndex + s.indexCount);
+        mCmdList->DrawIndexedInstanced(stop - firstIndex, 1, firstIndex, s.baseVertex, 0);
+        firstIndex = stop;
+    }
+}
+
 ID3D12Resource* Dx12Renderer::CurrentBackBuffer() const
 {
     return mBackBuffers[mFrameIndex].Get();
@@ -2,6 +2,9 @@
 #include "Common.h"
 #include "Dx12Helpers.h"
 #include "UploadBuffer.h"
+#include "MeshTypes.h"
+#include "MeshAsset.h"
+#include "JobQueue.h"
 
 class Dx12Renderer
 {
@@ -39,19 +42,14 @@ private:
     void BuildShadersAndPSO();
     void BuildCubeGeometry();
 
-    void BuildSponzaGeometry();
+    // Sponza грузится на рабочем потоке и подменяет куб в начале Update
+    void StartSponzaLoad();
+    void PollLoadedAssets();
+    void UploadMeshAsset(MeshAsset& asset);
+    // диапазон буфера индексов, разрезанный по подмешам (у каждого свой baseVertex)
+    void DrawIndexRange(UINT firstIndex, UINT indexCount);
 
-    struct Vertex
-        {
-            DirectX::XMFLOAT3 pos;
-            DirectX::XMFLOAT3 normal;
-        };
-
-    bool LoadObjSimple(const std::wstring& path,
-        std::vector<Vertex>& outVertices,
-        std::vector<uint32_t>& outIndices,
-        DirectX::XMFLOAT3& outMin,
-        DirectX::XMFLOAT3& outMax);
+    using Vertex = MeshVertex;
 
     void Flush();
     void MoveToNextFrame();
@@ -73,8 +71,21 @@ private:
         float _pad1;
         DirectX::XMFLOAT3 lightColor;
         float _pad2;
+        DirectX::XMFLOAT3 posMin;       // распаковка PackedVertex: min + q * extent
+        float _pad3;
+        DirectX::XMFLOAT3 posExtent;
+        float _pad4;
     };
 
+    // корневые константы b1: Kd и прозрачность, Ks и степень блика
+    struct MaterialConstants
+    {
+        DirectX::XMFLOAT4 baseColor;
+        DirectX::XMFLOAT4 specular;
+    };
+    static constexpr UINT kMaterialConstants = sizeof(MaterialConstants) / 4;
+    static const MaterialConstants kDefaultMaterial;
+
 private:
     HWND mHwnd = nullptr;
     int mWidth = 0;
@@ -126,6 +137,33 @@ private:
     D3D12_VERTEX_BUFFER_VIEW mVBV{};
     D3D12_INDEX_BUFFER_VIEW mIBV{};
     UINT mIndexCount = 0;
+    // вершины в VB упакованы (PackedVertex), бокс нужен шейдеру для распаковки позиций
+    QuantizeBounds mQuant{};
+    // 16-битный буфер Sponza режется на подмеши; пусто - один диапазон с baseVertex 0
+    std::vector<Submesh16> mSubmeshes;
+
+    // LOD Sponza: все уровни лежат в mIB подряд, ошибки в мировых единицах
+    meshlod::Chain mLod;
+    // уровень каждого батча выбирается по расстоянию от глаза до его бокса
+    std::vector<meshlod::Bounds> mGroupBounds;
+    std::vector<UINT> mGroupLevels;
+    // по материалу на батч (группу LOD), в порядке батчей
+    std::vector<MaterialConstants> mMaterials;
+
+    // мешлеты уровня 0: диапазоны того же буфера индексов, отсекаются на CPU каждый кадр
+    MeshletMesh mMeshlets;
+    // мешлеты батча g: [mBatchMeshlets[g], mBatchMeshlets[g + 1])
+    std::vector<uint32_t> mBatchMeshlets;
+    std::vector<uint32_t> mVisibleMeshlets;
+    MeshletCullStats mCullStats{};
+    bool mCullReported = false;
+    // после пирамиды и конусов мешлеты проверяются по глубине окклюдеров, нарисованной на CPU
+    OccluderMesh mOccluders;
+    OcclusionBuffer mOcclusion;
+
+    // камера последнего Update, для отсечения
+    DirectX::XMFLOAT4X4 mViewProj{};
+    DirectX::XMFLOAT3 mEye{};
 
 
     std::unique_ptr<UploadBuffer<SceneCB>> mSceneCB;
@@ -134,4 +172,9 @@ private:
     float mTheta = 1.6f;
     float mPhi = 0.9f;
     float mRadius = 5.0f;
+
+    // фоновая загрузка; очередь объявлена последней и разрушается первой,
+    // её задача пишет только в mLoaded (nullptr - OBJ не прочитан)
+    FrameHandoff<std::unique_ptr<MeshAsset>> mLoaded;
+    std::unique_ptr<JobQueue> mLoader;
 };
@@ -0,0 +1,75 @@
+#include "JobQueue.h"
+
+JobQueue::JobQueue(unsigned workers)
+{
+    if(workers == 0)
+        workers = 1;
+    for(unsigned i = 0; i < workers; ++i)
+        mWorkers.emplace_back(&JobQueue::WorkerLoop, this);
+}
+
+JobQueue::~JobQueue()
+{
+    mCancel.request_stop();
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+        mJobs.clear();
+    }
+    mWake.notify_all();
+    mIdle.notify_all();
+    for(std::thread& t : mWorkers)
+        t.join();
+}
+
+void JobQueue::Push(std::function<void()> job)
+{
+    Push([job = std::move(job)](std::stop_token) { job(); });
+}
+
+void JobQueue::Push(std::function<void(std::stop_token)> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mJobs.push_back(std::move(job));
+    }
+    mWake.notify_one();
+}
+
+void JobQueue::WaitIdle()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mIdle.wait(lock, [this] { return (mStop || mJobs.empty()) && mRunning == 0; });
+}
+
+size_t JobQueue::Pending() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mJobs.size() + mRunning;
+}
+
+void JobQueue::WorkerLoop()
+{
+    for(;;)
+    {
+        std::function<void(std::stop_token)> job;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWake.wait(lock, [this] { return mStop || !mJobs.empty(); });
+            if(mStop)
+                return;
+            job = std::move(mJobs.front());
+            mJobs.pop_front();
+            ++mRunning;
+        }
+
+        job(mCancel.get_token());
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            --mRunning;
+            if(mJobs.empty() && mRunning == 0)
+                mIdle.notify_all();
+        }
+    }
+}
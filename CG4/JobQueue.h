@@ -0,0 +1,74 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Фоновые задачи без DirectX и WinAPI: загрузка и подготовка ассетов вне потока рендера.
+
+// Очередь задач с постоянными рабочими потоками, задачи выполняются в порядке Push.
+// Деструктор отбрасывает ещё не начатые задачи, запрашивает остановку выполняющихся
+// и ждёт их. Длинная задача принимает std::stop_token и проверяет его между этапами,
+// иначе закрытие окна ждёт её до конца.
+// Задача не должна бросать исключения: ошибку она сообщает своим результатом.
+class JobQueue
+{
+public:
+    explicit JobQueue(unsigned workers = 1);
+    ~JobQueue();
+
+    JobQueue(const JobQueue&) = delete;
+    JobQueue& operator=(const JobQueue&) = delete;
+
+    void Push(std::function<void()> job);
+    void Push(std::function<void(std::stop_token)> job);
+
+    // ждёт, пока очередь опустеет и все задачи завершатся
+    void WaitIdle();
+
+    // задачи в очереди и в работе
+    size_t Pending() const;
+
+private:
+    void WorkerLoop();
+
+    mutable std::mutex mMutex;
+    std::condition_variable mWake;
+    std::condition_variable mIdle;
+    std::deque<std::function<void(std::stop_token)>> mJobs;
+    size_t mRunning = 0;
+    bool mStop = false;
+    std::stop_source mCancel;
+    std::vector<std::thread> mWorkers;
+};
+
+// Передача готовых результатов потоку рендера: рабочий поток кладёт Post,
+// рендер забирает всё накопленное на границе кадра (TakeAll), не блокируясь на загрузке.
+template<class T>
+class FrameHandoff
+{
+public:
+    void Post(T value)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mReady.push_back(std::move(value));
+    }
+
+    // результаты в порядке Post; пусто, если ничего не готово
+    std::vector<T> TakeAll()
+    {
+        std::vector<T> out;
+        std::lock_guard<std::mutex> lock(mMutex);
+        out.swap(mReady);
+        return out;
+    }
+
+private:
+    std::mutex mMutex;
+    std::vector<T> mReady;
+};
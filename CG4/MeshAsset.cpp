@@ -0,0 +1,144 @@
+#include "MeshAsset.h"
+#include "ObjLoader.h"
+
+#include <algorithm>
+#include <cmath>
+
+bool BuildMeshAsset(const std::filesystem::path& objPath, MeshAsset& out, float worldSize, std::stop_token stop)
+{
+    std::vector<MeshVertex> verts;
+    std::vector<uint32_t> inds;
+    Float3 bmin{}, bmax{};
+
+    ObjMaterials objMaterials;
+    if(!LoadObjSimple(objPath, verts, inds, bmin, bmax, &out.optimize, &objMaterials) || stop.stop_requested())
+        return false;
+    out.objBatches = objMaterials.batches.size();
+
+    const Float3 center((bmin.x + bmax.x) * 0.5f, (bmin.y + bmax.y) * 0.5f, (bmin.z + bmax.z) * 0.5f);
+    const Float3 ext(bmax.x - bmin.x, bmax.y - bmin.y, bmax.z - bmin.z);
+    float maxExtent = std::max(ext.x, std::max(ext.y, ext.z));
+    float inv = (maxExtent > 0.00001f) ? (1.0f / maxExtent) : 1.0f;
+    float scale = inv * worldSize;
+
+    // батч материала - группа: свой диапазон на каждом уровне LOD и свои мешлеты.
+    // OBJ без usemtl - одна группа с материалом по умолчанию
+    std::vector<uint32_t> groupStarts;
+    out.materials.clear();
+    for(const objmat::Batch& b : objMaterials.batches)
+    {
+        const objmat::Material& m = objMaterials.materials[b.material];
+        groupStarts.push_back(b.first * 3);
+        out.materials.push_back({ { m.diffuse[0], m.diffuse[1], m.diffuse[2], m.opacity },
+            { m.specular[0], m.specular[1], m.specular[2], std::max(m.shininess, 1.0f) } });
+    }
+    if(groupStarts.empty())
+        groupStarts.push_back(0);
+    const size_t groupCount = groupStarts.size();
+
+    // цепочка LOD из кэша, при первой загрузке - упрощение и запись кэша.
+    // Уровень 0 кэша обязан совпасть с загруженным мешем, иначе цепочка от старого порядка вершин
+    meshlod::Chain& lod = out.lod;
+    meshcache::SourceStamp stamp{};
+    const bool stamped = meshcache::stamp_source(objPath, stamp);
+    const std::filesystem::path lodPath = meshlod::cache_path(objPath);
+    const bool lodCached = stamped && meshlod::load(lodPath, stamp, lod) &&
+        lod.levels[0].first == 0 && lod.levels[0].count == inds.size() &&
+        lod.groups.size() == lod.levels.size() * groupCount &&
+        std::equal(inds.begin(), inds.end(), lod.indices.begin());
+    if(!lodCached)
+    {
+        // упрощение - самый долгий этап первой загрузки, остановка проверяется и внутри него
+        meshlod::Params lodParams;
+        lodParams.stop = stop;
+        lod = meshlod::build_chain(&verts[0].pos.x, sizeof(MeshVertex), verts.size(), inds.data(), inds.size(), groupStarts, lodParams);
+        if(stop.stop_requested())
+            return false;
+        // упрощённые уровни сохраняют порядок граней уровня 0, кэш вершин для них подбираем заново
+        for(size_t i = groupCount; i < lod.groups.size(); ++i)
+            OptimizeVertexCache(lod.indices.data() + lod.groups[i].first, lod.groups[i].count, verts.size());
+        if(stamped)
+            meshlod::save(lodPath, stamp, lod);
+    }
+    if(stop.stop_requested())
+        return false;
+    for(auto& l : lod.levels)
+        l.error *= scale;
+    for(auto& g : lod.groups)
+        g.error *= scale;
+
+    for(auto& v : verts)
+    {
+        v.pos.x = (v.pos.x - center.x) * scale;
+        v.pos.y = (v.pos.y - center.y) * scale;
+        v.pos.z = (v.pos.z - center.z) * scale;
+    }
+    out.groupBounds = meshlod::group_bounds(lod, &verts[0].pos.x, sizeof(MeshVertex));
+
+    // уровень 0 рисуется в порядке мешлетов, тогда каждый мешлет - поддиапазон буфера индексов.
+    // Мешлеты строятся внутри батча и не смешивают материалы; для отсечения нужны только сферы, боксы и конусы
+    out.meshlets = MeshletMesh{};
+    out.batchMeshlets.assign(1, 0);
+    for(size_t g = 0; g < groupCount; ++g)
+    {
+        const meshlod::Level& range = lod.groups[g];
+        MeshletMesh part = BuildMeshlets(verts.data(), verts.size(), lod.indices.data() + range.first, range.count);
+        std::copy(part.indices.begin(), part.indices.end(), lod.indices.begin() + range.first);
+        for(Meshlet m : part.meshlets)
+        {
+            m.triangleOffset += range.first / 3;
+            out.meshlets.meshlets.push_back(m);
+        }
+        out.batchMeshlets.push_back((uint32_t)out.meshlets.meshlets.size());
+    }
+
+    if(stop.stop_requested())
+        return false;
+
+    // окклюдеры - крупнейшие треугольники самого грубого уровня LOD с ошибкой не больше
+    // kOccluderError: плоская мелкая сетка стен там уже слита в большие треугольники.
+    // Только непрозрачные батчи: сквозь полупрозрачные видно то, что за ними
+    {
+        const float kOccluderError = 0.001f * worldSize;
+        size_t level = 0;
+        while(level + 1 < lod.levels.size() && lod.levels[level + 1].error <= kOccluderError)
+            ++level;
+        std::vector<uint32_t> opaque;
+        for(size_t g = 0; g < groupCount; ++g)
+        {
+            if(!out.materials.empty() && out.materials[g].baseColor[3] < 1.0f)
+                continue;
+            const meshlod::Level& range = lod.groups[level * groupCount + g];
+            opaque.insert(opaque.end(), lod.indices.begin() + range.first, lod.indices.begin() + range.first + range.count);
+        }
+        out.occluders = SelectOccluders(verts.data(), verts.size(), opaque.data(), opaque.size());
+        out.occluders.error = lod.levels[level].error;
+    }
+
+    if(stop.stop_requested())
+        return false;
+
+    // в буфер индексов идут все уровни, у себя оставляем только таблицу уровней
+    inds = std::move(lod.indices);
+    lod.indices.clear();
+
+    // вершины в порядке первого обращения по всем уровням: окна номеров у соседних
+    // треугольников узкие, и подмеши почти не копируют вершин
+    OptimizeVertexFetch(verts, inds);
+    SplitMesh16Result split = SplitMesh16(verts, inds.data(), inds.size());
+    out.submeshes = std::move(split.submeshes);
+    out.indices = std::move(split.indices);
+    out.duplicatedVertices = split.duplicatedVertices;
+    inds.clear();
+    inds.shrink_to_fit();
+
+    if(stop.stop_requested())
+        return false;
+
+    out.quant = MakeQuantizeBounds(
+        Float3((bmin.x - center.x) * scale, (bmin.y - center.y) * scale, (bmin.z - center.z) * scale),
+        Float3((bmax.x - center.x) * scale, (bmax.y - center.y) * scale, (bmax.z - center.z) * scale));
+    out.vertices = PackVertices(verts.data(), verts.size(), out.quant);
+    out.quantError = MeasureQuantizeError(verts.data(), out.vertices.data(), verts.size(), out.quant);
+    return true;
+}
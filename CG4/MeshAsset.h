@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <stop_token>
+#include <vector>
+
+#include "MeshOptimizer.h"
+#include "Meshlets.h"
+#include "OcclusionBuffer.h"
+#include "SubmeshSplitter.h"
+#include "VertexPacking.h"
+#include "../shared/mesh_lod.h"
+
+// Меш сцены, готовый к загрузке в GPU: всё, что делает CPU между OBJ и буферами.
+// Без DirectX, поэтому собирается на рабочем потоке (JobQueue) и проверяется на Linux.
+
+// Kd и прозрачность, Ks и степень блика - раскладка корневых констант материала
+struct MeshAssetMaterial
+{
+    float baseColor[4];
+    float specular[4];
+};
+
+struct MeshAsset
+{
+    // буферы: упакованные вершины и 16-битные индексы всех уровней LOD подряд
+    std::vector<PackedVertex> vertices;
+    std::vector<uint16_t> indices;
+    std::vector<Submesh16> submeshes;
+    QuantizeBounds quant{};
+
+    // таблица уровней и групп (indices пуст), ошибки в мировых единицах
+    meshlod::Chain lod;
+    // бокс каждой группы в мировых единицах - уровень выбирается по расстоянию до него
+    std::vector<meshlod::Bounds> groupBounds;
+    // по материалу на батч (группу LOD), в порядке батчей; OBJ без usemtl - пусто, одна группа
+    std::vector<MeshAssetMaterial> materials;
+
+    // мешлеты уровня 0 - диапазоны буфера индексов; мешлеты батча g: [batchMeshlets[g], batchMeshlets[g + 1])
+    MeshletMesh meshlets;
+    std::vector<uint32_t> batchMeshlets;
+    // крупные непрозрачные треугольники почти точного уровня LOD - окклюдеры программного отсечения
+    OccluderMesh occluders;
+
+    // для отчёта
+    size_t objBatches = 0;
+    size_t duplicatedVertices = 0;
+    QuantizeError quantError{};
+    MeshOptimizeReport optimize{};
+};
+
+// OBJ -> MeshAsset: разбор (или кэш), цепочка LOD (или её кэш), мешлеты, порядок вершин,
+// разрезание на 16-битные подмеши и упаковка. Меш центрируется и масштабируется до размера
+// worldSize по наибольшей стороне. false - OBJ не прочитан или запрошена остановка:
+// stop проверяется между этапами, поэтому закрытие окна не ждёт всей загрузки.
+bool BuildMeshAsset(const std::filesystem::path& objPath, MeshAsset& out, float worldSize = 50.0f,
+                    std::stop_token stop = {});
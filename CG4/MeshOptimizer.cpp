@@ -0,0 +1,333 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // FIFO через метки времени: вершина в кэше, пока с её загрузки было меньше cacheSize промахов
+    class FifoCache
+    {
+    public:
+        FifoCache(size_t vertexCount, unsigned cacheSize)
+            : mStamp(vertexCount, 0), mSize(cacheSize), mTime(cacheSize + 1)
+        {
+        }
+
+        // true - промах (вершина преобразуется заново)
+        bool Touch(uint32_t v)
+        {
+            if(mTime - mStamp[v] <= mSize)
+                return false;
+            mStamp[v] = mTime++;
+            return true;
+        }
+
+        void Reset() { mTime += mSize + 1; }
+
+    private:
+        std::vector<uint32_t> mStamp;
+        uint32_t mSize;
+        uint32_t mTime;
+    };
+
+    struct Vec3d
+    {
+        double x = 0, y = 0, z = 0;
+    };
+}
+
+VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+    unsigned cacheSize)
+{
+    VertexCacheStats st;
+    if(indexCount < 3)
+        return st;
+
+    FifoCache cache(vertexCount, cacheSize);
+    std::vector<uint8_t> used(vertexCount, 0);
+    size_t misses = 0, unique = 0;
+    for(size_t i = 0; i < indexCount; ++i)
+    {
+        uint32_t v = indices[i];
+        if(v >= vertexCount)
+            continue;
+        misses += cache.Touch(v);
+        if(!used[v])
+        {
+            used[v] = 1;
+            ++unique;
+        }
+    }
+
+    st.acmr = (float)misses / (float)(indexCount / 3);
+    st.atvr = unique ? (float)misses / (float)unique : 0.0f;
+    return st;
+}
+
+void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount,
+    unsigned cacheSize, std::vector<uint32_t>* clusterStarts)
+{
+    const size_t triCount = indexCount / 3;
+    if(clusterStarts)
+        clusterStarts->assign(1, 0);
+    if(triCount == 0)
+        return;
+
+    // вершина -> треугольники (CSR) и число ещё не выведенных треугольников у вершины
+    std::vector<uint32_t> live(vertexCount, 0);
+    for(size_t i = 0; i < triCount * 3; ++i)
+        live[indices[i]]++;
+
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for(size_t v = 0; v < vertexCount; ++v)
+        offsets[v + 1] = offsets[v] + live[v];
+
+    std::vector<uint32_t> adj(triCount * 3);
+    {
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for(size_t i = 0; i < triCount * 3; ++i)
+            adj[fill[indices[i]]++] = (uint32_t)(i / 3);
+    }
+
+    std::vector<uint32_t> stamp(vertexCount, 0);
+    std::vector<uint8_t> emitted(triCount, 0);
+    std::vector<uint32_t> deadEnd;
+    deadEnd.reserve(triCount * 3);
+    std::vector<uint32_t> out;
+    out.reserve(triCount * 3);
+
+    const uint32_t k = cacheSize;
+    uint32_t time = k + 1;
+    size_t cursor = 0;
+    int64_t f = 0;
+    while(cursor < vertexCount && live[cursor] == 0)
+        ++cursor;
+    f = cursor < vertexCount ? (int64_t)cursor : -1;
+
+    while(f >= 0)
+    {
+        // все треугольники вокруг f
+        for(uint32_t a = offsets[f]; a < offsets[f + 1]; ++a)
+        {
+            uint32_t t = adj[a];
+            if(emitted[t])
+                continue;
+            emitted[t] = 1;
+            for(int c = 0; c < 3; ++c)
+            {
+                uint32_t v = indices[t * 3 + c];
+                out.push_back(v);
+                deadEnd.push_back(v);
+                live[v]--;
+                if(time - stamp[v] > k)
+                    stamp[v] = time++;
+            }
+        }
+
+        // следующая вершина из 1-окрестности: та, что дольше всех в кэше,
+        // но не вылетит из него, пока будут выводиться её оставшиеся треугольники
+        int64_t best = -1;
+        int64_t bestPriority = -1;
+        for(uint32_t a = offsets[f]; a < offsets[f + 1]; ++a)
+        {
+            uint32_t t = adj[a];
+            for(int c = 0; c < 3; ++c)
+            {
+                uint32_t v = indices[t * 3 + c];
+                if(live[v] == 0)
+                    continue;
+                int64_t age = (int64_t)time - stamp[v];
+                int64_t p = 0;
+                if(age + 2 * (int64_t)live[v] <= (int64_t)k)
+                    p = age;
+                if(p > bestPriority)
+                {
+                    bestPriority = p;
+                    best = v;
+                }
+            }
+        }
+
+        if(best < 0)
+        {
+            // тупик: недавние вершины из стека, иначе первая необработанная по порядку
+            while(!deadEnd.empty())
+            {
+                uint32_t v = deadEnd.back();
+                deadEnd.pop_back();
+                if(live[v] > 0)
+                {
+                    best = v;
+                    break;
+                }
+            }
+            if(best < 0)
+            {
+                while(cursor < vertexCount && live[cursor] == 0)
+                    ++cursor;
+                if(cursor < vertexCount)
+                    best = (int64_t)cursor;
+            }
+            if(best >= 0 && clusterStarts)
+                clusterStarts->push_back((uint32_t)(out.size() / 3));
+        }
+        f = best;
+    }
+
+    std::copy(out.begin(), out.end(), indices);
+}
+
+size_t OptimizeOverdraw(uint32_t* indices, size_t indexCount, const MeshVertex* vertices, size_t vertexCount,
+    const std::vector<uint32_t>& clusterStarts, unsigned cacheSize, float threshold)
+{
+    const size_t triCount = indexCount / 3;
+    if(triCount == 0)
+        return 0;
+
+    // мягкие границы внутри жёстких: кластер закрывается, как только его ACMR
+    // (с холодным кэшем) укладывается в threshold от ACMR всего меша
+    const float target = AnalyzeVertexCache(indices, indexCount, vertexCount, cacheSize).acmr * threshold;
+    std::vector<uint32_t> starts;
+    {
+        FifoCache cache(vertexCount, cacheSize);
+        std::vector<uint32_t> hard = clusterStarts;
+        hard.push_back((uint32_t)triCount);
+        for(size_t h = 0; h + 1 < hard.size(); ++h)
+        {
+            uint32_t start = hard[h];
+            size_t misses = 0;
+            cache.Reset();
+            starts.push_back(start);
+            for(uint32_t t = hard[h]; t < hard[h + 1]; ++t)
+            {
+                for(int c = 0; c < 3; ++c)
+                    misses += cache.Touch(indices[t * 3 + c]);
+
+                uint32_t n = t + 1 - start;
+                if(t + 1 < hard[h + 1] && n >= 16 && (float)misses / (float)n <= target)
+                {
+                    start = t + 1;
+                    misses = 0;
+                    cache.Reset();
+                    starts.push_back(start);
+                }
+            }
+        }
+    }
+    starts.push_back((uint32_t)triCount);
+
+    auto pos = [&](uint32_t v) { return vertices[v].pos; };
+
+    // центр меша по площади
+    Vec3d meshCenter;
+    double meshArea = 0;
+    std::vector<Vec3d> triCenter(triCount), triNormal(triCount);
+    for(size_t t = 0; t < triCount; ++t)
+    {
+        Float3 a = pos(indices[t * 3]), b = pos(indices[t * 3 + 1]), c = pos(indices[t * 3 + 2]);
+        Vec3d e1{ b.x - a.x, b.y - a.y, b.z - a.z };
+        Vec3d e2{ c.x - a.x, c.y - a.y, c.z - a.z };
+        Vec3d n{ e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x };
+        double area = 0.5 * std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+        triCenter[t] = { (a.x + b.x + c.x) / 3.0, (a.y + b.y + c.y) / 3.0, (a.z + b.z + c.z) / 3.0 };
+        triNormal[t] = n;
+        meshCenter.x += triCenter[t].x * area;
+        meshCenter.y += triCenter[t].y * area;
+        meshCenter.z += triCenter[t].z * area;
+        meshArea += area;
+    }
+    if(meshArea > 0)
+    {
+        meshCenter.x /= meshArea;
+        meshCenter.y /= meshArea;
+        meshCenter.z /= meshArea;
+    }
+
+    // ключ кластера: насколько его средняя нормаль смотрит от центра меша
+    const size_t clusterCount = starts.size() - 1;
+    std::vector<double> key(clusterCount, 0.0);
+    for(size_t c = 0; c < clusterCount; ++c)
+    {
+        Vec3d center, normal;
+        double area = 0;
+        for(uint32_t t = starts[c]; t < starts[c + 1]; ++t)
+        {
+            const Vec3d& n = triNormal[t];
+            double a = 0.5 * std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+            center.x += triCenter[t].x * a;
+            center.y += triCenter[t].y * a;
+            center.z += triCenter[t].z * a;
+            normal.x += n.x;
+            normal.y += n.y;
+            normal.z += n.z;
+            area += a;
+        }
+        if(area <= 0)
+            continue;
+        double len = std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+        if(len <= 0)
+            continue;
+        key[c] = ((center.x / area - meshCenter.x) * normal.x +
+                  (center.y / area - meshCenter.y) * normal.y +
+                  (center.z / area - meshCenter.z) * normal.z) / len;
+    }
+
+    std::vector<uint32_t> order(clusterCount);
+    for(size_t c = 0; c < clusterCount; ++c)
+        order[c] = (uint32_t)c;
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return key[a] > key[b]; });
+
+    std::vector<uint32_t> out;
+    out.reserve(triCount * 3);
+    for(uint32_t c : order)
+        out.insert(out.end(), indices + starts[c] * 3, indices + starts[c + 1] * 3);
+    std::copy(out.begin(), out.end(), indices);
+    return clusterCount;
+}
+
+void OptimizeVertexFetch(std::vector<MeshVertex>& vertices, std::vector<uint32_t>& indices)
+{
+    const uint32_t unused = ~0u;
+    std::vector<uint32_t> remap(vertices.size(), unused);
+    std::vector<MeshVertex> out;
+    out.reserve(vertices.size());
+
+    for(uint32_t& i : indices)
+    {
+        if(remap[i] == unused)
+        {
+            remap[i] = (uint32_t)out.size();
+            out.push_back(vertices[i]);
+        }
+        i = remap[i];
+    }
+    vertices.swap(out);
+}
+
+MeshOptimizeReport OptimizeMesh(std::vector<MeshVertex>& vertices, std::vector<uint32_t>& indices,
+    unsigned cacheSize, float overdrawThreshold)
+{
+    return OptimizeMesh(vertices, indices, std::vector<uint32_t>{ 0 }, cacheSize, overdrawThreshold);
+}
+
+MeshOptimizeReport OptimizeMesh(std::vector<MeshVertex>& vertices, std::vector<uint32_t>& indices,
+    const std::vector<uint32_t>& groupStarts, unsigned cacheSize, float overdrawThreshold)
+{
+    MeshOptimizeReport r;
+    r.before = AnalyzeVertexCache(indices.data(), indices.size(), vertices.size(), cacheSize);
+
+    std::vector<uint32_t> clusters;
+    for(size_t g = 0; g < groupStarts.size(); ++g)
+    {
+        const size_t first = groupStarts[g];
+        const size_t count = (g + 1 < groupStarts.size() ? groupStarts[g + 1] : indices.size()) - first;
+        OptimizeVertexCache(indices.data() + first, count, vertices.size(), cacheSize, &clusters);
+        r.clusters += OptimizeOverdraw(indices.data() + first, count, vertices.data(), vertices.size(),
+            clusters, cacheSize, overdrawThreshold);
+    }
+    OptimizeVertexFetch(vertices, indices);
+
+    r.after = AnalyzeVertexCache(indices.data(), indices.size(), vertices.size(), cacheSize);
+    return r;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "MeshTypes.h"
+
+// Порядок треугольников и вершин для GPU: кэш после преобразования (Tipsify, Sander 2007),
+// перерисовка (кластеры от внешних к внутренним) и локальность выборки вершин.
+// Чистый CPU, без DirectX.
+
+// ACMR - преобразованных вершин на треугольник, ATVR - на уникальную вершину (1.0 - идеал).
+// Считаются на FIFO-кэше из cacheSize вершин.
+struct VertexCacheStats
+{
+    float acmr = 0.0f;
+    float atvr = 0.0f;
+};
+
+VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+    unsigned cacheSize = 16);
+
+// Переставляет треугольники на месте. clusterStarts (если задан) получает номера треугольников,
+// с которых начинается прыжок в новое место меша - естественные границы кластеров.
+void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount,
+    unsigned cacheSize = 16, std::vector<uint32_t>* clusterStarts = nullptr);
+
+// Кластеры после OptimizeVertexCache дробятся, пока ACMR кластера не хуже threshold * ACMR меша,
+// и сортируются так, чтобы смотрящие наружу рисовались первыми. Возвращает число кластеров.
+size_t OptimizeOverdraw(uint32_t* indices, size_t indexCount, const MeshVertex* vertices, size_t vertexCount,
+    const std::vector<uint32_t>& clusterStarts, unsigned cacheSize = 16, float threshold = 1.05f);
+
+// Вершины в порядке первого обращения, неиспользуемые отбрасываются. Индексы переписываются.
+void OptimizeVertexFetch(std::vector<MeshVertex>& vertices, std::vector<uint32_t>& indices);
+
+struct MeshOptimizeReport
+{
+    VertexCacheStats before;
+    VertexCacheStats after;
+    size_t clusters = 0;
+};
+
+// все три прохода по порядку
+MeshOptimizeReport OptimizeMesh(std::vector<MeshVertex>& vertices, std::vector<uint32_t>& indices,
+    unsigned cacheSize = 16, float overdrawThreshold = 1.05f);
+
+// То же для меша из групп (материалов): кэш и перерисовка оптимизируются внутри каждой группы,
+// треугольники не переходят через границы. groupStarts - начала групп в indices, первая с 0.
+MeshOptimizeReport OptimizeMesh(std::vector<MeshVertex>& vertices, std::vector<uint32_t>& indices,
+    const std::vector<uint32_t>& groupStarts, unsigned cacheSize = 16, float overdrawThreshold = 1.05f);
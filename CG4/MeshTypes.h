@@ -0,0 +1,20 @@
+#pragma once
+#include <cstdint>
+
+// CPU-представление меша без DirectX: загрузчик, оптимизации и тесты на Linux.
+// Раскладка совпадает с XMFLOAT3 и входным layout шейдера.
+struct Float3
+{
+    float x = 0.0f;
+    float y = 0.0f;
+    float z = 0.0f;
+
+    Float3() = default;
+    constexpr Float3(float x_, float y_, float z_) : x(x_), y(y_), z(z_) {}
+};
+
+struct MeshVertex
+{
+    Float3 pos;
+    Float3 normal;
+};
@@ -0,0 +1,302 @@
+#include "Meshlets.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+    Float3 Sub(const Float3& a, const Float3& b) { return Float3(a.x - b.x, a.y - b.y, a.z - b.z); }
+    float Dot(const Float3& a, const Float3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+    Float3 Cross(const Float3& a, const Float3& b)
+    {
+        return Float3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+    }
+
+    void ComputeBounds(Meshlet& m, const MeshletMesh& mesh, const MeshVertex* vertices)
+    {
+        const uint32_t* local = &mesh.vertices[m.vertexOffset];
+        const uint8_t* tris = &mesh.triangles[m.triangleOffset * 3];
+
+        // сфера: центр ограничивающего бокса, радиус до самой дальней вершины
+        Float3 bmin(FLT_MAX, FLT_MAX, FLT_MAX), bmax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+        for(uint32_t i = 0; i < m.vertexCount; ++i)
+        {
+            const Float3& p = vertices[local[i]].pos;
+            bmin = Float3(std::min(bmin.x, p.x), std::min(bmin.y, p.y), std::min(bmin.z, p.z));
+            bmax = Float3(std::max(bmax.x, p.x), std::max(bmax.y, p.y), std::max(bmax.z, p.z));
+        }
+        m.boxMin = bmin;
+        m.boxMax = bmax;
+        m.center = Float3((bmin.x + bmax.x) * 0.5f, (bmin.y + bmax.y) * 0.5f, (bmin.z + bmax.z) * 0.5f);
+        float r2 = 0.0f;
+        for(uint32_t i = 0; i < m.vertexCount; ++i)
+        {
+            Float3 d = Sub(vertices[local[i]].pos, m.center);
+            r2 = std::max(r2, Dot(d, d));
+        }
+        m.radius = std::sqrt(r2);
+
+        // конус: ось - средняя нормаль, раствор - до самой отклонённой нормали
+        std::vector<Float3> normals;
+        normals.reserve(m.triangleCount);
+        Float3 axis;
+        for(uint32_t t = 0; t < m.triangleCount; ++t)
+        {
+            const Float3& a = vertices[local[tris[t * 3]]].pos;
+            const Float3& b = vertices[local[tris[t * 3 + 1]]].pos;
+            const Float3& c = vertices[local[tris[t * 3 + 2]]].pos;
+            Float3 n = Cross(Sub(b, a), Sub(c, a));
+            float len = std::sqrt(Dot(n, n));
+            if(len <= 0.0f)
+            {
+                normals.push_back(Float3());
+                continue;
+            }
+            n = Float3(n.x / len, n.y / len, n.z / len);
+            normals.push_back(n);
+            axis = Float3(axis.x + n.x, axis.y + n.y, axis.z + n.z);
+        }
+
+        m.coneAxis = Float3();
+        m.coneApex = m.center;
+        m.coneCutoff = 1.0f;
+        float axisLen = std::sqrt(Dot(axis, axis));
+        if(axisLen <= 0.0f)
+            return;
+        axis = Float3(axis.x / axisLen, axis.y / axisLen, axis.z / axisLen);
+
+        float minDot = 1.0f;
+        for(const Float3& n : normals)
+            if(Dot(n, n) > 0.0f)
+                minDot = std::min(minDot, Dot(n, axis));
+        // раствор больше ~84 градусов почти никогда ничего не отсекает
+        if(minDot <= 0.1f)
+            return;
+
+        // вершина конуса: точка на луче center - t*axis позади плоскостей всех треугольников
+        float maxT = 0.0f;
+        for(uint32_t t = 0; t < m.triangleCount; ++t)
+        {
+            const Float3& n = normals[t];
+            if(Dot(n, n) <= 0.0f)
+                continue;
+            const Float3& p0 = vertices[local[tris[t * 3]]].pos;
+            float dc = Dot(Sub(m.center, p0), n);
+            float dn = Dot(axis, n);
+            maxT = std::max(maxT, dc / dn);
+        }
+
+        m.coneAxis = axis;
+        m.coneApex = Float3(m.center.x - axis.x * maxT, m.center.y - axis.y * maxT, m.center.z - axis.z * maxT);
+        m.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+    }
+}
+
+MeshletMesh BuildMeshlets(const MeshVertex* vertices, size_t vertexCount,
+    const uint32_t* indices, size_t indexCount,
+    size_t maxVertices, size_t maxTriangles)
+{
+    MeshletMesh mesh;
+    maxVertices = std::clamp<size_t>(maxVertices, 3, 256);  // локальный индекс - байт
+    maxTriangles = std::max<size_t>(maxTriangles, 1);
+    const size_t triCount = indexCount / 3;
+    mesh.meshlets.reserve(triCount / maxTriangles + 1);
+    mesh.triangles.reserve(triCount * 3);
+    mesh.indices.reserve(triCount * 3);
+
+    // вершина -> треугольники
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for(size_t i = 0; i < triCount * 3; ++i)
+        offsets[indices[i] + 1]++;
+    for(size_t v = 0; v < vertexCount; ++v)
+        offsets[v + 1] += offsets[v];
+    std::vector<uint32_t> adj(triCount * 3);
+    {
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for(size_t i = 0; i < triCount * 3; ++i)
+            adj[fill[indices[i]]++] = (uint32_t)(i / 3);
+    }
+
+    std::vector<Float3> centroid(triCount);
+    for(size_t t = 0; t < triCount; ++t)
+    {
+        const Float3& a = vertices[indices[t * 3]].pos;
+        const Float3& b = vertices[indices[t * 3 + 1]].pos;
+        const Float3& c = vertices[indices[t * 3 + 2]].pos;
+        centroid[t] = Float3((a.x + b.x + c.x) / 3.0f, (a.y + b.y + c.y) / 3.0f, (a.z + b.z + c.z) / 3.0f);
+    }
+
+    // локальный номер вершины в текущем мешлете; owner - какому мешлету он принадлежит
+    std::vector<uint32_t> localId(vertexCount, 0);
+    std::vector<uint32_t> owner(vertexCount, ~0u);
+    std::vector<uint8_t> used(triCount, 0);
+    std::vector<uint32_t> candidates;
+    size_t seed = 0;
+
+    // Мешлет растёт по соседям: следующим берётся треугольник, добавляющий меньше всего
+    // новых вершин, при равенстве - ближайший к центру мешлета. Так кластеры компактны,
+    // а сферы и конусы нормалей - узкие. Без соседей мешлет закрывается.
+    for(;;)
+    {
+        while(seed < triCount && used[seed])
+            ++seed;
+        if(seed == triCount)
+            break;
+
+        const uint32_t id = (uint32_t)mesh.meshlets.size();
+        Meshlet m;
+        m.vertexOffset = (uint32_t)mesh.vertices.size();
+        m.triangleOffset = (uint32_t)(mesh.indices.size() / 3);
+        Float3 sum;
+
+        candidates.clear();
+        candidates.push_back((uint32_t)seed);
+
+        auto newVertices = [&](uint32_t t)
+        {
+            uint32_t n = 0;
+            for(int c = 0; c < 3; ++c)
+            {
+                uint32_t v = indices[t * 3 + c];
+                bool repeat = (c > 0 && v == indices[t * 3]) || (c == 2 && v == indices[t * 3 + 1]);
+                n += owner[v] != id && !repeat;
+            }
+            return n;
+        };
+
+        while(m.triangleCount < maxTriangles)
+        {
+            int64_t best = -1;
+            uint32_t bestNew = 4;
+            float bestDist = FLT_MAX;
+            Float3 center = m.triangleCount
+                ? Float3(sum.x / m.triangleCount, sum.y / m.triangleCount, sum.z / m.triangleCount)
+                : centroid[seed];
+            for(size_t k = 0; k < candidates.size(); )
+            {
+                uint32_t t = candidates[k];
+                if(used[t])
+                {
+                    candidates[k] = candidates.back();
+                    candidates.pop_back();
+                    continue;
+                }
+                uint32_t n = newVertices(t);
+                Float3 d = Sub(centroid[t], center);
+                float dist = Dot(d, d);
+                if(m.vertexCount + n <= maxVertices && (n < bestNew || (n == bestNew && dist < bestDist)))
+                {
+                    best = t;
+                    bestNew = n;
+                    bestDist = dist;
+                }
+                ++k;
+            }
+            if(best < 0)
+                break;
+
+            uint32_t t = (uint32_t)best;
+            used[t] = 1;
+            for(int c = 0; c < 3; ++c)
+            {
+                uint32_t v = indices[t * 3 + c];
+                if(owner[v] != id)
+                {
+                    owner[v] = id;
+                    localId[v] = m.vertexCount++;
+                    mesh.vertices.push_back(v);
+                    for(uint32_t a = offsets[v]; a < offsets[v + 1]; ++a)
+                        if(!used[adj[a]])
+                            candidates.push_back(adj[a]);
+                }
+                mesh.triangles.push_back((uint8_t)localId[v]);
+                mesh.indices.push_back(v);
+            }
+            sum = Float3(sum.x + centroid[t].x, sum.y + centroid[t].y, sum.z + centroid[t].z);
+            m.triangleCount++;
+        }
+        mesh.meshlets.push_back(m);
+    }
+
+    for(Meshlet& m : mesh.meshlets)
+        ComputeBounds(m, mesh, vertices);
+    return mesh;
+}
+
+Frustum FrustumFromViewProj(const float m[16])
+{
+    // столбцы построчной матрицы: clip = (x, y, z, 1) * M
+    auto col = [&](int j, float out[4])
+    {
+        for(int i = 0; i < 4; ++i)
+            out[i] = m[i * 4 + j];
+    };
+    float c0[4], c1[4], c2[4], c3[4];
+    col(0, c0); col(1, c1); col(2, c2); col(3, c3);
+
+    Frustum f;
+    for(int i = 0; i < 4; ++i)
+    {
+        f.planes[0][i] = c3[i] + c0[i];     // левая
+        f.planes[1][i] = c3[i] - c0[i];     // правая
+        f.planes[2][i] = c3[i] + c1[i];     // нижняя
+        f.planes[3][i] = c3[i] - c1[i];     // верхняя
+        f.planes[4][i] = c2[i];             // ближняя, z >= 0
+        f.planes[5][i] = c3[i] - c2[i];     // дальняя
+    }
+    for(auto& p : f.planes)
+    {
+        float len = std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+        if(len > 0.0f)
+            for(float& x : p)
+                x /= len;
+    }
+    return f;
+}
+
+void CullMeshlets(const MeshletMesh& mesh, const Frustum& frustum, const Float3& eye,
+    std::vector<uint32_t>& visible, MeshletCullStats* stats)
+{
+    MeshletCullStats st;
+    st.meshlets = mesh.meshlets.size();
+    visible.clear();
+
+    for(size_t i = 0; i < mesh.meshlets.size(); ++i)
+    {
+        const Meshlet& m = mesh.meshlets[i];
+        st.triangles += m.triangleCount;
+
+        bool inside = true;
+        for(const auto& p : frustum.planes)
+        {
+            if(p[0] * m.center.x + p[1] * m.center.y + p[2] * m.center.z + p[3] < -m.radius)
+            {
+                inside = false;
+                break;
+            }
+        }
+        if(!inside)
+        {
+            st.frustumCulled += m.triangleCount;
+            continue;
+        }
+
+        if(m.coneCutoff < 1.0f)
+        {
+            Float3 d = Sub(m.coneApex, eye);
+            float len = std::sqrt(Dot(d, d));
+            if(len > 0.0f && Dot(d, m.coneAxis) >= m.coneCutoff * len)
+            {
+                st.backfaceCulled += m.triangleCount;
+                continue;
+            }
+        }
+
+        visible.push_back((uint32_t)i);
+    }
+
+    st.visibleMeshlets = visible.size();
+    if(stats)
+        *stats = st;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "MeshTypes.h"
+
+// Мешлеты: кластеры до 64 вершин и 124 треугольников с ограничивающей сферой
+// и конусом нормалей для отсечения целых кластеров на CPU. Без DirectX.
+
+struct Meshlet
+{
+    uint32_t vertexOffset = 0;      // в MeshletMesh::vertices
+    uint32_t vertexCount = 0;
+    uint32_t triangleOffset = 0;    // в треугольниках: MeshletMesh::triangles[3 * triangleOffset]
+    uint32_t triangleCount = 0;
+
+    Float3 center;
+    float radius = 0.0f;
+    Float3 boxMin;                  // ограничивающий бокс - для отсечения перекрытых
+    Float3 boxMax;
+
+    // все треугольники смотрят от камеры, если dot(normalize(coneApex - eye), coneAxis) >= coneCutoff;
+    // coneCutoff >= 1 - нормали слишком разные, конус не отсекает
+    Float3 coneApex;
+    Float3 coneAxis;
+    float coneCutoff = 1.0f;
+};
+
+struct MeshletMesh
+{
+    std::vector<Meshlet> meshlets;
+    std::vector<uint32_t> vertices;     // глобальные номера вершин
+    std::vector<uint8_t> triangles;     // локальные индексы, по 3 на треугольник
+
+    // те же треугольники глобальными индексами в порядке мешлетов - для обычного IA:
+    // мешлет m - диапазон [FirstIndex(m), FirstIndex(m) + 3 * triangleCount)
+    std::vector<uint32_t> indices;
+    uint32_t FirstIndex(const Meshlet& m) const { return m.triangleOffset * 3; }
+};
+
+// Жадный рост по соседним треугольникам до лимитов по вершинам и треугольникам.
+// Каждый треугольник входа попадает ровно в один мешлет.
+MeshletMesh BuildMeshlets(const MeshVertex* vertices, size_t vertexCount,
+    const uint32_t* indices, size_t indexCount,
+    size_t maxVertices = 64, size_t maxTriangles = 124);
+
+// плоскости ax + by + cz + d >= 0 внутри
+struct Frustum
+{
+    float planes[6][4] = {};
+};
+
+// viewProj - построчная матрица в соглашении D3D (вектор-строка, z клипа в [0, 1])
+Frustum FrustumFromViewProj(const float viewProj[16]);
+
+struct MeshletCullStats
+{
+    size_t meshlets = 0;
+    size_t visibleMeshlets = 0;
+    size_t triangles = 0;
+    size_t frustumCulled = 0;       // треугольников
+    size_t backfaceCulled = 0;
+    size_t occlusionCulled = 0;     // заполняет вызывающий (RemoveOccludedMeshlets)
+};
+
+// visible получает номера видимых мешлетов по возрастанию
+void CullMeshlets(const MeshletMesh& mesh, const Frustum& frustum, const Float3& eye,
+    std::vector<uint32_t>& visible, MeshletCullStats* stats = nullptr);
@@ -0,0 +1,196 @@
+#include "ObjLoader.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "ObjParser.h"
+#include "../shared/mesh_cache.h"
+#include "../shared/mesh_normals.h"
+
+static bool LoadObjCache(const std::filesystem::path& path,
+    const meshcache::SourceStamp& stamp,
+    std::vector<MeshVertex>& outVertices,
+    std::vector<uint32_t>& outIndices,
+    Float3& outMin,
+    Float3& outMax,
+    objmat::Usage& outUsage,
+    std::vector<objmat::Batch>& outBatches)
+{
+    using namespace meshcache;
+
+    Reader cache;
+    if(!cache.open(path, stamp))
+        return false;
+
+    // свой кэш: сваренные вершины Position|Normal, ровно как MeshVertex
+    const Stream* vs = cache.stream(StreamKind::Vertices);
+    const Stream* is = cache.stream(StreamKind::Indices);
+    if(cache.header().vertexFormat != (Position | Normal) || !vs || !is || vs->count == 0 ||
+        is->count == 0 || is->count % 3 != 0 || vs->stride != sizeof(MeshVertex) || is->stride != sizeof(uint32_t))
+        return false;
+
+    outVertices.resize((size_t)vs->count);
+    memcpy(outVertices.data(), cache.data(*vs), sizeof(MeshVertex) * outVertices.size());
+
+    outIndices.resize((size_t)is->count);
+    memcpy(outIndices.data(), cache.data(*is), sizeof(uint32_t) * outIndices.size());
+    // индекс вне массива (порча файла) ведёт на вершину 0, как в парсере
+    for(uint32_t& i : outIndices)
+        if(i >= vs->count)
+            i = 0;
+
+    // батчи обязаны покрыть все грани подряд, иначе кэш не наш
+    outUsage = objmat::Usage{};
+    outBatches.clear();
+    const Stream* ms = cache.stream(StreamKind::Materials);
+    const Stream* bs = cache.stream(StreamKind::Batches);
+    if(ms && bs)
+    {
+        if(ms->stride != 1 || bs->stride != sizeof(objmat::Batch))
+            return false;
+        outUsage = objmat::Usage::parse(std::string_view(static_cast<const char*>(cache.data(*ms)), (size_t)ms->count));
+        const objmat::Batch* b = static_cast<const objmat::Batch*>(cache.data(*bs));
+        outBatches.assign(b, b + bs->count);
+        uint64_t next = 0;
+        for(const objmat::Batch& batch : outBatches)
+        {
+            if(batch.first != next || batch.material >= outUsage.names.size())
+                return false;
+            next += batch.count;
+        }
+        if(next * 3 != is->count)
+            return false;
+    }
+
+    const Header& h = cache.header();
+    outMin = Float3(h.bboxMin[0], h.bboxMin[1], h.bboxMin[2]);
+    outMax = Float3(h.bboxMax[0], h.bboxMax[1], h.bboxMax[2]);
+    return true;
+}
+
+// Нормали по геометрии: вершина на изломе раздваивается, по вершине на каждую нормаль
+static void GenerateNormals(std::vector<MeshVertex>& vertices, std::vector<uint32_t>& indices)
+{
+    meshnormals::Result n = meshnormals::generate(&vertices[0].pos.x, sizeof(MeshVertex), vertices.size(),
+        indices.data(), indices.size());
+
+    std::vector<MeshVertex> out(n.count());
+    for(size_t i = 0; i < out.size(); ++i)
+    {
+        out[i].pos = vertices[n.vertex[i]].pos;
+        out[i].normal = Float3(n.normals[i * 3], n.normals[i * 3 + 1], n.normals[i * 3 + 2]);
+    }
+    vertices.swap(out);
+    indices = std::move(n.corner);
+}
+
+static void SaveObjCache(const std::filesystem::path& path,
+    const meshcache::SourceStamp& stamp,
+    const std::vector<MeshVertex>& vertices,
+    const std::vector<uint32_t>& indices,
+    const Float3& bmin,
+    const Float3& bmax,
+    const objmat::Usage& usage,
+    const std::vector<objmat::Batch>& batches)
+{
+    using namespace meshcache;
+    static_assert(sizeof(MeshVertex) == 24, "MeshVertex must match Position|Normal layout");
+    static_assert(sizeof(objmat::Batch) == 12, "Batch is stored as is");
+
+    const float lo[3] = { bmin.x, bmin.y, bmin.z };
+    const float hi[3] = { bmax.x, bmax.y, bmax.z };
+    const std::string names = usage.serialize();
+    const StreamData streams[] = {
+        { StreamKind::Vertices,  sizeof(MeshVertex),    vertices.size(), vertices.data() },
+        { StreamKind::Indices,   sizeof(uint32_t),      indices.size(),  indices.data() },
+        { StreamKind::Materials, 1,                     names.size(),    names.data() },
+        { StreamKind::Batches,   sizeof(objmat::Batch), batches.size(),  batches.data() },
+    };
+    // кэш необязателен: если каталог только для чтения, просто разбираем OBJ в следующий раз
+    write(path, stamp, Position | Normal, lo, hi, streams, batches.empty() ? 2 : 4);
+}
+
+bool LoadObjSimple(const std::filesystem::path& path,
+    std::vector<MeshVertex>& outVertices,
+    std::vector<uint32_t>& outIndices,
+    Float3& outMin,
+    Float3& outMax,
+    MeshOptimizeReport* report,
+    ObjMaterials* outMaterials)
+{
+    namespace fs = std::filesystem;
+
+    objmat::Usage usage;
+    std::vector<objmat::Material> materials;
+    std::vector<objmat::Batch> batches;
+    auto publishMaterials = [&]()
+    {
+        if(!outMaterials)
+            return;
+        if(materials.empty() && !usage.empty())
+            materials = objmat::resolve(path, usage);
+        outMaterials->materials = std::move(materials);
+        outMaterials->batches = std::move(batches);
+    };
+
+    // повторный запуск: отображаем кэш вместо разбора текста
+    meshcache::SourceStamp stamp{};
+    const bool stamped = meshcache::stamp_source(path, stamp);
+    const fs::path cachePath = meshcache::cache_path(path, "cg4");
+    if(stamped && LoadObjCache(cachePath, stamp, outVertices, outIndices, outMin, outMax, usage, batches))
+    {
+        publishMaterials();
+        if(report)
+        {
+            *report = MeshOptimizeReport{};
+            report->before = report->after =
+                AnalyzeVertexCache(outIndices.data(), outIndices.size(), outVertices.size());
+        }
+        return true;
+    }
+
+    // разбор по кускам на всех ядрах; результат тот же, что у построчного ParseObjSerial
+    ObjParseResult parsed;
+    if(!ParseObj(path, parsed))
+        return false;
+    outVertices = std::move(parsed.vertices);
+    outIndices = std::move(parsed.indices);
+    outMin = parsed.min;
+    outMax = parsed.max;
+    usage = std::move(parsed.usage);
+    std::vector<uint32_t>& faceMaterial = parsed.faceMaterial;
+    const uint32_t noMaterial = ObjParseResult::kNoMaterial;
+
+    // без vn все нормали были бы (0, 1, 0): считаем гладкие с изломом по углу
+    if(parsed.normalCount == 0)
+        GenerateNormals(outVertices, outIndices);
+
+    // грани одного материала - подряд, чтобы батч рисовался одним вызовом
+    std::vector<uint32_t> groupStarts{ 0 };
+    if(!usage.empty())
+    {
+        const uint32_t untagged = std::find(faceMaterial.begin(), faceMaterial.end(), noMaterial) != faceMaterial.end()
+            ? usage.use("") : noMaterial;
+        for(uint32_t& m : faceMaterial)
+            if(m == noMaterial)
+                m = untagged;
+
+        std::vector<uint32_t> order;
+        materials = objmat::resolve(path, usage);
+        batches = objmat::group_faces(faceMaterial, materials, order);
+        objmat::reorder_faces(outIndices, order);
+        groupStarts.clear();
+        for(const objmat::Batch& b : batches)
+            groupStarts.push_back(b.first * 3);
+    }
+
+    // порядок файла плох для кэша вершин GPU: оптимизируем один раз и кэшируем результат
+    MeshOptimizeReport optimized = OptimizeMesh(outVertices, outIndices, groupStarts);
+    if(report)
+        *report = optimized;
+
+    if(stamped)
+        SaveObjCache(cachePath, stamp, outVertices, outIndices, outMin, outMax, usage, batches);
+    publishMaterials();
+    return true;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <filesystem>
+#include <vector>
+
+#include "MeshTypes.h"
+#include "MeshOptimizer.h"
+#include "../shared/obj_material.h"
+
+// материалы из mtllib/usemtl; грани сгруппированы так, что каждый батч - сплошной
+// диапазон индексов [3 * first, 3 * (first + count)). Без usemtl оба массива пусты.
+struct ObjMaterials
+{
+    std::vector<objmat::Material> materials;
+    std::vector<objmat::Batch> batches;
+};
+
+// OBJ -> вершины (позиция, нормаль) без повторов и индексы треугольников; текст разбирается
+// параллельно (ParseObj).
+// После разбора порядок оптимизируется (OptimizeMesh), результат пишется в двоичный кэш
+// <obj>.cg4.cgmb рядом с OBJ, следующий запуск читает его как есть.
+// report - ACMR/ATVR до и после; при чтении из кэша before == after.
+// Порядок оптимизируется внутри батчей материалов, .mtl читается при каждой загрузке.
+// OBJ без vn получает гладкие нормали (meshnormals) с изломом 60 градусов.
+bool LoadObjSimple(const std::filesystem::path& path,
+    std::vector<MeshVertex>& outVertices,
+    std::vector<uint32_t>& outIndices,
+    Float3& outMin,
+    Float3& outMax,
+    MeshOptimizeReport* report = nullptr,
+    ObjMaterials* outMaterials = nullptr);
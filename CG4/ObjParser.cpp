@@ -0,0 +1,464 @@
+#include "ObjParser.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <fstream>
+#include <sstream>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+#include "../shared/mapped_file.h"
+#include "../shared/parallel.h"
+#include "../shared/obj_tokens.h"
+
+namespace
+{
+    // Ключ угла: старшие 32 бита - позиция, младшие - нормаль как в файле (вместе с -1 и выходом
+    // за массив: так же различает вершины и последовательный парсер).
+    // Бит 63 - у угла нормали ещё нет; в сравнение не входит, нужен первому вхождению.
+    constexpr uint64_t kBadCorner = ~0ull;      // позиция вне массива -> индекс 0
+    constexpr uint64_t kNoNormal = 1ull << 63;
+    constexpr uint64_t kKeyMask = ~kNoNormal;
+
+    constexpr uint32_t kInherited = UINT32_MAX - 1;     // материал от предыдущих кусков
+
+    uint64_t Mix(uint64_t h)
+    {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+    }
+
+    struct ObjChunk
+    {
+        const char* begin = nullptr;
+        const char* end = nullptr;
+
+        size_t positionCount = 0;
+        size_t normalCount = 0;
+        size_t positionBase = 0;
+        size_t normalBase = 0;
+        size_t cornerBase = 0;
+
+        std::vector<uint64_t> corners;          // три ключа на треугольник
+        std::vector<uint32_t> faceMaterial;     // номер в names или kInherited
+        std::vector<std::string_view> names;    // usemtl в порядке первого появления в куске
+        std::vector<std::string_view> libs;
+        uint32_t lastMaterial = kInherited;     // действует на начало следующего куска
+    };
+
+    std::string_view Rest(const char* s, const char* e)
+    {
+        s = obj::skip_ws(s, e);
+        while(e > s && (e[-1] == ' ' || e[-1] == '\t' || e[-1] == '\r'))
+            --e;
+        return std::string_view(s, (size_t)(e - s));
+    }
+
+    void CountChunk(ObjChunk& ch)
+    {
+        for(const char* p = ch.begin; p < ch.end; )
+        {
+            const char* e = obj::line_end(p, ch.end);
+            const char* s = obj::skip_ws(p, e);
+            p = e + 1;
+            if(obj::tag(s, e, "v"))
+                ++ch.positionCount;
+            else if(obj::tag(s, e, "vn"))
+                ++ch.normalCount;
+        }
+    }
+
+    // позиции и нормали пишутся сразу на свои места в общих массивах
+    void ParseChunk(ObjChunk& ch, Float3* positions, Float3* normals)
+    {
+        size_t np = ch.positionBase;
+        size_t nn = ch.normalBase;
+        uint32_t material = kInherited;
+        std::vector<uint64_t> face;
+        face.reserve(8);
+
+        for(const char* p = ch.begin; p < ch.end; )
+        {
+            const char* e = obj::line_end(p, ch.end);
+            const char* s = obj::skip_ws(p, e);
+            p = e + 1;
+
+            if(obj::tag(s, e, "v"))
+            {
+                Float3 v{};
+                obj::parse_float(s, e, v.x);
+                obj::parse_float(s, e, v.y);
+                obj::parse_float(s, e, v.z);
+                positions[np++] = v;
+            }
+            else if(obj::tag(s, e, "vn"))
+            {
+                Float3 n{};
+                obj::parse_float(s, e, n.x);
+                obj::parse_float(s, e, n.y);
+                obj::parse_float(s, e, n.z);
+                normals[nn++] = n;
+            }
+            else if(obj::tag(s, e, "f"))
+            {
+                face.clear();
+                long v, vt, vn;
+                while(obj::parse_corner(s, e, v, vt, vn))
+                {
+                    // индексы относительно уже прочитанных строк, как у последовательного разбора
+                    const int vi = obj::fix_index(v, np);
+                    const int ni = obj::fix_index(vn, nn);
+                    if(vi < 0 || vi >= (int)np)
+                    {
+                        face.push_back(kBadCorner);
+                        continue;
+                    }
+                    uint64_t key = (uint64_t)(uint32_t)vi << 32 | (uint32_t)ni;
+                    if(ni < 0 || ni >= (int)nn)
+                        key |= kNoNormal;
+                    face.push_back(key);
+                }
+                if(face.size() < 3)
+                    continue;
+
+                for(size_t k = 1; k + 1 < face.size(); ++k)
+                {
+                    ch.corners.insert(ch.corners.end(), { face[0], face[k], face[k + 1] });
+                    ch.faceMaterial.push_back(material);
+                }
+            }
+            else if(obj::tag(s, e, "usemtl"))
+            {
+                const std::string_view name = Rest(s, e);
+                auto it = std::find(ch.names.begin(), ch.names.end(), name);
+                material = (uint32_t)(it - ch.names.begin());
+                if(it == ch.names.end())
+                    ch.names.push_back(name);
+            }
+            else if(obj::tag(s, e, "mtllib"))
+            {
+                ch.libs.push_back(Rest(s, e));
+            }
+        }
+        ch.lastMaterial = material;
+    }
+}
+
+bool ParseObjSerial(const std::filesystem::path& path, ObjParseResult& out)
+{
+    std::ifstream file(path);
+    if(!file.is_open())
+        return false;
+
+    std::vector<Float3> positions;
+    std::vector<Float3> normals;
+
+    positions.reserve(100000);
+    normals.reserve(100000);
+
+    std::vector<MeshVertex>& outVertices = out.vertices;
+    std::vector<uint32_t>& outIndices = out.indices;
+    Float3& outMin = out.min;
+    Float3& outMax = out.max;
+    objmat::Usage& usage = out.usage;
+    std::vector<uint32_t>& faceMaterial = out.faceMaterial;
+
+    outVertices.clear();
+    outIndices.clear();
+    outVertices.reserve(200000);
+    outIndices.reserve(400000);
+    usage = objmat::Usage{};
+    faceMaterial.clear();
+    faceMaterial.reserve(130000);
+
+    outMin = Float3(+FLT_MAX, +FLT_MAX, +FLT_MAX);
+    outMax = Float3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+    struct Key
+    {
+        int v = 0;
+        int n = 0;
+        bool operator==(const Key& o) const noexcept { return v == o.v && n == o.n; }
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& k) const noexcept
+        {
+            return (static_cast<size_t>(k.v) * 73856093u) ^ (static_cast<size_t>(k.n) * 19349663u);
+        }
+    };
+
+    std::unordered_map<Key, uint32_t, KeyHash> remap;
+    remap.reserve(200000);
+
+    uint32_t material = ObjParseResult::kNoMaterial;
+
+    auto fixIndex = [](int idx, int count) -> int {
+        if(idx > 0) return idx - 1;
+        if(idx < 0) return count + idx;
+        return -1;
+    };
+
+    auto parseFaceVertex = [](const std::string& token, int& outV, int& outN)
+    {
+        outV = 0;
+        outN = 0;
+
+        int v = 0, vt = 0, vn = 0;
+
+        size_t s1 = token.find('/');
+        if(s1 == std::string::npos)
+        {
+            v = std::stoi(token);
+        }
+        else
+        {
+            std::string a = token.substr(0, s1);
+            v = a.empty() ? 0 : std::stoi(a);
+
+            size_t s2 = token.find('/', s1 + 1);
+            if(s2 == std::string::npos)
+            {
+                std::string b = token.substr(s1 + 1);
+                vt = b.empty() ? 0 : std::stoi(b);
+            }
+            else
+            {
+                std::string b = token.substr(s1 + 1, s2 - (s1 + 1));
+                std::string c = token.substr(s2 + 1);
+                vt = b.empty() ? 0 : std::stoi(b);
+                vn = c.empty() ? 0 : std::stoi(c);
+            }
+        }
+
+        outV = v;
+        outN = vn;
+        (void)vt;
+    };
+
+    std::string line;
+    while(std::getline(file, line))
+    {
+        if(line.empty())
+            continue;
+
+
+        if(line[0] == '#')
+            continue;
+
+        std::istringstream iss(line);
+        std::string tag;
+        iss >> tag;
+
+        if(tag == "v")
+        {
+            Float3 p{};
+            iss >> p.x >> p.y >> p.z;
+            positions.push_back(p);
+        }
+        else if(tag == "vn")
+        {
+            Float3 n{};
+            iss >> n.x >> n.y >> n.z;
+            normals.push_back(n);
+        }
+        else if(tag == "usemtl" || tag == "mtllib")
+        {
+            std::string name;
+            std::getline(iss >> std::ws, name);
+            while(!name.empty() && (name.back() == '\r' || name.back() == ' '))
+                name.pop_back();
+            if(tag == "usemtl")
+                material = usage.use(name);
+            else
+                usage.add_lib(name);
+        }
+        else if(tag == "f")
+        {
+            std::vector<std::string> tokens;
+            tokens.reserve(8);
+
+            std::string tok;
+            while(iss >> tok)
+                tokens.push_back(tok);
+
+            if(tokens.size() < 3)
+                continue;
+
+            auto emit = [&](const std::string& t) -> uint32_t
+            {
+                int vRaw = 0, nRaw = 0;
+                parseFaceVertex(t, vRaw, nRaw);
+
+                int vi = fixIndex(vRaw, (int)positions.size());
+                int ni = fixIndex(nRaw, (int)normals.size());
+
+                if(vi < 0 || vi >= (int)positions.size())
+                    return 0;
+
+                Key key{vi, ni};
+                auto it = remap.find(key);
+                if(it != remap.end())
+                    return it->second;
+
+                MeshVertex vx{};
+                vx.pos = positions[vi];
+                if(ni >= 0 && ni < (int)normals.size())
+                    vx.normal = normals[ni];
+                else
+                    vx.normal = Float3(0, 1, 0);
+
+                outMin.x = std::min(outMin.x, vx.pos.x);
+                outMin.y = std::min(outMin.y, vx.pos.y);
+                outMin.z = std::min(outMin.z, vx.pos.z);
+                outMax.x = std::max(outMax.x, vx.pos.x);
+                outMax.y = std::max(outMax.y, vx.pos.y);
+                outMax.z = std::max(outMax.z, vx.pos.z);
+
+                uint32_t newIndex = (uint32_t)outVertices.size();
+                outVertices.push_back(vx);
+                remap.emplace(key, newIndex);
+                return newIndex;
+            };
+
+            for(size_t k = 1; k + 1 < tokens.size(); ++k)
+            {
+                uint32_t i0 = emit(tokens[0]);
+                uint32_t i1 = emit(tokens[k]);
+                uint32_t i2 = emit(tokens[k + 1]);
+                outIndices.push_back(i0);
+                outIndices.push_back(i1);
+                outIndices.push_back(i2);
+                faceMaterial.push_back(material);
+            }
+        }
+    }
+
+    out.normalCount = normals.size();
+    return !outVertices.empty() && !outIndices.empty();
+}
+
+bool ParseObj(const std::filesystem::path& path, ObjParseResult& out, unsigned threads)
+{
+    MappedFile file;
+    if(!file.open(path))
+        return false;
+
+    const char* data = file.data();
+    const size_t size = file.size();
+
+    // куски не мельче 64 КБ: на мелких файлах потоки дороже разбора
+    if(threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = (unsigned)std::clamp<size_t>(std::min<size_t>(threads, size >> 16), 1, 64);
+
+    // 1. куски по границам строк
+    std::vector<ObjChunk> chunks(threads);
+    const char* prev = data;
+    for(unsigned t = 0; t < threads; ++t)
+    {
+        const char* end = data + size;
+        if(t + 1 < threads)
+        {
+            end = std::max(prev, data + size * (t + 1) / threads);
+            end = end < data + size ? obj::line_end(end, data + size) + 1 : end;
+            end = std::min(end, data + size);
+        }
+        chunks[t].begin = prev;
+        chunks[t].end = end;
+        prev = end;
+    }
+
+    // 2. число позиций и нормалей в кусках -> смещения кусков в общих массивах
+    parallel::run_threads((int)threads, [&](unsigned t) { CountChunk(chunks[t]); });
+    size_t positionCount = 0, normalCount = 0;
+    for(ObjChunk& ch : chunks)
+    {
+        ch.positionBase = positionCount;
+        ch.normalBase = normalCount;
+        positionCount += ch.positionCount;
+        normalCount += ch.normalCount;
+    }
+
+    // 3. разбор
+    std::vector<Float3> positions(positionCount);
+    std::vector<Float3> normals(normalCount);
+    parallel::run_threads((int)threads, [&](unsigned t) { ParseChunk(chunks[t], positions.data(), normals.data()); });
+
+    // 4. материалы: номера в порядке первого usemtl по всему файлу
+    objmat::Usage& usage = out.usage;
+    usage = objmat::Usage{};
+    size_t cornerCount = 0;
+    std::vector<std::vector<uint32_t>> materialMap(threads);
+    std::vector<uint32_t> inherited(threads);
+    uint32_t current = ObjParseResult::kNoMaterial;
+    for(unsigned t = 0; t < threads; ++t)
+    {
+        ObjChunk& ch = chunks[t];
+        for(std::string_view lib : ch.libs)
+            usage.add_lib(lib);
+        for(std::string_view name : ch.names)
+            materialMap[t].push_back(usage.use(name));
+        inherited[t] = current;
+        if(ch.lastMaterial != kInherited)
+            current = materialMap[t][ch.lastMaterial];
+        ch.cornerBase = cornerCount;
+        cornerCount += ch.corners.size();
+    }
+
+    // 5. углы и материалы граней подряд, в порядке файла
+    const size_t C = cornerCount;
+    std::vector<uint64_t> keys(C);
+    out.faceMaterial.resize(C / 3);
+    parallel::run_threads((int)threads, [&](unsigned t) {
+        const ObjChunk& ch = chunks[t];
+        std::copy(ch.corners.begin(), ch.corners.end(), keys.begin() + ch.cornerBase);
+        uint32_t* fm = out.faceMaterial.data() + ch.cornerBase / 3;
+        for(size_t f = 0; f < ch.faceMaterial.size(); ++f)
+            fm[f] = ch.faceMaterial[f] == kInherited ? inherited[t] : materialMap[t][ch.faceMaterial[f]];
+    });
+    for(ObjChunk& ch : chunks)
+        ch.corners = std::vector<uint64_t>();
+
+    // 6. дубликаты углов сливаются параллельно, номера вершин - по первому вхождению
+    parallel::Dedup d = parallel::dedup(C, (int)threads,
+        [&](size_t c) { return keys[c] & kKeyMask; },
+        [&](size_t c) { return Mix(keys[c] & kKeyMask); },
+        [&](size_t c) { return keys[c] == kBadCorner; });
+
+    // 7. вершины и бокс; у пропущенного угла индекс 0
+    const size_t V = d.first.size();
+    out.vertices.resize(V);
+    out.indices = std::move(d.index);
+    std::vector<Float3> mins(threads, Float3(+FLT_MAX, +FLT_MAX, +FLT_MAX));
+    std::vector<Float3> maxs(threads, Float3(-FLT_MAX, -FLT_MAX, -FLT_MAX));
+    parallel::run_threads((int)threads, [&](unsigned t) {
+        Float3& lo = mins[t];
+        Float3& hi = maxs[t];
+        for(size_t i = V * t / threads; i < V * (t + 1) / threads; ++i)
+        {
+            const uint64_t key = keys[d.first[i]];
+            MeshVertex& v = out.vertices[i];
+            v.pos = positions[(size_t)((key & kKeyMask) >> 32)];
+            v.normal = key & kNoNormal ? Float3(0, 1, 0) : normals[(uint32_t)key];
+            lo = Float3(std::min(lo.x, v.pos.x), std::min(lo.y, v.pos.y), std::min(lo.z, v.pos.z));
+            hi = Float3(std::max(hi.x, v.pos.x), std::max(hi.y, v.pos.y), std::max(hi.z, v.pos.z));
+        }
+    });
+
+    out.normalCount = normalCount;
+    out.min = mins[0];
+    out.max = maxs[0];
+    for(unsigned t = 1; t < threads; ++t)
+    {
+        out.min = Float3(std::min(out.min.x, mins[t].x), std::min(out.min.y, mins[t].y), std::min(out.min.z, mins[t].z));
+        out.max = Float3(std::max(out.max.x, maxs[t].x), std::max(out.max.y, maxs[t].y), std::max(out.max.z, maxs[t].z));
+    }
+    return !out.vertices.empty() && !out.indices.empty();
+}
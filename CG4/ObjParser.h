@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "MeshTypes.h"
+#include "../shared/obj_material.h"
+
+// Результат разбора OBJ: вершины (позиция, нормаль) без повторов в порядке первого появления,
+// индексы треугольников в порядке файла (многоугольники веером) и материал каждого треугольника.
+struct ObjParseResult
+{
+    static constexpr uint32_t kNoMaterial = UINT32_MAX;     // грани до первого usemtl
+
+    std::vector<MeshVertex> vertices;
+    std::vector<uint32_t> indices;
+    Float3 min;
+    Float3 max;
+    objmat::Usage usage;
+    std::vector<uint32_t> faceMaterial;
+    size_t normalCount = 0;     // строк vn; 0 - нормали у всех вершин (0, 1, 0)
+};
+
+// Построчный разбор через std::istringstream на одном потоке - эталон для сравнения.
+bool ParseObjSerial(const std::filesystem::path& path, ObjParseResult& out);
+
+// Файл отображается в память и режется на куски по границам строк; куски разбираются
+// параллельно, дубликаты вершин сливаются по хэш-частям. Результат совпадает с ParseObjSerial
+// байт в байт для любого числа потоков. threads = 0 - по числу ядер.
+bool ParseObj(const std::filesystem::path& path, ObjParseResult& out, unsigned threads = 0);
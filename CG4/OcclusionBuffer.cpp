@@ -0,0 +1,374 @@
+#include "OcclusionBuffer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CG_OCCLUSION_SSE2 1
+#endif
+
+namespace
+{
+    // бокс закрыт, только если он дальше окклюдера с запасом: грани самого окклюдера
+    // и стены, снятые строго в лоб, не должны закрывать сами себя из-за округления
+    constexpr float kDepthBias = 1.001f;
+
+    struct ScreenVertex
+    {
+        float x, y;     // пиксели, y вниз
+        float invW;
+    };
+
+    void Transform(const float m[16], const Float3& p, float out[4])
+    {
+        for(int j = 0; j < 4; ++j)
+            out[j] = p.x * m[j] + p.y * m[4 + j] + p.z * m[8 + j] + m[12 + j];
+    }
+
+    // depthOffset отодвигает глубину вершины, не сдвигая её на экране. 1/(w + e) вогнута по 1/w,
+    // поэтому линейная интерполяция внутри треугольника даёт глубину не ближе отодвинутой
+    ScreenVertex ToScreen(const float c[4], int width, int height, float depthOffset = 0.0f)
+    {
+        const float invW = 1.0f / c[3];
+        return { (c[0] * invW * 0.5f + 0.5f) * width, (0.5f - c[1] * invW * 0.5f) * height,
+            depthOffset > 0.0f ? 1.0f / (c[3] + depthOffset) : invW };
+    }
+
+    // Треугольник в буфер 1/w: ближе - больше. Покрытие по центрам пикселей, как в CG3,
+    // только рёберные функции и глубина считаются плоскостями сразу для 4 пикселей строки
+    bool RasterizeTriangle(float* depth, int width, int height, const ScreenVertex v[3])
+    {
+        // лицевые - по часовой на экране (y вниз), как FrontCounterClockwise = FALSE у рендерера:
+        // стена, видимая с изнанки, на GPU отсекается и ничего не закрывает
+        const float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[1].y - v[0].y) * (v[2].x - v[0].x);
+        if(!(area > 1e-8f))
+            return false;
+
+        // E_k(p) - удвоенная площадь треугольника напротив вершины k, E_k(v_k) = area
+        float a[3], b[3], c[3];
+        for(int k = 0; k < 3; ++k)
+        {
+            const ScreenVertex& p = v[(k + 1) % 3];
+            const ScreenVertex& q = v[(k + 2) % 3];
+            a[k] = p.y - q.y;
+            b[k] = q.x - p.x;
+            c[k] = -(a[k] * p.x + b[k] * p.y);
+        }
+        // 1/w линейна на экране: сумма барицентрических весов
+        const float inv = 1.0f / area;
+        const float za = (a[0] * v[0].invW + a[1] * v[1].invW + a[2] * v[2].invW) * inv;
+        const float zb = (b[0] * v[0].invW + b[1] * v[1].invW + b[2] * v[2].invW) * inv;
+        const float zc = (c[0] * v[0].invW + c[1] * v[1].invW + c[2] * v[2].invW) * inv;
+
+        const float minX = std::min(v[0].x, std::min(v[1].x, v[2].x));
+        const float maxX = std::max(v[0].x, std::max(v[1].x, v[2].x));
+        const float minY = std::min(v[0].y, std::min(v[1].y, v[2].y));
+        const float maxY = std::max(v[0].y, std::max(v[1].y, v[2].y));
+        if(maxX < 0.0f || maxY < 0.0f || minX >= (float)width || minY >= (float)height)
+            return false;
+        // строка идёт четвёрками от кратного 4: лишние пиксели отсекают сами рёбра
+        const int x0 = std::max(0, (int)minX) & ~3;
+        const int x1 = std::min(width - 1, (int)maxX);
+        const int y0 = std::max(0, (int)minY);
+        const int y1 = std::min(height - 1, (int)maxY);
+
+        // отрезок строки внутри всех трёх рёбер: у большого или вытянутого треугольника
+        // бокс почти пуст. Граница ребра - линейная функция y; края расширены на пиксель,
+        // точное покрытие решают сами рёбра
+        float edgeK[3], edgeM[3];
+        for(int k = 0; k < 3; ++k)
+        {
+            edgeK[k] = a[k] != 0.0f ? -b[k] / a[k] : 0.0f;
+            edgeM[k] = a[k] != 0.0f ? -c[k] / a[k] : 0.0f;
+        }
+        auto span = [&](float py, int& from, int& to)
+        {
+            float lo = (float)x0, hi = (float)x1 + 1.0f;
+            for(int k = 0; k < 3; ++k)
+            {
+                const float edge = edgeK[k] * py + edgeM[k];
+                if(a[k] > 0.0f)
+                    lo = std::max(lo, edge - 1.0f);
+                else if(a[k] < 0.0f)
+                    hi = std::min(hi, edge + 1.0f);
+                else if(b[k] * py + c[k] < 0.0f)
+                    hi = lo - 1.0f;
+            }
+            // у почти горизонтального ребра граница уходит в бесконечность
+            from = (int)std::min(lo, (float)x1 + 1.0f) & ~3;
+            to = std::min(x1, (int)std::max(hi, (float)x0 - 1.0f));
+        };
+
+#ifdef CG_OCCLUSION_SSE2
+        // значения рёбер и глубины в четырёх центрах пикселей, шаг по строке - +4a
+        const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 step0 = _mm_set1_ps(4.0f * a[0]), step1 = _mm_set1_ps(4.0f * a[1]);
+        const __m128 step2 = _mm_set1_ps(4.0f * a[2]), stepZ = _mm_set1_ps(4.0f * za);
+        for(int y = y0; y <= y1; ++y)
+        {
+            const float py = (float)y + 0.5f;
+            int from, to;
+            span(py, from, to);
+            if(from > to)
+                continue;
+            const __m128 px = _mm_add_ps(_mm_set1_ps((float)from), offsets);
+            __m128 e0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[0]), px), _mm_set1_ps(b[0] * py + c[0]));
+            __m128 e1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[1]), px), _mm_set1_ps(b[1] * py + c[1]));
+            __m128 e2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[2]), px), _mm_set1_ps(b[2] * py + c[2]));
+            __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(za), px), _mm_set1_ps(zb * py + zc));
+            float* row = depth + (size_t)y * width;
+            for(int x = from; x <= to; x += 4)
+            {
+                // без ветвления по пустой маске: на коротких отрезках она чаще мешает
+                __m128 mask = _mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero));
+                mask = _mm_and_ps(mask, _mm_cmpge_ps(e2, zero));
+                const __m128 old = _mm_loadu_ps(row + x);
+                const __m128 nearest = _mm_max_ps(old, z);
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(mask, nearest), _mm_andnot_ps(mask, old)));
+                e0 = _mm_add_ps(e0, step0);
+                e1 = _mm_add_ps(e1, step1);
+                e2 = _mm_add_ps(e2, step2);
+                z = _mm_add_ps(z, stepZ);
+            }
+        }
+#else
+        for(int y = y0; y <= y1; ++y)
+        {
+            const float py = (float)y + 0.5f;
+            const float r0 = b[0] * py + c[0], r1 = b[1] * py + c[1], r2 = b[2] * py + c[2];
+            const float rz = zb * py + zc;
+            float* row = depth + (size_t)y * width;
+            int from, to;
+            span(py, from, to);
+            for(int x = from; x <= to; ++x)
+            {
+                const float px = (float)x + 0.5f;
+                if(a[0] * px + r0 < 0.0f || a[1] * px + r1 < 0.0f || a[2] * px + r2 < 0.0f)
+                    continue;
+                row[x] = std::max(row[x], za * px + rz);
+            }
+        }
+#endif
+        return true;
+    }
+
+    // обрезка по ближней плоскости D3D (z клипа >= 0): из треугольника выходит до 4 вершин
+    int ClipNear(const float* in[3], float out[4][4])
+    {
+        int n = 0;
+        for(int i = 0; i < 3; ++i)
+        {
+            const float* p = in[i];
+            const float* q = in[(i + 1) % 3];
+            if(p[2] >= 0.0f)
+                std::copy(p, p + 4, out[n++]);
+            if((p[2] >= 0.0f) != (q[2] >= 0.0f))
+            {
+                const float t = p[2] / (p[2] - q[2]);
+                for(int j = 0; j < 4; ++j)
+                    out[n][j] = p[j] + (q[j] - p[j]) * t;
+                ++n;
+            }
+        }
+        return n;
+    }
+
+    float TriangleArea2(const Float3& a, const Float3& b, const Float3& c)
+    {
+        const Float3 u(b.x - a.x, b.y - a.y, b.z - a.z), v(c.x - a.x, c.y - a.y, c.z - a.z);
+        const Float3 n(u.y * v.z - u.z * v.y, u.z * v.x - u.x * v.z, u.x * v.y - u.y * v.x);
+        return n.x * n.x + n.y * n.y + n.z * n.z;
+    }
+}
+
+OccluderMesh SelectOccluders(const MeshVertex* vertices, size_t vertexCount,
+    const uint32_t* indices, size_t indexCount, size_t maxTriangles)
+{
+    const size_t triCount = indexCount / 3;
+    std::vector<float> area(triCount);
+    std::vector<uint32_t> order;
+    order.reserve(triCount);
+    for(size_t t = 0; t < triCount; ++t)
+    {
+        area[t] = TriangleArea2(vertices[indices[t * 3]].pos, vertices[indices[t * 3 + 1]].pos,
+            vertices[indices[t * 3 + 2]].pos);
+        if(area[t] > 0.0f)
+            order.push_back((uint32_t)t);
+    }
+
+    // крупнейшие, при равной площади - раньше в файле; потом в исходном порядке треугольников
+    const size_t take = std::min(maxTriangles, order.size());
+    std::partial_sort(order.begin(), order.begin() + take, order.end(), [&](uint32_t x, uint32_t y)
+    {
+        return area[x] != area[y] ? area[x] > area[y] : x < y;
+    });
+    order.resize(take);
+    std::sort(order.begin(), order.end());
+
+    OccluderMesh mesh;
+    std::vector<uint32_t> remap(vertexCount, ~0u);
+    mesh.indices.reserve(take * 3);
+    for(uint32_t t : order)
+    {
+        for(int k = 0; k < 3; ++k)
+        {
+            const uint32_t v = indices[t * 3 + k];
+            if(remap[v] == ~0u)
+            {
+                remap[v] = (uint32_t)mesh.positions.size();
+                mesh.positions.push_back(vertices[v].pos);
+            }
+            mesh.indices.push_back(remap[v]);
+        }
+    }
+    return mesh;
+}
+
+OcclusionBuffer::OcclusionBuffer(int width, int height)
+    : mWidth((std::max(width, 4) + 3) & ~3)
+    , mHeight(std::max(height, 1))
+{
+    int w = mWidth, h = mHeight;
+    for(;;)
+    {
+        Level level;
+        level.width = w;
+        level.height = h;
+        level.data.assign((size_t)w * h, 0.0f);
+        mLevels.push_back(std::move(level));
+        if(w == 1 && h == 1)
+            break;
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+    }
+}
+
+void OcclusionBuffer::Begin(const float viewProj[16])
+{
+    std::copy(viewProj, viewProj + 16, mViewProj);
+    std::fill(mLevels[0].data.begin(), mLevels[0].data.end(), 0.0f);
+}
+
+size_t OcclusionBuffer::Rasterize(const OccluderMesh& mesh)
+{
+    mClip.resize(mesh.positions.size() * 4);
+    for(size_t i = 0; i < mesh.positions.size(); ++i)
+        Transform(mViewProj, mesh.positions[i], &mClip[i * 4]);
+
+    float* depth = mLevels[0].data.data();
+    size_t drawn = 0;
+    for(size_t t = 0; t + 2 < mesh.indices.size(); t += 3)
+    {
+        const float* in[3] = { &mClip[mesh.indices[t] * 4], &mClip[mesh.indices[t + 1] * 4],
+            &mClip[mesh.indices[t + 2] * 4] };
+        // треугольник целиком за одной плоскостью пирамиды не рисуем
+        bool outside = false;
+        for(int j = 0; j < 2 && !outside; ++j)
+        {
+            outside = (in[0][j] > in[0][3] && in[1][j] > in[1][3] && in[2][j] > in[2][3]) ||
+                (in[0][j] < -in[0][3] && in[1][j] < -in[1][3] && in[2][j] < -in[2][3]);
+        }
+        if(outside || (in[0][2] < 0.0f && in[1][2] < 0.0f && in[2][2] < 0.0f))
+            continue;
+
+        ScreenVertex s[4];
+        if(in[0][2] >= 0.0f && in[1][2] >= 0.0f && in[2][2] >= 0.0f)
+        {
+            for(int k = 0; k < 3; ++k)
+                s[k] = ToScreen(in[k], mWidth, mHeight, mesh.error);
+            drawn += RasterizeTriangle(depth, mWidth, mHeight, s);
+        }
+        else
+        {
+            float clipped[4][4];
+            const int n = ClipNear(in, clipped);
+            for(int k = 0; k < n; ++k)
+                s[k] = ToScreen(clipped[k], mWidth, mHeight, mesh.error);
+            bool any = RasterizeTriangle(depth, mWidth, mHeight, s);
+            if(n == 4)
+            {
+                const ScreenVertex second[3] = { s[0], s[2], s[3] };
+                any |= RasterizeTriangle(depth, mWidth, mHeight, second);
+            }
+            drawn += any;
+        }
+    }
+    return drawn;
+}
+
+void OcclusionBuffer::Finish()
+{
+    for(size_t l = 1; l < mLevels.size(); ++l)
+    {
+        const Level& src = mLevels[l - 1];
+        Level& dst = mLevels[l];
+        for(int y = 0; y < dst.height; ++y)
+        {
+            const float* r0 = &src.data[(size_t)(2 * y) * src.width];
+            const float* r1 = &src.data[(size_t)std::min(2 * y + 1, src.height - 1) * src.width];
+            for(int x = 0; x < dst.width; ++x)
+            {
+                const int x0 = 2 * x, x1 = std::min(2 * x + 1, src.width - 1);
+                dst.data[(size_t)y * dst.width + x] = std::min(std::min(r0[x0], r0[x1]), std::min(r1[x0], r1[x1]));
+            }
+        }
+    }
+}
+
+bool OcclusionBuffer::IsVisible(const Float3& boxMin, const Float3& boxMax) const
+{
+    float minX = FLT_MAX, maxX = -FLT_MAX, minY = FLT_MAX, maxY = -FLT_MAX;
+    float nearest = 0.0f;
+    for(int i = 0; i < 8; ++i)
+    {
+        const Float3 p(i & 1 ? boxMax.x : boxMin.x, i & 2 ? boxMax.y : boxMin.y, i & 4 ? boxMax.z : boxMin.z);
+        float c[4];
+        Transform(mViewProj, p, c);
+        if(c[2] < 0.0f)
+            return true;
+        const ScreenVertex s = ToScreen(c, mWidth, mHeight);
+        minX = std::min(minX, s.x);
+        maxX = std::max(maxX, s.x);
+        minY = std::min(minY, s.y);
+        maxY = std::max(maxY, s.y);
+        nearest = std::max(nearest, s.invW);
+    }
+    // вне экрана - забота отсечения пирамидой
+    if(maxX < 0.0f || maxY < 0.0f || minX >= (float)mWidth || minY >= (float)mHeight)
+        return true;
+
+    // все пиксели, которых касается проекция бокса; уровень - где она не шире 4 текселей
+    const int x0 = std::max(0, (int)minX), x1 = std::min(mWidth - 1, (int)maxX);
+    const int y0 = std::max(0, (int)minY), y1 = std::min(mHeight - 1, (int)maxY);
+    size_t l = 0;
+    while(l + 1 < mLevels.size() && ((x1 >> l) - (x0 >> l) >= 4 || (y1 >> l) - (y0 >> l) >= 4))
+        ++l;
+
+    const Level& level = mLevels[l];
+    const float boxDepth = nearest * kDepthBias;
+    for(int y = y0 >> l; y <= (y1 >> l); ++y)
+        for(int x = x0 >> l; x <= (x1 >> l); ++x)
+            if(boxDepth >= level.data[(size_t)y * level.width + x])
+                return true;
+    return false;
+}
+
+size_t RemoveOccludedMeshlets(const MeshletMesh& mesh, const OcclusionBuffer& buffer,
+    std::vector<uint32_t>& visible)
+{
+    size_t culled = 0;
+    size_t n = 0;
+    for(uint32_t i : visible)
+    {
+        const Meshlet& m = mesh.meshlets[i];
+        if(buffer.IsVisible(m.boxMin, m.boxMax))
+            visible[n++] = i;
+        else
+            culled += m.triangleCount;
+    }
+    visible.resize(n);
+    return culled;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "MeshTypes.h"
+#include "Meshlets.h"
+
+// Программное отсечение перекрытых: несколько крупных окклюдеров рисуются на CPU только
+// глубиной в маленький буфер (как z-буфер CG3, но 4 пикселя за раз на SSE2), по нему строится
+// пирамида дальней глубины, и боксы объектов проверяются по ней консервативно. Без DirectX.
+
+// окклюдеры в мировых координатах, по 3 индекса на треугольник
+struct OccluderMesh
+{
+    std::vector<Float3> positions;
+    std::vector<uint32_t> indices;
+    // упрощённый окклюдер выступает из исходной поверхности не дальше error:
+    // при растеризации его глубина отодвигается на error от камеры
+    float error = 0.0f;
+};
+
+// Самые крупные по площади треугольники, не больше maxTriangles: стены и полы закрывают
+// больше всего при малом числе треугольников. Прозрачные материалы вызывающий не передаёт.
+OccluderMesh SelectOccluders(const MeshVertex* vertices, size_t vertexCount,
+    const uint32_t* indices, size_t indexCount, size_t maxTriangles = 2048);
+
+class OcclusionBuffer
+{
+public:
+    // width округляется вверх до кратного 4
+    explicit OcclusionBuffer(int width = 256, int height = 128);
+
+    // очистка и камера кадра; viewProj - построчная матрица D3D, как у FrustumFromViewProj
+    void Begin(const float viewProj[16]);
+    // лицевые треугольники, обрезанные ближней плоскостью; возвращает число нарисованных
+    size_t Rasterize(const OccluderMesh& mesh);
+    // пирамида: каждый уровень - минимум 1/w (самый дальний окклюдер) по 2x2 предыдущего
+    void Finish();
+
+    // false - бокс целиком дальше окклюдеров во всех пикселях, которые он может задеть.
+    // Бокс, пересекающий ближнюю плоскость, всегда видим
+    bool IsVisible(const Float3& boxMin, const Float3& boxMax) const;
+
+    int Width() const { return mWidth; }
+    int Height() const { return mHeight; }
+    // 1/w ближайшего окклюдера в пикселе, 0 - пусто
+    float InvDepth(int x, int y) const { return mLevels[0].data[(size_t)y * mWidth + x]; }
+
+private:
+    struct Level
+    {
+        int width = 0;
+        int height = 0;
+        std::vector<float> data;
+    };
+
+    int mWidth = 0;
+    int mHeight = 0;
+    float mViewProj[16] = {};
+    std::vector<Level> mLevels;         // 0 - сам буфер глубины
+    std::vector<float> mClip;           // вершины окклюдеров в пространстве клипа, xyzw
+};
+
+// убирает из visible мешлеты, закрытые окклюдерами; возвращает число их треугольников
+size_t RemoveOccludedMeshlets(const MeshletMesh& mesh, const OcclusionBuffer& buffer,
+    std::vector<uint32_t>& visible);
@@ -8,14 +8,34 @@ cbuffer SceneCB : register(b0)
     float  _pad1;
     float3 gLightColor;
     float  _pad2;
+    float3 gPosMin;     // распаковка позиции: min + q * extent
+    float  _pad3;
+    float3 gPosExtent;
+    float  _pad4;
 };
 
+// материал батча (корневые константы)
+cbuffer MaterialCB : register(b1)
+{
+    float4 gBaseColor;  // Kd, a - прозрачность
+    float4 gSpecular;   // Ks, w - степень блика
+};
+
+// PackedVertex: позиция R16G16B16A16_UNORM, нормаль - октаэдр в R16G16_SNORM
 struct VSIn
 {
-    float3 Pos    : POSITION;
-    float3 Normal : NORMAL;
+    float4 Pos    : POSITION;
+    float2 Normal : NORMAL;
 };
 
+float3 DecodeOctahedral(float2 e)
+{
+    float3 n = float3(e, 1.0f - abs(e.x) - abs(e.y));
+    float t = saturate(-n.z);
+    n.xy += n.xy >= 0.0f ? -t : t;
+    return normalize(n);
+}
+
 struct VSOut
 {
     float4 PosH   : SV_POSITION;
@@ -27,11 +47,12 @@ VSOut VSMain(VSIn v)
 {
     VSOut o;
 
-    float4 posW = mul(float4(v.Pos, 1.0f), gWorld);
+    float3 pos = gPosMin + v.Pos.xyz * gPosExtent;
+    float4 posW = mul(float4(pos, 1.0f), gWorld);
     o.PosW = posW.xyz;
 
     // нормаль
-    o.NrmW = mul(v.Normal, (float3x3)gWorld);
+    o.NrmW = mul(DecodeOctahedral(v.Normal), (float3x3)gWorld);
 
     o.PosH = mul(posW, gViewProj);
     return o;
@@ -50,12 +71,10 @@ float4 PSMain(VSOut i) : SV_Target
     float3 diffuse = ndotl * gLightColor;
 
     // Phong/Blinn-Phong (здесь Blinn для стабильности).
-    float specPow = 64.0f;
-    float spec = pow(saturate(dot(N, H)), specPow);
+    float spec = pow(saturate(dot(N, H)), gSpecular.w);
     float3 specular = spec * gLightColor;
 
-    float3 base = float3(0.85f, 0.75f, 0.55f); // 
-    float3 color = base * (ambient + diffuse) + specular * 0.35f;
+    float3 color = gBaseColor.rgb * (ambient + diffuse) + specular * gSpecular.rgb;
 
-    return float4(color, 1.0f);
+    return float4(color, gBaseColor.a);
 }
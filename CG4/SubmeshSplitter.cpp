@@ -0,0 +1,115 @@
+#include "SubmeshSplitter.h"
+
+#include <algorithm>
+
+SplitMesh16Result SplitMesh16(std::vector<MeshVertex>& vertices, const uint32_t* indices, size_t indexCount,
+    uint32_t maxVertices, uint32_t minTriangles)
+{
+    SplitMesh16Result r;
+    maxVertices = std::clamp<uint32_t>(maxVertices, 3, 65535);
+    const size_t triCount = indexCount / 3;
+    const size_t originalCount = vertices.size();
+    r.indices.resize(triCount * 3);
+
+    // номер вершины в копирующем подмеше; stamp - какой подмеш его записал
+    std::vector<uint32_t> local;
+    std::vector<uint32_t> stamp;
+
+    // окно: треугольники с t берутся, пока размах номеров влезает в maxVertices (не больше limit)
+    uint32_t lo = 0, hi = 0;
+    auto window = [&](size_t t, size_t limit)
+    {
+        lo = UINT32_MAX;
+        hi = 0;
+        size_t end = t;
+        while(end < triCount && end - t < limit)
+        {
+            uint32_t nlo = lo, nhi = hi;
+            for(int c = 0; c < 3; ++c)
+            {
+                nlo = std::min(nlo, indices[end * 3 + c]);
+                nhi = std::max(nhi, indices[end * 3 + c]);
+            }
+            if(nhi - nlo >= maxVertices)
+                break;
+            lo = nlo;
+            hi = nhi;
+            ++end;
+        }
+        return end;
+    };
+
+    size_t t = 0;
+    while(t < triCount)
+    {
+        size_t end = window(t, SIZE_MAX);
+
+        Submesh16 s;
+        s.firstIndex = (uint32_t)(t * 3);
+        if(end == triCount || end - t >= minTriangles)
+        {
+            s.baseVertex = (int32_t)lo;
+            s.vertexCount = hi - lo + 1;
+            for(size_t i = t * 3; i < end * 3; ++i)
+                r.indices[i] = (uint16_t)(indices[i] - lo);
+        }
+        else
+        {
+            // копии: треугольники берутся, пока разных вершин не больше maxVertices
+            if(local.empty())
+            {
+                local.assign(originalCount, 0);
+                stamp.assign(originalCount, UINT32_MAX);
+            }
+            const uint32_t id = (uint32_t)r.submeshes.size();
+            const size_t base = vertices.size();
+            s.baseVertex = (int32_t)base;
+            end = t;
+            while(end < triCount)
+            {
+                uint32_t fresh = 0;
+                for(int c = 0; c < 3; ++c)
+                {
+                    uint32_t v = indices[end * 3 + c];
+                    bool repeat = (c > 0 && v == indices[end * 3]) || (c == 2 && v == indices[end * 3 + 1]);
+                    fresh += stamp[v] != id && !repeat;
+                }
+                if(s.vertexCount + fresh > maxVertices)
+                    break;
+                // копии нужны только на разбросанном участке: как только отсюда снова
+                // набирается нормальное окно, подмеш закрывается
+                if(end > t && (end - t) % 64 == 0)
+                {
+                    size_t probe = window(end, minTriangles);
+                    if(probe == triCount || probe - end >= minTriangles)
+                        break;
+                }
+                for(int c = 0; c < 3; ++c)
+                {
+                    uint32_t v = indices[end * 3 + c];
+                    if(stamp[v] != id)
+                    {
+                        stamp[v] = id;
+                        local[v] = s.vertexCount++;
+                        MeshVertex copy = vertices[v];
+                        vertices.push_back(copy);
+                    }
+                    r.indices[end * 3 + c] = (uint16_t)local[v];
+                }
+                ++end;
+            }
+            r.duplicatedVertices += vertices.size() - base;
+        }
+        s.indexCount = (uint32_t)((end - t) * 3);
+        r.submeshes.push_back(s);
+        t = end;
+    }
+    return r;
+}
+
+size_t FindSubmesh16(const std::vector<Submesh16>& submeshes, uint32_t index)
+{
+    auto it = std::upper_bound(submeshes.begin(), submeshes.end(), index,
+        [](uint32_t i, const Submesh16& s) { return i < s.firstIndex; });
+    return it == submeshes.begin() ? 0 : (size_t)(it - submeshes.begin()) - 1;
+}
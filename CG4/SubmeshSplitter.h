@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "MeshTypes.h"
+
+// 16-битные индексы для любого меша: буфер режется на подмеши, в каждом не больше
+// maxVertices разных вершин, индекс подмеша отсчитывается от baseVertex
+// (BaseVertexLocation в DrawIndexedInstanced). Без DirectX.
+
+struct Submesh16
+{
+    uint32_t firstIndex = 0;    // совпадает с позицией во входном 32-битном буфере
+    uint32_t indexCount = 0;
+    int32_t baseVertex = 0;
+    uint32_t vertexCount = 0;   // локальные индексы в [0, vertexCount)
+};
+
+struct SplitMesh16Result
+{
+    std::vector<uint16_t> indices;      // той же длины и в том же порядке, что и вход
+    std::vector<Submesh16> submeshes;   // по возрастанию firstIndex, без пропусков
+    size_t duplicatedVertices = 0;      // дописано в конец массива вершин
+};
+
+// Подмеш - окно [min, max] номеров вершин подряд идущих треугольников, вершины не копируются.
+// Если окно набирает меньше minTriangles (индексы слишком разбросаны), подмеш собирается
+// из копий своих вершин в конце vertices. Порядок треугольников не меняется, поэтому
+// диапазоны LOD и мешлетов остаются верными - их нужно только резать по границам подмешей.
+// maxVertices <= 65535: индекс 0xFFFF не используется.
+SplitMesh16Result SplitMesh16(std::vector<MeshVertex>& vertices, const uint32_t* indices, size_t indexCount,
+    uint32_t maxVertices = 65535, uint32_t minTriangles = 1024);
+
+// номер подмеша, которому принадлежит индекс index
+size_t FindSubmesh16(const std::vector<Submesh16>& submeshes, uint32_t index);
@@ -1,18 +1,46 @@
 #include "Timer.h"
 
-Timer::Timer()
+#if defined(_WIN32) && !defined(CG_TIMER_STEADY_CLOCK)
+#include "Common.h"
+
+int64_t Timer::Now()
+{
+    int64_t t = 0;
+    QueryPerformanceCounter(reinterpret_cast<LARGE_INTEGER*>(&t));
+    return t;
+}
+
+int64_t Timer::CountsPerSecond()
 {
     int64_t countsPerSec = 0;
     QueryPerformanceFrequency(reinterpret_cast<LARGE_INTEGER*>(&countsPerSec));
-    mSecondsPerCount = 1.0 / static_cast<double>(countsPerSec);
+    return countsPerSec;
+}
+#else
+#include <chrono>
+
+int64_t Timer::Now()
+{
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+int64_t Timer::CountsPerSecond()
+{
+    return 1000000000;
+}
+#endif
+
+Timer::Timer()
+{
+    mSecondsPerCount = 1.0 / static_cast<double>(CountsPerSecond());
 
     Reset();
 }
 
 void Timer::Reset()
 {
-    int64_t t = 0;
-    QueryPerformanceCounter(reinterpret_cast<LARGE_INTEGER*>(&t));
+    int64_t t = Now();
 
     mBaseTime = t;
     mPrevTime = t;
@@ -25,8 +53,7 @@ void Timer::Start()
 {
     if(!mStopped) return;
 
-    int64_t startTime = 0;
-    QueryPerformanceCounter(reinterpret_cast<LARGE_INTEGER*>(&startTime));
+    int64_t startTime = Now();
 
     // время паузы
     mPausedTime += (startTime - mStopTime);
@@ -40,8 +67,7 @@ void Timer::Stop()
 {
     if(mStopped) return;
 
-    int64_t t = 0;
-    QueryPerformanceCounter(reinterpret_cast<LARGE_INTEGER*>(&t));
+    int64_t t = Now();
 
     mStopTime = t;
     mStopped = true;
@@ -55,8 +81,7 @@ void Timer::Tick()
         return;
     }
 
-    int64_t t = 0;
-    QueryPerformanceCounter(reinterpret_cast<LARGE_INTEGER*>(&t));
+    int64_t t = Now();
     mCurrTime = t;
 
     mDeltaSeconds = (mCurrTime - mPrevTime) * mSecondsPerCount;
@@ -1,6 +1,8 @@
 #pragma once
-#include "Common.h"
+#include <cstdint>
 
+// Источник времени: QueryPerformanceCounter на Windows, иначе (или с CG_TIMER_STEADY_CLOCK)
+// std::chrono::steady_clock. Оба монотонные, интерфейс одинаковый.
 class Timer
 {
 public:
@@ -15,6 +17,9 @@ public:
     double DeltaSeconds() const;   // время между кадрами
 
 private:
+    static int64_t Now();          // отсчёты источника
+    static int64_t CountsPerSecond();
+
     double mSecondsPerCount = 0.0;
     double mDeltaSeconds = 0.0;
 
@@ -0,0 +1,133 @@
+#include "VertexPacking.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    uint16_t ToUnorm16(float v)
+    {
+        v = std::clamp(v, 0.0f, 1.0f);
+        return (uint16_t)std::lround(v * 65535.0f);
+    }
+
+    float FromSnorm16(int16_t v)
+    {
+        return std::max((float)v / 32767.0f, -1.0f);
+    }
+
+    float Dot(const Float3& a, const Float3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+}
+
+QuantizeBounds MakeQuantizeBounds(const Float3& min, const Float3& max)
+{
+    QuantizeBounds b;
+    b.min = min;
+    // нулевой размах (плоский меш) даёт деление на ноль при кодировании
+    b.extent = Float3(std::max(max.x - min.x, 1e-20f), std::max(max.y - min.y, 1e-20f), std::max(max.z - min.z, 1e-20f));
+    return b;
+}
+
+void EncodeOctahedral(const Float3& n, int16_t out[2])
+{
+    float l1 = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+    if(l1 <= 0.0f)
+    {
+        out[0] = 0;
+        out[1] = 0;
+        return;
+    }
+    float u = n.x / l1;
+    float v = n.y / l1;
+    if(n.z < 0.0f)
+    {
+        float pu = u;
+        u = (1.0f - std::fabs(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+        v = (1.0f - std::fabs(pu)) * (v >= 0.0f ? 1.0f : -1.0f);
+    }
+
+    float len = std::sqrt(Dot(n, n));
+    Float3 dir(n.x / len, n.y / len, n.z / len);
+
+    const float fu = std::floor(u * 32767.0f);
+    const float fv = std::floor(v * 32767.0f);
+    float best = -2.0f;
+    for(int i = 0; i < 4; ++i)
+    {
+        int16_t c[2] = {
+            (int16_t)std::clamp(fu + (float)(i & 1), -32767.0f, 32767.0f),
+            (int16_t)std::clamp(fv + (float)(i >> 1), -32767.0f, 32767.0f) };
+        float d = Dot(DecodeOctahedral(c), dir);
+        if(d > best)
+        {
+            best = d;
+            out[0] = c[0];
+            out[1] = c[1];
+        }
+    }
+}
+
+Float3 DecodeOctahedral(const int16_t in[2])
+{
+    Float3 n(FromSnorm16(in[0]), FromSnorm16(in[1]), 0.0f);
+    n.z = 1.0f - std::fabs(n.x) - std::fabs(n.y);
+    float t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    float len = std::sqrt(Dot(n, n));
+    return Float3(n.x / len, n.y / len, n.z / len);
+}
+
+PackedVertex PackVertex(const MeshVertex& v, const QuantizeBounds& b)
+{
+    PackedVertex p;
+    p.pos[0] = ToUnorm16((v.pos.x - b.min.x) / b.extent.x);
+    p.pos[1] = ToUnorm16((v.pos.y - b.min.y) / b.extent.y);
+    p.pos[2] = ToUnorm16((v.pos.z - b.min.z) / b.extent.z);
+    p.pos[3] = 0;
+    EncodeOctahedral(v.normal, p.normal);
+    return p;
+}
+
+MeshVertex UnpackVertex(const PackedVertex& v, const QuantizeBounds& b)
+{
+    MeshVertex m;
+    m.pos = Float3(b.min.x + v.pos[0] / 65535.0f * b.extent.x,
+        b.min.y + v.pos[1] / 65535.0f * b.extent.y,
+        b.min.z + v.pos[2] / 65535.0f * b.extent.z);
+    m.normal = DecodeOctahedral(v.normal);
+    return m;
+}
+
+std::vector<PackedVertex> PackVertices(const MeshVertex* vertices, size_t count, const QuantizeBounds& b)
+{
+    std::vector<PackedVertex> out(count);
+    for(size_t i = 0; i < count; ++i)
+        out[i] = PackVertex(vertices[i], b);
+    return out;
+}
+
+QuantizeError MeasureQuantizeError(const MeshVertex* vertices, const PackedVertex* packed, size_t count,
+    const QuantizeBounds& b)
+{
+    QuantizeError e;
+    double maxAngle = 0.0;
+    for(size_t i = 0; i < count; ++i)
+    {
+        MeshVertex u = UnpackVertex(packed[i], b);
+        Float3 d(u.pos.x - vertices[i].pos.x, u.pos.y - vertices[i].pos.y, u.pos.z - vertices[i].pos.z);
+        e.maxPosition = std::max(e.maxPosition, std::sqrt(Dot(d, d)));
+
+        // угол через atan2 |a x b| / a.b: у acos нет точности возле нуля
+        const Float3& n = vertices[i].normal;
+        const Float3& m = u.normal;
+        double cx = (double)n.y * m.z - (double)n.z * m.y;
+        double cy = (double)n.z * m.x - (double)n.x * m.z;
+        double cz = (double)n.x * m.y - (double)n.y * m.x;
+        double dot = (double)n.x * m.x + (double)n.y * m.y + (double)n.z * m.z;
+        if(Dot(n, n) > 0.0f)
+            maxAngle = std::max(maxAngle, std::atan2(std::sqrt(cx * cx + cy * cy + cz * cz), dot));
+    }
+    e.maxNormalDegrees = (float)(maxAngle * 57.29577951308232);
+    return e;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "MeshTypes.h"
+
+// Сжатая вершина для GPU: позиция - 16-битные доли ограничивающего бокса (R16G16B16A16_UNORM),
+// нормаль - октаэдрическая развёртка в 2x16 бит (R16G16_SNORM). 12 байт вместо 24.
+// Кодирование и декодирование на CPU, без DirectX; тот же декодер есть в Phong.hlsl.
+
+struct PackedVertex
+{
+    uint16_t pos[4];        // w не используется
+    int16_t normal[2];
+};
+static_assert(sizeof(PackedVertex) == 12, "PackedVertex layout");
+
+// позиция = min + q * extent, q в [0, 1]
+struct QuantizeBounds
+{
+    Float3 min;
+    Float3 extent;
+};
+
+QuantizeBounds MakeQuantizeBounds(const Float3& min, const Float3& max);
+
+// Октаэдр: из 4 вариантов округления берётся дающий наименьший угол после декодирования
+void EncodeOctahedral(const Float3& n, int16_t out[2]);
+Float3 DecodeOctahedral(const int16_t in[2]);
+
+PackedVertex PackVertex(const MeshVertex& v, const QuantizeBounds& b);
+MeshVertex UnpackVertex(const PackedVertex& v, const QuantizeBounds& b);
+
+std::vector<PackedVertex> PackVertices(const MeshVertex* vertices, size_t count, const QuantizeBounds& b);
+
+// наибольшие ошибки после упаковки: позиция - в единицах меша, нормаль - в градусах
+struct QuantizeError
+{
+    float maxPosition = 0.0f;
+    float maxNormalDegrees = 0.0f;
+};
+
+QuantizeError MeasureQuantizeError(const MeshVertex* vertices, const PackedVertex* packed, size_t count,
+    const QuantizeBounds& b);
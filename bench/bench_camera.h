@@ -0,0 +1,40 @@
+#pragma once
+#include <cmath>
+
+#include "MeshTypes.h"
+
+// Камера CG4 для замеров без DirectX: орбита вокруг начала координат, взгляд в центр,
+// матрицы D3D (вектор-строка, LH, z клипа в [0, 1]) как XMMatrixLookAtLH * XMMatrixPerspectiveFovLH.
+namespace bench {
+
+struct Mat { float m[16]; };
+
+inline Mat mul(const Mat& a, const Mat& b) {
+    Mat r{};
+    for (int i=0; i<4; i++)
+        for (int j=0; j<4; j++)
+            for (int k=0; k<4; k++) r.m[i*4 + j] += a.m[i*4 + k] * b.m[k*4 + j];
+    return r;
+}
+
+inline Mat view_proj(const Float3& eye, float fovY, float aspect, float zn, float zf) {
+    auto norm = [](Float3 v) { float l = std::sqrt(v.x*v.x + v.y*v.y + v.z*v.z); return Float3(v.x/l, v.y/l, v.z/l); };
+    auto cross = [](Float3 a, Float3 b) { return Float3(a.y*b.z - a.z*b.y, a.z*b.x - a.x*b.z, a.x*b.y - a.y*b.x); };
+    auto dot = [](Float3 a, Float3 b) { return a.x*b.x + a.y*b.y + a.z*b.z; };
+    Float3 z = norm(Float3(-eye.x, -eye.y, -eye.z));
+    Float3 x = norm(cross(Float3(0, 1, 0), z));
+    Float3 y = cross(z, x);
+    Mat v = {{ x.x, y.x, z.x, 0,  x.y, y.y, z.y, 0,  x.z, y.z, z.z, 0,
+               -dot(x, eye), -dot(y, eye), -dot(z, eye), 1 }};
+    float h = 1.f / std::tan(fovY * 0.5f), w = h / aspect, q = zf / (zf - zn);
+    Mat p = {{ w, 0, 0, 0,  0, h, 0, 0,  0, 0, q, 1,  0, 0, -q*zn, 0 }};
+    return mul(v, p);
+}
+
+// положение глаза как в Dx12Renderer::Update: theta - азимут, phi - угол от оси y
+inline Float3 orbit_eye(float theta, float phi, float radius) {
+    return Float3(radius * std::sin(phi) * std::cos(theta), radius * std::cos(phi),
+                  radius * std::sin(phi) * std::sin(theta));
+}
+
+} // namespace bench
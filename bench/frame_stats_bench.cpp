@@ -0,0 +1,204 @@
+// Статистика времени кадра (framestats::Collector) и переносимый Timer CG4 без окна.
+//
+//   frame_stats_bench [--samples 10000000]
+//
+// Проверки:
+//   - перцентили: ближайший ранг, как у сортировки окна, на окнах разной длины;
+//   - кольцо: после нескольких оборотов samples() - последние window кадров по порядку,
+//     гистограмма совпадает с пересчётом по окну, крайние и NaN идут в первую и последнюю корзины;
+//   - Timer на steady_clock: Tick и TotalSeconds сходятся с часами, пауза Stop/Start не считается.
+// Затем цена add() (заявлено несколько наносекунд) и summary() на окне 1024.
+// Нарушение - код возврата 1 (ctest frame_stats_check).
+#include "Timer.h"
+#include "../shared/frame_stats.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+int g_failures = 0;
+
+void expect(bool ok, const char* what) {
+    std::printf("  %-60s %s\n", what, ok ? "ok" : "FAILED");
+    if (!ok) g_failures++;
+}
+
+// ближайший ранг по отсортированной копии
+double nearest_rank(std::vector<double> v, double p) {
+    std::sort(v.begin(), v.end());
+    const size_t r = (size_t)std::max(1.0, std::ceil(p * (double)v.size())) - 1;
+    return v[r];
+}
+
+void check_percentiles() {
+    std::printf("percentiles\n");
+    std::mt19937 rng(7);
+    std::lognormal_distribution<double> frame(std::log(16.0), 0.3);
+    bool ok = true, minmax = true, avg = true;
+    for (size_t n : { (size_t)1, (size_t)2, (size_t)3, (size_t)99, (size_t)100, (size_t)101, (size_t)1000, (size_t)1024 }) {
+        framestats::Collector c({ 1024, 0.5, 100 });
+        std::vector<double> ms;
+        for (size_t i=0; i<n; i++) {
+            // повторы значений - как у кадров, привязанных к vsync
+            const double v = i % 7 == 0 ? 16.0 : frame(rng);
+            ms.push_back(v);
+            c.add(v / 1000.0);
+        }
+        // add делит и умножает на 1000: сравнение с тем, что лежит в окне
+        const std::vector<double> win = c.samples();
+        const framestats::Summary s = c.summary();
+        ok = ok && s.p50Ms == nearest_rank(win, 0.50) && s.p95Ms == nearest_rank(win, 0.95) &&
+             s.p99Ms == nearest_rank(win, 0.99);
+        minmax = minmax && s.minMs == *std::min_element(win.begin(), win.end()) &&
+                 s.maxMs == *std::max_element(win.begin(), win.end());
+        double sum = 0;
+        for (double v : win) sum += v;
+        avg = avg && std::fabs(s.avgMs - sum / (double)n) <= 1e-9 * s.avgMs;
+    }
+    expect(ok, "p50/p95/p99 equal nearest rank of the sorted window");
+    expect(minmax, "min and max equal the window extremes");
+    expect(avg, "avg equals the window mean");
+
+    framestats::Collector one;
+    one.add(0.020);
+    const framestats::Summary s = one.summary();
+    expect(s.p50Ms == s.p99Ms && s.minMs == s.maxMs && std::fabs(s.p50Ms - 20.0) < 1e-9,
+           "a single frame is every percentile");
+    expect(framestats::Collector().summary().count == 0, "empty collector gives an empty summary");
+}
+
+void check_ring() {
+    std::printf("ring and histogram, window 100, 1037 frames\n");
+    const size_t window = 100;
+    framestats::Collector c({ window, 0.5, 40 });
+    std::vector<double> all;
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<double> frame(0.0, 25.0);     // и за последней корзиной (20 мс)
+    for (int i=0; i<1037; i++) {
+        double ms = frame(rng);
+        if (i == 500) ms = -1.0;
+        if (i == 1000) ms = std::numeric_limits<double>::quiet_NaN();
+        if (i == 1010) ms = 1e6;
+        all.push_back(ms);
+        c.add(ms / 1000.0);
+    }
+    const std::vector<double> win = c.samples();
+    bool order = win.size() == window;
+    for (size_t i=0; order && i<window; i++) {
+        const double want = all[all.size() - window + i];
+        order = std::isnan(want) ? std::isnan(win[i]) : std::fabs(win[i] - want) <= 1e-9 * std::max(1.0, std::fabs(want));
+    }
+    expect(order, "samples() are the last window frames, oldest first");
+    expect(c.count() == window && c.total() == all.size(), "count() is the window, total() every frame");
+
+    std::vector<uint32_t> recount(c.histogram().size(), 0);
+    for (double ms : win) {
+        const double b = ms / c.bin_ms();
+        recount[!(b > 0.0) ? 0 : std::min<size_t>((size_t)b, recount.size() - 1)]++;
+    }
+    uint64_t sum = 0;
+    for (uint32_t h : c.histogram()) sum += h;
+    expect(sum == window, "histogram holds exactly the window after wrapping");
+    expect(recount == c.histogram(), "histogram equals a recount of the window");
+    expect(c.histogram()[0] >= 1 && c.histogram().back() >= 1, "NaN goes to the first bin, long frames to the last");
+
+    c.clear();
+    sum = 0;
+    for (uint32_t h : c.histogram()) sum += h;
+    expect(c.count() == 0 && c.total() == 0 && sum == 0 && c.samples().empty(), "clear() empties window and histogram");
+    c.add(0.001);
+    expect(c.samples().size() == 1 && std::fabs(c.samples()[0] - 1.0) < 1e-9, "collector is usable after clear()");
+}
+
+void check_timer() {
+    std::printf("Timer (steady_clock backend)\n");
+    using clock = std::chrono::steady_clock;
+    Timer timer;
+    const auto t0 = clock::now();
+    timer.Reset();
+    timer.Tick();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    timer.Tick();
+    const double delta = timer.DeltaSeconds();
+    const double total = timer.TotalSeconds();
+    const double wall = std::chrono::duration<double>(clock::now() - t0).count();
+    std::printf("  delta %.3f ms, total %.3f ms, wall %.3f ms\n", delta * 1e3, total * 1e3, wall * 1e3);
+    expect(delta >= 0.019 && delta <= wall, "Tick delta covers the 20 ms sleep");
+    expect(total >= delta && total <= wall, "TotalSeconds is within the wall time");
+
+    // пауза не входит в TotalSeconds, а Tick на паузе даёт 0
+    timer.Stop();
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    timer.Tick();
+    expect(timer.DeltaSeconds() == 0.0, "Tick while stopped gives a zero delta");
+    timer.Start();
+    timer.Tick();
+    const double afterPause = timer.TotalSeconds();
+    std::printf("  total after a 30 ms pause %.3f ms\n", afterPause * 1e3);
+    expect(afterPause >= total && afterPause < total + 0.025, "paused time is excluded from TotalSeconds");
+
+    double minDelta = 1.0;
+    bool monotonic = true;
+    for (int i=0; i<100000; i++) {
+        timer.Tick();
+        monotonic = monotonic && timer.DeltaSeconds() >= 0.0;
+        if (timer.DeltaSeconds() > 0.0) minDelta = std::min(minDelta, timer.DeltaSeconds());
+    }
+    std::printf("  smallest non-zero delta between Ticks %.1f ns\n", minDelta * 1e9);
+    expect(monotonic, "back-to-back Ticks never go negative");
+}
+
+void bench_add(long long samples) {
+    // кадры из небольшого набора, чтобы генератор не попадал в замер
+    std::vector<double> frames(4096);
+    std::mt19937 rng(3);
+    std::lognormal_distribution<double> frame(std::log(0.016), 0.3);
+    for (double& f : frames) f = frame(rng);
+
+    framestats::Collector c;
+    double best = 1e9;
+    for (int rep=0; rep<5; rep++) {
+        const auto t0 = std::chrono::steady_clock::now();
+        for (long long i=0; i<samples; i++) c.add(frames[(size_t)i & 4095]);
+        const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+        best = std::min(best, ns / (double)samples);
+    }
+
+    const int summaries = 2000;
+    volatile double sink = 0;   // сводка не выбрасывается оптимизатором
+    const auto t1 = std::chrono::steady_clock::now();
+    for (int i=0; i<summaries; i++) { c.add(frames[(size_t)i & 4095]); sink = sink + c.summary().p99Ms; }
+    const double summaryUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t1).count() / summaries;
+
+    std::printf("add(): %.2f ns per sample (best of 5 x %lld), summary() on a %zu-frame window: %.2f us\n",
+                best, samples, c.count(), summaryUs);
+    // грубая граница: на порядок выше заявленного, чтобы ловить регрессии, а не шум машины
+    expect(best < 50.0, "add() stays within tens of nanoseconds");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    long long samples = 10000000;
+    for (int i=1; i<argc; i++) {
+        std::string a = argv[i];
+        if (a == "--samples" && i + 1 < argc) samples = std::max(1LL, std::atoll(argv[++i]));
+        else { std::fprintf(stderr, "неизвестный ключ %s\n", a.c_str()); return 2; }
+    }
+
+    check_percentiles();
+    check_ring();
+    check_timer();
+    bench_add(samples);
+    std::printf("%s\n", g_failures ? "FAILED" : "all checks ok");
+    return g_failures ? 1 : 0;
+}
@@ -0,0 +1,198 @@
+// Фоновые задачи CG4 (JobQueue, FrameHandoff) без DirectX: порядок, остановка, передача результатов.
+//
+//   jobqueue_bench [--jobs 100000] [--workers 4]
+//
+// Проверки:
+//   - FIFO: с одним рабочим задачи выполняются ровно в порядке Push, с несколькими - каждая один раз;
+//   - остановка: деструктор отбрасывает не начатые задачи (ни одна не выполнится, их объекты
+//     разрушены) и ждёт выполняющуюся до конца;
+//   - отмена: задача со std::stop_token видит запрос остановки от деструктора и выходит
+//     после текущего этапа, деструктор не ждёт всей задачи (так закрывается окно при загрузке Sponza);
+//   - FrameHandoff: всё, что положили рабочие, забирается TakeAll ровно один раз, в порядке Post
+//     внутри одного производителя, пока другой поток забирает одновременно.
+// Затем время на задачу: Push с потока рендера до конца WaitIdle.
+// Нарушение - код возврата 1 (ctest jobqueue_check).
+#include "JobQueue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+int g_failures = 0;
+
+void expect(bool ok, const char* what) {
+    std::printf("  %-52s %s\n", what, ok ? "ok" : "FAILED");
+    if (!ok) g_failures++;
+}
+
+void check_fifo(int jobs, unsigned workers) {
+    std::printf("FIFO, %d jobs\n", jobs);
+    {
+        std::vector<int> order;     // пишет только единственный рабочий
+        JobQueue q(1);
+        for (int i=0; i<jobs; i++) q.Push([&order, i] { order.push_back(i); });
+        q.WaitIdle();
+        bool ok = (int)order.size() == jobs;
+        for (int i=0; ok && i<jobs; i++) ok = order[i] == i;
+        expect(ok, "one worker runs jobs in Push order");
+        expect(q.Pending() == 0, "Pending() is 0 after WaitIdle");
+    }
+    {
+        // с несколькими рабочими порядок старта снаружи не наблюдаем: поток могут вытеснить
+        // между взятием задачи и её первой строкой. Проверяется, что каждая выполнена один раз
+        std::vector<std::atomic<int>> runs(jobs);
+        JobQueue q(workers);
+        for (int i=0; i<jobs; i++) q.Push([&runs, i] { runs[i].fetch_add(1, std::memory_order_relaxed); });
+        q.WaitIdle();
+        bool ok = true;
+        for (const auto& r : runs) ok = ok && r.load() == 1;
+        expect(ok, "several workers run every job exactly once");
+    }
+}
+
+void check_shutdown() {
+    std::printf("shutdown\n");
+    std::atomic<bool> release{false}, finished{false}, dropped{false};
+    std::atomic<int> stale{0};
+    auto token = std::make_shared<int>(0);      // копии живут в объектах не начатых задач
+    std::atomic<bool> running{false};
+    std::thread releaser;
+    {
+        JobQueue q(1);
+        q.Push([&] {
+            running = true;
+            while (!release) std::this_thread::yield();
+            finished = true;
+        });
+        while (!running) std::this_thread::yield();
+        for (int i=0; i<100; i++) q.Push([&stale, token] { stale++; });
+        expect(q.Pending() == 101, "Pending() counts queued and running jobs");
+
+        // рабочий занят первой задачей; отпускаем её, только когда деструктор
+        // разрушит все отброшенные задачи - иначе рабочий успел бы взять следующую.
+        // Не дождались за 5 с - отпускаем всё равно, чтобы проверка упала, а не зависла
+        releaser = std::thread([&] {
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            while (token.use_count() > 1 && std::chrono::steady_clock::now() < deadline) std::this_thread::yield();
+            dropped = token.use_count() == 1;
+            release = true;
+        });
+    }
+    releaser.join();
+    expect(dropped, "destructor destroys queued jobs before joining");
+    expect(finished, "destructor waits for the running job");
+    expect(stale == 0, "destructor drops jobs that have not started");
+}
+
+void check_cancel() {
+    std::printf("cancel\n");
+    using clock = std::chrono::steady_clock;
+    std::atomic<bool> running{false}, stopped{false};
+    std::atomic<int> stages{0};
+    auto q = std::make_unique<JobQueue>(1);
+    // 10 с работы этапами по 1 мс, как загрузка между этапами BuildMeshAsset
+    q->Push([&](std::stop_token stop) {
+        running = true;
+        for (int i=0; i<10000; i++) {
+            if (stop.stop_requested()) { stopped = true; return; }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            stages++;
+        }
+    });
+    while (!running) std::this_thread::yield();
+    const auto t0 = clock::now();
+    q.reset();
+    const double destroyMs = std::chrono::duration<double, std::milli>(clock::now() - t0).count();
+    std::printf("  destructor returned in %.2f ms after %d stages\n", destroyMs, stages.load());
+    expect(stopped, "running job sees the stop request");
+    expect(destroyMs < 1000.0, "destructor does not wait for the whole job");
+}
+
+void check_handoff(int jobs, unsigned workers) {
+    std::printf("FrameHandoff, %d results from %u workers\n", jobs, workers);
+    FrameHandoff<std::pair<unsigned, int>> handoff;     // {производитель, номер}
+    std::vector<std::pair<unsigned, int>> taken;
+    std::atomic<bool> done{false};
+    size_t takes = 0;
+
+    // поток рендера забирает результаты, пока рабочие их кладут
+    std::thread render([&] {
+        for (;;) {
+            const bool last = done.load();
+            std::vector<std::pair<unsigned, int>> part = handoff.TakeAll();
+            takes += !part.empty();
+            taken.insert(taken.end(), part.begin(), part.end());
+            if (last) break;
+        }
+    });
+    {
+        JobQueue q(workers);
+        const int per = jobs / (int)workers;
+        for (unsigned w=0; w<workers; w++)
+            q.Push([&handoff, w, per] {
+                for (int i=0; i<per; i++) {
+                    handoff.Post({ w, i });
+                    if (i % 256 == 255) std::this_thread::yield();      // даём рендеру забрать часть
+                }
+            });
+        q.WaitIdle();
+    }
+    done = true;
+    render.join();
+
+    const int per = jobs / (int)workers;
+    bool once = taken.size() == (size_t)per * workers, ordered = true;
+    std::vector<int> last(workers, -1);
+    std::vector<int> seen((size_t)per * workers, 0);
+    for (const auto& [w, i] : taken) {
+        if (w >= workers || i < 0 || i >= per) { once = false; continue; }
+        if (seen[(size_t)w * per + i]++) once = false;
+        if (i <= last[w]) ordered = false;
+        last[w] = i;
+    }
+    std::printf("  %zu results in %zu non-empty TakeAll calls\n", taken.size(), takes);
+    expect(once, "every posted result is taken exactly once");
+    expect(ordered, "results of one producer keep Post order");
+    expect(handoff.TakeAll().empty(), "TakeAll after draining is empty");
+}
+
+void bench_latency(int jobs, unsigned workers) {
+    std::atomic<int> sum{0};
+    JobQueue q(workers);
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int i=0; i<jobs; i++) q.Push([&sum] { sum.fetch_add(1, std::memory_order_relaxed); });
+    q.WaitIdle();
+    const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+    std::printf("throughput: %d empty jobs on %u workers in %.1f ms, %.3f us per job\n",
+                jobs, workers, us * 1e-3, us / jobs);
+    if (sum != jobs) { std::printf("  lost jobs: %d of %d\n", jobs - sum.load(), jobs); g_failures++; }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int jobs = 100000;
+    unsigned workers = 4;
+    for (int i=1; i<argc; i++) {
+        std::string a = argv[i];
+        if (a == "--jobs" && i + 1 < argc) jobs = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--workers" && i + 1 < argc) workers = (unsigned)std::max(1, std::atoi(argv[++i]));
+        else { std::fprintf(stderr, "неизвестный ключ %s\n", a.c_str()); return 2; }
+    }
+
+    check_fifo(jobs, workers);
+    check_shutdown();
+    check_cancel();
+    check_handoff(jobs, workers);
+    bench_latency(jobs, workers);
+    std::printf("%s\n", g_failures ? "FAILED" : "all checks ok");
+    return g_failures ? 1 : 0;
+}
@@ -0,0 +1,322 @@
+// Замер загрузчиков OBJ: CG3 Model::Model и CG4 ParseObj / LoadObjSimple.
+//
+//   loader_bench [--sizes 10k,100k,1M,10M,50M] [--forms v,v/vt,v//vn,v/vt/vn,quad,negative]
+//                [--dir каталог] [--serial] [--keep] [--out файл.json] [obj ...]
+//
+// Для каждого размера и формы углов пишется синтетический OBJ (synth_obj), затем меряются случаи:
+//   cg3_parse   Model::Model без кэша (разбор + запись .cgmb)
+//   cg3_cached  Model::Model из кэша
+//   cg4_parse   ParseObj на всех ядрах (только разбор и слияние вершин)
+//   cg4_load    LoadObjSimple без кэша (разбор, группировка, OptimizeMesh, запись .cgmb)
+//   cg4_cached  LoadObjSimple из кэша
+//   cg4_serial  ParseObjSerial, эталонный построчный разбор (только с --serial)
+// Файлы из аргументов меряются так же, с формой "file"; их собственные кэши .cg3.cgmb/.cg4.cgmb
+// на время замера откладываются и потом возвращаются.
+//
+// После замеров каждого OBJ проверяется соседство кэшей: CG3 и CG4 загружают его ещё раз
+// по очереди, оба обязаны прочитать свой кэш, не пересобирая его (mtime файла не меняется),
+// и получить то же число треугольников. Провал - код возврата 1 (ctest loader_cache_check).
+//
+// Каждый случай - в отдельном процессе (fork): пиковый RSS и счётчики operator new
+// относятся только к нему. Файл только что записан и лежит в кэше страниц,
+// поэтому MB/s - скорость разбора, а не диска. Результат - JSON в stdout или --out.
+#include "synth_obj.h"
+#include "../CG3/model.h"
+#include "ObjLoader.h"
+#include "ObjParser.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// ---- счётчик аллокаций: все формы new сводятся к этим двум ----
+
+static std::atomic<uint64_t> g_allocs{0};
+static std::atomic<uint64_t> g_alloc_bytes{0};
+
+void* operator new(size_t n) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    g_alloc_bytes.fetch_add(n, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t n, std::align_val_t a) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    g_alloc_bytes.fetch_add(n, std::memory_order_relaxed);
+    size_t al = (size_t)a;
+    if (void* p = std::aligned_alloc(al, (n + al - 1) / al * al)) return p;
+    throw std::bad_alloc();
+}
+
+// GCC видит пару new/free внутри замены и ошибочно считает её несовпадающей
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+
+namespace {
+
+struct Sample {
+    int ok = 0;
+    double seconds = 0;
+    uint64_t triangles = 0;
+    uint64_t allocs = 0;
+    uint64_t alloc_bytes = 0;
+    long peak_rss_kb = 0;
+};
+
+// fn возвращает число треугольников, 0 - загрузка не удалась
+Sample run_isolated(const std::function<uint64_t()>& fn) {
+    Sample s;
+    int fd[2];
+    if (pipe(fd) != 0) return s;
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fd[0]);
+        std::cout.rdbuf(nullptr);       // CG3 печатает статистику загрузки
+        g_allocs = 0;
+        g_alloc_bytes = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        uint64_t tris = fn();
+        s.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        s.allocs = g_allocs;
+        s.alloc_bytes = g_alloc_bytes;
+        s.triangles = tris;
+        s.ok = tris > 0;
+        rusage ru{};
+        getrusage(RUSAGE_SELF, &ru);
+        s.peak_rss_kb = ru.ru_maxrss;
+        ssize_t w = write(fd[1], &s, sizeof(s));
+        _exit(w == (ssize_t)sizeof(s) ? 0 : 1);
+    }
+    close(fd[1]);
+    if (pid > 0) {
+        if (read(fd[0], &s, sizeof(s)) != (ssize_t)sizeof(s)) s = Sample{};
+        waitpid(pid, nullptr, 0);
+    }
+    close(fd[0]);
+    return s;
+}
+
+bool parse_count(const std::string& s, uint64_t& out) {
+    char* end = nullptr;
+    double v = std::strtod(s.c_str(), &end);
+    if (end == s.c_str()) return false;
+    if (*end == 'k' || *end == 'K') v *= 1e3;
+    else if (*end == 'm' || *end == 'M') v *= 1e6;
+    out = (uint64_t)v;
+    return out > 0;
+}
+
+std::vector<std::string> split(const std::string& s) {
+    std::vector<std::string> out;
+    size_t b = 0;
+    while (b <= s.size()) {
+        size_t e = s.find(',', b);
+        if (e == std::string::npos) e = s.size();
+        if (e > b) out.push_back(s.substr(b, e - b));
+        b = e + 1;
+    }
+    return out;
+}
+
+const char* const kCacheTags[] = { "cg3", "cg4" };
+
+void remove_cache(const std::string& obj, const char* tag) {
+    std::error_code ec;
+    std::filesystem::remove(meshcache::cache_path(obj, tag), ec);
+}
+
+struct Input {
+    std::string path;
+    std::string form;
+    uint64_t bytes = 0;
+    bool synthetic = false;
+};
+
+// false - один из загрузчиков пересобрал кэш после другого или получил другой меш
+bool check_cache_neighbours(const std::string& path, const std::function<uint64_t()>& cg3,
+                            const std::function<uint64_t()>& cg4) {
+    namespace fs = std::filesystem;
+    const fs::path c3 = meshcache::cache_path(path, "cg3"), c4 = meshcache::cache_path(path, "cg4");
+    std::error_code ec;
+    const Sample a3 = run_isolated(cg3), a4 = run_isolated(cg4);
+    const auto t3 = fs::last_write_time(c3, ec);
+    const bool has3 = !ec;
+    const auto t4 = fs::last_write_time(c4, ec);
+    const bool has4 = !ec;
+    const Sample b3 = run_isolated(cg3), b4 = run_isolated(cg4);
+
+    const bool ok = a3.ok && a4.ok && has3 && has4 && b3.triangles == a3.triangles && b4.triangles == a4.triangles &&
+                    fs::last_write_time(c3, ec) == t3 && fs::last_write_time(c4, ec) == t4;
+    std::fprintf(stderr, "  cache cross-load: %s (cg3 %llu tris, cg4 %llu tris)\n", ok ? "ok" : "FAILED",
+                 (unsigned long long)b3.triangles, (unsigned long long)b4.triangles);
+    return ok;
+}
+
+bool bench_file(const Input& in, bool serial, FILE* out, bool& firstRow) {
+    // кэши чужого OBJ не теряем: откладываем их на время замера
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    bool hadCache[2] = {};
+    for (int t = 0; t < 2; t++) {
+        const fs::path cache = meshcache::cache_path(in.path, kCacheTags[t]);
+        hadCache[t] = !in.synthetic && fs::exists(cache, ec);
+        if (hadCache[t]) fs::rename(cache, cache.string() + ".bench-saved", ec);
+    }
+
+    struct Case { const char* name; const char* dropCache; std::function<uint64_t()> fn; };
+    const std::string path = in.path;
+    const std::function<uint64_t()> cg3 = [&] { Model m(path.c_str()); return (uint64_t)m.nfaces(); };
+    const std::function<uint64_t()> cg4 = [&] {
+        std::vector<MeshVertex> v; std::vector<uint32_t> i; Float3 lo, hi;
+        return LoadObjSimple(path, v, i, lo, hi) ? (uint64_t)i.size() / 3 : 0;
+    };
+
+    std::vector<Case> cases = {
+        { "cg3_parse", "cg3", cg3 },
+        { "cg3_cached", nullptr, cg3 },
+        { "cg4_parse", nullptr, [&] {
+            ObjParseResult r;
+            return ParseObj(path, r) ? (uint64_t)r.indices.size() / 3 : 0;
+        } },
+        { "cg4_load", "cg4", cg4 },
+        { "cg4_cached", nullptr, cg4 },
+    };
+    if (serial)
+        cases.push_back({ "cg4_serial", nullptr, [&] {
+            ObjParseResult r;
+            return ParseObjSerial(path, r) ? (uint64_t)r.indices.size() / 3 : 0;
+        } });
+
+    for (const Case& c : cases) {
+        if (c.dropCache) remove_cache(path, c.dropCache);
+        Sample s = run_isolated(c.fn);
+        const double mb = in.bytes / (1024.0 * 1024.0);
+        std::fprintf(stderr, "  %-10s %-9s %8.3f s %9.1f MB/s %7.1f Mtris/s  rss %7.1f MB  allocs %llu\n",
+                     c.name, in.form.c_str(), s.seconds, s.seconds > 0 ? mb / s.seconds : 0.0,
+                     s.seconds > 0 ? s.triangles / s.seconds * 1e-6 : 0.0, s.peak_rss_kb / 1024.0,
+                     (unsigned long long)s.allocs);
+
+        std::fprintf(out, "%s\n    {\"loader\": \"%s\", \"mesh\": \"%s\", \"form\": \"%s\", \"synthetic\": %s, "
+                          "\"file_bytes\": %llu, \"triangles\": %llu, \"ok\": %s, \"seconds\": %.6f, "
+                          "\"mb_per_s\": %.3f, \"tris_per_s\": %.1f, \"peak_rss_mb\": %.3f, "
+                          "\"allocations\": %llu, \"allocated_mb\": %.3f}",
+                     firstRow ? "" : ",", c.name, std::filesystem::path(path).filename().string().c_str(),
+                     in.form.c_str(), in.synthetic ? "true" : "false",
+                     (unsigned long long)in.bytes, (unsigned long long)s.triangles, s.ok ? "true" : "false",
+                     s.seconds, s.seconds > 0 ? mb / s.seconds : 0.0, s.seconds > 0 ? s.triangles / s.seconds : 0.0,
+                     s.peak_rss_kb / 1024.0, (unsigned long long)s.allocs, s.alloc_bytes / (1024.0 * 1024.0));
+        firstRow = false;
+    }
+    const bool ok = check_cache_neighbours(path, cg3, cg4);
+
+    for (int t = 0; t < 2; t++) {
+        remove_cache(path, kCacheTags[t]);
+        const fs::path cache = meshcache::cache_path(path, kCacheTags[t]);
+        if (hadCache[t]) fs::rename(cache.string() + ".bench-saved", cache, ec);
+    }
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<uint64_t> sizes = { 10'000, 100'000, 1'000'000, 10'000'000, 50'000'000 };
+    std::vector<synth::Form> forms = { synth::Form::V, synth::Form::VT, synth::Form::VN,
+                                       synth::Form::VTN, synth::Form::Quad, synth::Form::Negative };
+    std::string dir = std::filesystem::temp_directory_path().string();
+    std::string outPath;
+    bool serial = false, keep = false;
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) { std::fprintf(stderr, "%s: value expected\n", a.c_str()); std::exit(2); }
+            return argv[++i];
+        };
+        if (a == "--sizes") {
+            sizes.clear();
+            for (auto& s : split(value())) {
+                uint64_t n;
+                if (!parse_count(s, n)) { std::fprintf(stderr, "bad size: %s\n", s.c_str()); return 2; }
+                sizes.push_back(n);
+            }
+        }
+        else if (a == "--forms") {
+            forms.clear();
+            for (auto& s : split(value())) {
+                synth::Form f;
+                if (!synth::parse_form(s, f)) { std::fprintf(stderr, "bad form: %s\n", s.c_str()); return 2; }
+                forms.push_back(f);
+            }
+        }
+        else if (a == "--dir") dir = value();
+        else if (a == "--out") outPath = value();
+        else if (a == "--serial") serial = true;
+        else if (a == "--keep") keep = true;
+        else if (!a.empty() && a[0] == '-') { std::fprintf(stderr, "unknown option: %s\n", a.c_str()); return 2; }
+        else files.push_back(a);
+    }
+
+    FILE* out = outPath.empty() ? stdout : std::fopen(outPath.c_str(), "w");
+    if (!out) { std::fprintf(stderr, "cannot write %s\n", outPath.c_str()); return 1; }
+
+    std::fprintf(out, "{\n  \"hardware_threads\": %u,\n  \"results\": [", std::thread::hardware_concurrency());
+    bool firstRow = true;
+    bool failed = false;
+
+    for (uint64_t n : sizes)
+        for (synth::Form f : forms) {
+            Input in;
+            in.synthetic = true;
+            in.form = synth::form_name(f);
+            std::string tag = in.form;
+            for (char& c : tag) if (c == '/') c = '_';
+            in.path = (std::filesystem::path(dir) / ("synth_" + std::to_string(n) + "_" + tag + ".obj")).string();
+
+            synth::Info info;
+            if (!synth::write_obj(in.path, n, f, info)) {
+                std::fprintf(stderr, "cannot write %s\n", in.path.c_str());
+                continue;
+            }
+            in.bytes = info.bytes;
+            std::fprintf(stderr, "%s: %llu tris, %.1f MB\n", in.path.c_str(),
+                         (unsigned long long)info.triangles, info.bytes / (1024.0 * 1024.0));
+            if (!bench_file(in, serial, out, firstRow)) failed = true;
+            if (!keep) std::filesystem::remove(in.path);
+        }
+
+    for (const std::string& path : files) {
+        Input in;
+        in.path = path;
+        in.form = "file";
+        std::error_code ec;
+        in.bytes = std::filesystem::file_size(path, ec);
+        if (ec) { std::fprintf(stderr, "cannot stat %s\n", path.c_str()); continue; }
+        std::fprintf(stderr, "%s: %.1f MB\n", path.c_str(), in.bytes / (1024.0 * 1024.0));
+        if (!bench_file(in, serial, out, firstRow)) failed = true;
+    }
+
+    std::fprintf(out, "\n  ]\n}\n");
+    if (out != stdout) std::fclose(out);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,213 @@
+// Отсечение мешлетов CG4 (CullMeshlets: пирамида видимости и конусы нормалей) без окна и GPU.
+//
+//   meshlet_bench [--theta 4.712] [--phi 0.785] [--radius 5] [--aspect 1.778] [--orbit 36]
+//                 [--materials] [--require-lod] [--keep] [obj]
+//
+// Меш собирается тем же BuildMeshAsset, что и в Dx12Renderer (Sponza - Assets/sponza.obj);
+// без obj - синтетический город synth::write_city. Камера по умолчанию - стартовая камера App:
+// theta 1.5 pi, phi pi/4, радиус 5, окно 1280x720, fov pi/4. Печатается доля отброшенных
+// треугольников уровня 0 - пирамидой, конусами и всего - для этой камеры и в среднем
+// по orbit положениям на полном обороте с тем же phi и радиусом.
+//
+// LOD по батчам: для тех же камер - сколько батчей получили уровень грубее 0 (расстояние от
+// глаза до бокса батча, ошибка не больше пикселя, как в Dx12Renderer) и сколько треугольников
+// осталось от уровня 0. --materials - город с отдельным usemtl на каждую коробку и неровными
+// крышами; --require-lod - код возврата 1, если для первой камеры ни один батч не взял уровень
+// с ненулевой ошибкой, то есть выбор не зависит от расстояния (ctest lod_select_check).
+//
+// Загрузка с уже запрошенной остановкой должна вернуть false.
+// Проверка: каждый треугольник отброшенного мешлета должен лежать целиком за одной плоскостью
+// пирамиды или смотреть от камеры. Нарушение - код возврата 1 (ctest meshlet_cull_check).
+#include "MeshAsset.h"
+#include "../shared/mesh_cache.h"
+#include "../shared/mesh_lod.h"
+#include "bench_camera.h"
+#include "synth_obj.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace {
+
+namespace fs = std::filesystem;
+using clock_type = std::chrono::steady_clock;
+
+struct Totals {
+    size_t triangles = 0, frustum = 0, backface = 0;
+    double ms = 0;
+    void add(const MeshletCullStats& st) {
+        triangles += st.triangles;
+        frustum += st.frustumCulled;
+        backface += st.backfaceCulled;
+    }
+    double share(size_t n) const { return triangles ? 100.0 * n / triangles : 0.0; }
+};
+
+// допуски на квантование позиций в PackedVertex (unorm16 на 50 единиц - шаг ~8e-4)
+constexpr float kPlaneSlack = 2e-3f;
+constexpr float kFacingSlack = 1e-3f;
+
+// false - отброшен треугольник, который виден: не за плоскостью и смотрит на камеру
+bool culled_correctly(const Float3 p[3], const Frustum& frustum, const Float3& eye) {
+    for (const auto& pl : frustum.planes) {
+        bool behind = true;
+        for (int k=0; k<3; k++)
+            behind = behind && pl[0]*p[k].x + pl[1]*p[k].y + pl[2]*p[k].z + pl[3] < kPlaneSlack;
+        if (behind) return true;
+    }
+    const Float3 e1(p[1].x - p[0].x, p[1].y - p[0].y, p[1].z - p[0].z);
+    const Float3 e2(p[2].x - p[0].x, p[2].y - p[0].y, p[2].z - p[0].z);
+    const Float3 n(e1.y*e2.z - e1.z*e2.y, e1.z*e2.x - e1.x*e2.z, e1.x*e2.y - e1.y*e2.x);
+    const Float3 d(p[0].x - eye.x, p[0].y - eye.y, p[0].z - eye.z);
+    const float nl = std::sqrt(n.x*n.x + n.y*n.y + n.z*n.z), dl = std::sqrt(d.x*d.x + d.y*d.y + d.z*d.z);
+    if (nl < 1e-12f) return true;       // вырожденный не рисуется
+    return n.x*d.x + n.y*d.y + n.z*d.z >= -kFacingSlack * nl * dl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    float theta = 1.5f * 3.14159265f, phi = 0.25f * 3.14159265f, radius = 5.f, aspect = 1280.f / 720.f;
+    int orbit = 36;
+    bool keep = false, materials = false, requireLod = false;
+    fs::path obj;
+    for (int i=1; i<argc; i++) {
+        std::string a = argv[i];
+        auto next = [&]() -> const char* {
+            if (i + 1 >= argc) { std::fprintf(stderr, "%s: нет значения\n", a.c_str()); std::exit(2); }
+            return argv[++i];
+        };
+        if (a == "--theta") theta = (float)std::atof(next());
+        else if (a == "--phi") phi = (float)std::atof(next());
+        else if (a == "--radius") radius = (float)std::atof(next());
+        else if (a == "--aspect") aspect = (float)std::atof(next());
+        else if (a == "--orbit") orbit = std::max(0, std::atoi(next()));
+        else if (a == "--keep") keep = true;
+        else if (a == "--materials") materials = true;
+        else if (a == "--require-lod") requireLod = true;
+        else if (!a.empty() && a[0] == '-') { std::fprintf(stderr, "неизвестный ключ %s\n", a.c_str()); return 2; }
+        else obj = a;
+    }
+
+    const bool synthetic = obj.empty();
+    if (synthetic) {
+        obj = fs::temp_directory_path() / (materials ? "cg_meshlet_city_mtl.obj" : "cg_meshlet_city.obj");
+        if (!synth::write_city(obj.string(), materials)) { std::perror(obj.string().c_str()); return 2; }
+    }
+
+    // остановленная загрузка (закрытие окна) не собирает ассет
+    bool cancelOk = true;
+    {
+        std::stop_source cancel;
+        cancel.request_stop();
+        MeshAsset stopped;
+        cancelOk = !BuildMeshAsset(obj, stopped, 50.0f, cancel.get_token());
+    }
+
+    MeshAsset asset;
+    if (!BuildMeshAsset(obj, asset)) { std::fprintf(stderr, "%s: не прочитан\n", obj.string().c_str()); return 2; }
+
+    // позиции уровня 0 в порядке мешлетов, после распаковки - как их увидит GPU
+    const uint32_t count = asset.lod.levels[0].count;
+    std::vector<Float3> corner(count);
+    for (uint32_t i=0; i<count; i++) {
+        const Submesh16 s = asset.submeshes.empty() ? Submesh16{} : asset.submeshes[FindSubmesh16(asset.submeshes, i)];
+        corner[i] = UnpackVertex(asset.vertices[asset.indices[i] + s.baseVertex], asset.quant).pos;
+    }
+    const MeshletMesh& mesh = asset.meshlets;
+    size_t coned = 0;
+    for (const Meshlet& m : mesh.meshlets) coned += m.coneCutoff < 1.f;
+    std::printf("mesh %s: %u triangles, %zu meshlets (%.1f%% with a usable normal cone)\n",
+                synthetic ? "city" : obj.string().c_str(), count / 3, mesh.meshlets.size(),
+                mesh.meshlets.empty() ? 0.0 : 100.0 * coned / mesh.meshlets.size());
+
+    std::vector<uint32_t> visible;
+    int failures = 0;
+    // одна камера: статистика CullMeshlets и проверка всех отброшенных мешлетов
+    auto run = [&](float th, Totals& tot) {
+        const Float3 eye = bench::orbit_eye(th, phi, radius);
+        const bench::Mat vp = bench::view_proj(eye, 0.25f * 3.14159265f, aspect, 0.1f, 1000.f);
+        const Frustum frustum = FrustumFromViewProj(vp.m);
+        MeshletCullStats st;
+        const auto t = clock_type::now();
+        CullMeshlets(mesh, frustum, eye, visible, &st);
+        tot.ms += std::chrono::duration<double, std::milli>(clock_type::now() - t).count();
+        tot.add(st);
+
+        size_t next = 0;
+        for (uint32_t m=0; m<mesh.meshlets.size(); m++) {
+            if (next < visible.size() && visible[next] == m) { next++; continue; }
+            const Meshlet& ml = mesh.meshlets[m];
+            for (uint32_t k=0; k<ml.triangleCount; k++) {
+                const Float3* p = &corner[mesh.FirstIndex(ml) + k*3];
+                if (!culled_correctly(p, frustum, eye) && failures++ < 10)
+                    std::printf("  theta %.3f: meshlet %u triangle %u culled but visible\n", th, m, k);
+            }
+        }
+    };
+
+    Totals typical;
+    run(theta, typical);
+    std::printf("camera theta %.3f phi %.3f radius %.2f aspect %.3f: rejected %zu / %zu triangles = %.1f%% "
+                "(frustum %.1f%%, cone %.1f%%), %.3f ms\n",
+                theta, phi, radius, aspect, typical.frustum + typical.backface, typical.triangles,
+                typical.share(typical.frustum + typical.backface), typical.share(typical.frustum),
+                typical.share(typical.backface), typical.ms);
+
+    if (orbit > 0) {
+        Totals around;
+        for (int f=0; f<orbit; f++) run(6.2831853f * f / orbit, around);
+        std::printf("orbit of %d cameras: rejected %.1f%% (frustum %.1f%%, cone %.1f%%), %.3f ms per call\n",
+                    orbit, around.share(around.frustum + around.backface), around.share(around.frustum),
+                    around.share(around.backface), around.ms / orbit);
+    }
+    std::printf("conservativeness check: %s (%d visible triangles culled)\n", failures ? "FAILED" : "ok", failures);
+
+    // выбор уровня по батчам, как в Dx12Renderer::Draw: окно 720 строк, ошибка до пикселя
+    const size_t groups = asset.groupBounds.size();
+    struct LodTotals { size_t coarser = 0, lossy = 0, batches = 0; uint64_t drawn = 0, full = 0; };
+    auto lod = [&](float th, LodTotals& tot) {
+        const Float3 e = bench::orbit_eye(th, phi, radius);
+        const float eye[3] = { e.x, e.y, e.z };
+        for (size_t g=0; g<groups; g++) {
+            const int level = meshlod::select_group_level(asset.lod, g, asset.groupBounds[g], eye,
+                                                          0.25f * 3.14159265f, 720.f);
+            tot.coarser += level > 0;
+            tot.lossy += asset.lod.groups[level * groups + g].error > 0.f;
+            tot.batches++;
+            tot.drawn += asset.lod.groups[level * groups + g].count / 3;
+            tot.full += asset.lod.groups[g].count / 3;
+        }
+    };
+    LodTotals first;
+    lod(theta, first);
+    std::printf("lod: %zu / %zu batches coarser than level 0 (%zu with nonzero error), "
+                "%llu / %llu triangles (%.1f%%) for the camera\n",
+                first.coarser, first.batches, first.lossy, (unsigned long long)first.drawn, (unsigned long long)first.full,
+                first.full ? 100.0 * first.drawn / first.full : 0.0);
+    if (orbit > 0) {
+        LodTotals around;
+        for (int f=0; f<orbit; f++) lod(6.2831853f * f / orbit, around);
+        std::printf("lod over the orbit: %.1f%% of batches coarser, %.1f%% of triangles drawn\n",
+                    around.batches ? 100.0 * around.coarser / around.batches : 0.0,
+                    around.full ? 100.0 * around.drawn / around.full : 0.0);
+    }
+    const bool lodMissing = requireLod && first.lossy == 0;
+    if (requireLod)
+        std::printf("lod reachability check: %s\n", lodMissing ? "FAILED (no lossy level chosen)" : "ok");
+
+    if (synthetic && !keep) {
+        std::error_code ec;
+        fs::remove(obj, ec);
+        fs::remove(meshcache::cache_path(obj, "cg4"), ec);
+        fs::remove(meshlod::cache_path(obj), ec);
+    }
+    std::printf("stopped load check: %s\n", cancelOk ? "ok" : "FAILED (asset built after stop)");
+    return failures || lodMissing || !cancelOk ? 1 : 0;
+}
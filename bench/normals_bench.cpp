@@ -0,0 +1,176 @@
+// Проверка гладких нормалей с изломом (shared/mesh_normals) на кубе и сфере.
+//
+//   normals_bench [--segments 256]
+//
+// Куб из 8 общих вершин и 12 треугольников:
+//   - излом 60 градусов: у каждой вершины по нормали на грань, 24 нормали, каждая - нормаль своей грани;
+//   - без излома (180): 8 нормалей по диагоналям - вес "площадь * угол" у всех трёх граней угла равный.
+// UV-сфера segments x segments/2 со сваренным швом и полюсами:
+//   - излом 60 градусов не срабатывает: ровно одна нормаль на вершину;
+//   - нормаль отличается от направления из центра не больше чем на kMaxSphereDegrees.
+// Для обоих мешей результат не зависит от числа потоков и одинаков для индексов uint32 и int (CG3);
+// потоков не больше одного на 4096 граней, поэтому сфера по умолчанию плотная - 65k треугольников.
+// Нарушение - код возврата 1 (ctest normals_check).
+#include "../shared/mesh_normals.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr double kMaxSphereDegrees = 0.5;
+constexpr double kRadToDeg = 57.29577951308232;
+
+int g_failures = 0;
+
+void expect(bool ok, const char* what) {
+    std::printf("  %-60s %s\n", what, ok ? "ok" : "FAILED");
+    if (!ok) g_failures++;
+}
+
+struct Mesh {
+    std::vector<float> pos;         // xyz
+    std::vector<uint32_t> idx;
+    size_t vertices() const { return pos.size() / 3; }
+};
+
+meshnormals::Result run(const Mesh& m, float crease, int threads) {
+    meshnormals::Params p;
+    p.creaseDegrees = crease;
+    p.threads = threads;
+    return meshnormals::generate(m.pos.data(), 3 * sizeof(float), m.vertices(), m.idx.data(), m.idx.size(), p);
+}
+
+bool same(const meshnormals::Result& a, const meshnormals::Result& b) {
+    return a.normals == b.normals && a.vertex == b.vertex && a.corner == b.corner;
+}
+
+// разные потоки и int-индексы дают тот же результат
+void check_determinism(const Mesh& m, float crease, const meshnormals::Result& ref) {
+    bool ok = true;
+    for (int threads : { 1, 2, 3, 8 }) ok = ok && same(run(m, crease, threads), ref);
+    expect(ok, "same result for 1, 2, 3 and 8 threads");
+
+    meshnormals::Params p;
+    p.creaseDegrees = crease;
+    const std::vector<int> signedIdx(m.idx.begin(), m.idx.end());
+    expect(same(meshnormals::generate(m.pos.data(), 3 * sizeof(float), m.vertices(), signedIdx.data(),
+                                      signedIdx.size(), p), ref), "same result for int indices");
+}
+
+// угол между нормалью и вектором в градусах, через хорду
+double angle_degrees(const float* n, double x, double y, double z) {
+    const double l = std::sqrt(x*x + y*y + z*z);
+    const double dx = n[0] - x/l, dy = n[1] - y/l, dz = n[2] - z/l;
+    return 2.0 * std::asin(std::min(1.0, std::sqrt(dx*dx + dy*dy + dz*dz) * 0.5)) * kRadToDeg;
+}
+
+Mesh make_cube() {
+    Mesh m;
+    for (int c=0; c<8; c++)
+        m.pos.insert(m.pos.end(), { c & 1 ? 1.f : -1.f, c & 2 ? 1.f : -1.f, c & 4 ? 1.f : -1.f });
+    // грани против часовой стрелки снаружи
+    const uint32_t quads[6][4] = {
+        { 0, 4, 6, 2 }, { 1, 3, 7, 5 },     // -x, +x
+        { 0, 1, 5, 4 }, { 2, 6, 7, 3 },     // -y, +y
+        { 0, 2, 3, 1 }, { 4, 5, 7, 6 },     // -z, +z
+    };
+    for (const auto& q : quads) m.idx.insert(m.idx.end(), { q[0], q[1], q[2], q[0], q[2], q[3] });
+    return m;
+}
+
+Mesh make_sphere(int segments) {
+    Mesh m;
+    const int rings = std::max(2, segments / 2);
+    m.pos.insert(m.pos.end(), { 0.f, 1.f, 0.f });                 // северный полюс - 0
+    for (int r=1; r<rings; r++) {
+        const double phi = 3.14159265358979 * r / rings;
+        for (int s=0; s<segments; s++) {
+            const double th = 2.0 * 3.14159265358979 * s / segments;
+            m.pos.insert(m.pos.end(), { (float)(std::sin(phi) * std::cos(th)), (float)std::cos(phi),
+                                        (float)(std::sin(phi) * std::sin(th)) });
+        }
+    }
+    const uint32_t south = (uint32_t)m.vertices();
+    m.pos.insert(m.pos.end(), { 0.f, -1.f, 0.f });
+    auto ring = [&](int r, int s) { return (uint32_t)(1 + (r - 1) * segments + (s % segments)); };
+    for (int s=0; s<segments; s++) {
+        m.idx.insert(m.idx.end(), { 0u, ring(1, s + 1), ring(1, s) });
+        m.idx.insert(m.idx.end(), { south, ring(rings - 1, s), ring(rings - 1, s + 1) });
+    }
+    for (int r=1; r<rings-1; r++)
+        for (int s=0; s<segments; s++) {
+            const uint32_t a = ring(r, s), b = ring(r, s + 1), c = ring(r + 1, s), d = ring(r + 1, s + 1);
+            m.idx.insert(m.idx.end(), { a, b, d, a, d, c });
+        }
+    return m;
+}
+
+void check_cube() {
+    const Mesh cube = make_cube();
+    std::printf("cube: %zu vertices, %zu triangles\n", cube.vertices(), cube.idx.size() / 3);
+
+    // излом: нормаль угла - нормаль его грани (грань = пара треугольников подряд)
+    const meshnormals::Result sharp = run(cube, 60.f, 0);
+    std::printf("  crease 60: %zu normals\n", sharp.count());
+    expect(sharp.count() == 24, "24 normals, one per face at each corner");
+    bool faceNormals = sharp.corner.size() == cube.idx.size();
+    for (size_t c=0; faceNormals && c<cube.idx.size(); c++) {
+        const size_t face = c / 6;
+        float want[3] = { 0, 0, 0 };
+        want[face / 2] = face % 2 ? 1.f : -1.f;
+        const float* n = &sharp.normals[sharp.corner[c] * 3];
+        faceNormals = std::fabs(n[0] - want[0]) < 1e-6f && std::fabs(n[1] - want[1]) < 1e-6f &&
+                      std::fabs(n[2] - want[2]) < 1e-6f && sharp.vertex[sharp.corner[c]] == cube.idx[c];
+    }
+    expect(faceNormals, "every corner gets its own face normal");
+    check_determinism(cube, 60.f, sharp);
+
+    const meshnormals::Result smooth = run(cube, 180.f, 0);
+    std::printf("  crease 180: %zu normals\n", smooth.count());
+    expect(smooth.count() == 8, "8 normals without creases");
+    double worst = 0;
+    for (size_t i=0; i<smooth.count(); i++) {
+        const float* p = &cube.pos[smooth.vertex[i] * 3];
+        worst = std::max(worst, angle_degrees(&smooth.normals[i * 3], p[0], p[1], p[2]));
+    }
+    expect(worst < 1e-3, "smooth normals point along the corner diagonals");
+}
+
+void check_sphere(int segments) {
+    const Mesh sphere = make_sphere(segments);
+    const meshnormals::Result r = run(sphere, 60.f, 0);
+    double worst = 0;
+    bool oneEach = r.count() == sphere.vertices();
+    for (size_t i=0; i<r.count(); i++) {
+        if (oneEach && r.vertex[i] != i) oneEach = false;
+        const float* p = &sphere.pos[r.vertex[i] * 3];
+        worst = std::max(worst, angle_degrees(&r.normals[i * 3], p[0], p[1], p[2]));
+    }
+    std::printf("sphere %dx%d: %zu vertices, %zu triangles, %zu normals, max deviation %.4f deg (limit %.2f)\n",
+                segments, std::max(2, segments / 2), sphere.vertices(), sphere.idx.size() / 3, r.count(),
+                worst, kMaxSphereDegrees);
+    expect(oneEach, "one normal per vertex: no crease on a smooth surface");
+    expect(worst <= kMaxSphereDegrees, "normals follow the radius");
+    check_determinism(sphere, 60.f, r);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int segments = 256;
+    for (int i=1; i<argc; i++) {
+        std::string a = argv[i];
+        if (a == "--segments" && i + 1 < argc) segments = std::max(8, std::atoi(argv[++i]));
+        else { std::fprintf(stderr, "неизвестный ключ %s\n", a.c_str()); return 2; }
+    }
+
+    check_cube();
+    check_sphere(segments);
+    std::printf("%s\n", g_failures ? "FAILED" : "all checks ok");
+    return g_failures ? 1 : 0;
+}
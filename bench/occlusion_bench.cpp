@@ -0,0 +1,232 @@
+// Программное отсечение перекрытых CG4 (OcclusionBuffer) без окна и GPU.
+//
+//   occlusion_bench [--frames 360] [--radius 5] [--phi 1.35] [--size 256x128]
+//                   [--ref-size 1280x720] [--no-check] [--keep] [obj]
+//
+// Меш собирается тем же BuildMeshAsset, что и в Dx12Renderer; без obj - синтетический город
+// (кварталы из разбитых на сетку коробок вокруг пустой площади). Камера как у рендерера:
+// орбита радиуса radius вокруг центра под полярным углом phi, за frames кадров - полный оборот.
+// На каждом кадре: пирамида и конусы (CullMeshlets), затем окклюдеры в буфер глубины,
+// пирамида максимальной дальности и проверка боксов видимых мешлетов.
+//
+// Проверка (по умолчанию): все лицевые треугольники уровня 0 рисуются в буфер номеров
+// мешлетов в разрешении окна App (ref-size), а не буфера перекрытия: на том же грубом
+// разрешении эталон пропустил бы мешлеты, видные в щель уже пикселя буфера. Мешлет, прошедший
+// пирамиду и конусы и попавший в эталон хоть одним пикселем, не должен быть отсечён.
+// Нарушение - код возврата 1 (ctest occlusion_check).
+#include "MeshAsset.h"
+#include "OcclusionBuffer.h"
+#include "../shared/mesh_cache.h"
+#include "bench_camera.h"
+#include "synth_obj.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace {
+
+namespace fs = std::filesystem;
+using clock_type = std::chrono::steady_clock;
+
+double ms_since(clock_type::time_point t) {
+    return std::chrono::duration<double, std::milli>(clock_type::now() - t).count();
+}
+
+// ---- эталон: весь уровень 0 в буфер номеров мешлетов ----
+
+struct Reference {
+    int width, height;
+    std::vector<float> depth;       // 1/w
+    std::vector<uint32_t> id;
+};
+
+// те же правила, что в OcclusionBuffer (центр пикселя, сторона, плоскость 1/w), но скалярно
+// и в своём разрешении
+void reference_triangle(Reference& r, const float c[3][4], uint32_t id) {
+    float x[3], y[3], iw[3];
+    for (int k=0; k<3; k++) {
+        iw[k] = 1.f / c[k][3];
+        x[k] = (c[k][0] * iw[k] * 0.5f + 0.5f) * r.width;
+        y[k] = (0.5f - c[k][1] * iw[k] * 0.5f) * r.height;
+    }
+    float area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+    if (!(area > 1e-8f)) return;
+    int x0 = std::max(0, (int)std::min({x[0], x[1], x[2]})), x1 = std::min(r.width - 1, (int)std::max({x[0], x[1], x[2]}));
+    int y0 = std::max(0, (int)std::min({y[0], y[1], y[2]})), y1 = std::min(r.height - 1, (int)std::max({y[0], y[1], y[2]}));
+    for (int py=y0; py<=y1; py++)
+        for (int px=x0; px<=x1; px++) {
+            float sx = px + 0.5f, sy = py + 0.5f, e[3];
+            for (int k=0; k<3; k++) {
+                int a = (k+1) % 3, b = (k+2) % 3;
+                e[k] = ((x[b] - x[a]) * (sy - y[a]) - (y[b] - y[a]) * (sx - x[a])) / area;
+            }
+            if (e[0] < 0 || e[1] < 0 || e[2] < 0) continue;
+            float z = e[0]*iw[0] + e[1]*iw[1] + e[2]*iw[2];
+            size_t i = (size_t)py * r.width + px;
+            if (z > r.depth[i]) { r.depth[i] = z; r.id[i] = id; }
+        }
+}
+
+// обрезка по z клипа >= 0, как у окклюдеров
+void reference_clipped(Reference& r, const float c[3][4], uint32_t id) {
+    float out[4][4];
+    int n = 0;
+    for (int i=0; i<3; i++) {
+        const float* p = c[i];
+        const float* q = c[(i+1) % 3];
+        if (p[2] >= 0.f) std::copy(p, p + 4, out[n++]);
+        if ((p[2] >= 0.f) != (q[2] >= 0.f)) {
+            float t = p[2] / (p[2] - q[2]);
+            for (int j=0; j<4; j++) out[n][j] = p[j] + (q[j] - p[j]) * t;
+            n++;
+        }
+    }
+    if (n < 3) return;
+    const float first[3][4] = { { out[0][0], out[0][1], out[0][2], out[0][3] },
+                                { out[1][0], out[1][1], out[1][2], out[1][3] },
+                                { out[2][0], out[2][1], out[2][2], out[2][3] } };
+    reference_triangle(r, first, id);
+    if (n == 4) {
+        const float second[3][4] = { { out[0][0], out[0][1], out[0][2], out[0][3] },
+                                     { out[2][0], out[2][1], out[2][2], out[2][3] },
+                                     { out[3][0], out[3][1], out[3][2], out[3][3] } };
+        reference_triangle(r, second, id);
+    }
+}
+
+struct Stat {
+    double sum = 0, max = 0;
+    void add(double v) { sum += v; max = std::max(max, v); }
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int frames = 360, width = 256, height = 128, refWidth = 1280, refHeight = 720;
+    float radius = 5.f, phi = 1.35f;
+    bool check = true, keep = false;
+    fs::path obj;
+    for (int i=1; i<argc; i++) {
+        std::string a = argv[i];
+        auto next = [&]() -> const char* {
+            if (i + 1 >= argc) { std::fprintf(stderr, "%s: нет значения\n", a.c_str()); std::exit(2); }
+            return argv[++i];
+        };
+        if (a == "--frames") frames = std::max(1, std::atoi(next()));
+        else if (a == "--radius") radius = (float)std::atof(next());
+        else if (a == "--phi") phi = (float)std::atof(next());
+        else if (a == "--size") { if (std::sscanf(next(), "%dx%d", &width, &height) != 2) return 2; }
+        else if (a == "--ref-size") { if (std::sscanf(next(), "%dx%d", &refWidth, &refHeight) != 2) return 2; }
+        else if (a == "--no-check") check = false;
+        else if (a == "--keep") keep = true;
+        else if (!a.empty() && a[0] == '-') { std::fprintf(stderr, "неизвестный ключ %s\n", a.c_str()); return 2; }
+        else obj = a;
+    }
+
+    const bool synthetic = obj.empty();
+    if (synthetic) {
+        obj = fs::temp_directory_path() / "cg_occlusion_city.obj";
+        if (!synth::write_city(obj.string())) { std::perror(obj.string().c_str()); return 2; }
+    }
+
+    auto t = clock_type::now();
+    MeshAsset asset;
+    if (!BuildMeshAsset(obj, asset)) { std::fprintf(stderr, "%s: не прочитан\n", obj.string().c_str()); return 2; }
+    const double buildMs = ms_since(t);
+
+    // позиции уровня 0 по порядку буфера индексов - для эталона
+    std::vector<Float3> corner;
+    if (check) {
+        const uint32_t count = asset.lod.levels[0].count;
+        corner.resize(count);
+        for (uint32_t i=0; i<count; i++) {
+            const Submesh16 s = asset.submeshes.empty() ? Submesh16{} : asset.submeshes[FindSubmesh16(asset.submeshes, i)];
+            corner[i] = UnpackVertex(asset.vertices[asset.indices[i] + s.baseVertex], asset.quant).pos;
+        }
+    }
+
+    std::printf("mesh %s: %u triangles, %zu meshlets, %zu occluder triangles (error %g), build %.0f ms\n",
+                synthetic ? "city" : obj.string().c_str(), asset.lod.levels[0].count / 3,
+                asset.meshlets.meshlets.size(), asset.occluders.indices.size() / 3, asset.occluders.error, buildMs);
+
+    OcclusionBuffer buffer(width, height);
+    Reference ref{ std::max(1, refWidth), std::max(1, refHeight), {}, {} };
+    std::vector<uint32_t> visible;
+    Stat frustumMs, rasterMs, testMs;
+    size_t afterFrustum = 0, afterOcclusion = 0, trisFrustum = 0, trisOccluded = 0, drawn = 0;
+    int failures = 0;
+
+    for (int f=0; f<frames; f++) {
+        const float theta = 6.2831853f * f / frames;
+        const Float3 eye(radius * std::sin(phi) * std::cos(theta), radius * std::cos(phi),
+                         radius * std::sin(phi) * std::sin(theta));
+        const bench::Mat vp = bench::view_proj(eye, 0.25f * 3.14159265f, 16.f / 9.f, 0.1f, 1000.f);
+
+        t = clock_type::now();
+        MeshletCullStats st;
+        CullMeshlets(asset.meshlets, FrustumFromViewProj(vp.m), eye, visible, &st);
+        frustumMs.add(ms_since(t));
+        afterFrustum += visible.size();
+        trisFrustum += st.triangles - st.frustumCulled - st.backfaceCulled;
+        const std::vector<uint32_t> before = visible;
+
+        t = clock_type::now();
+        buffer.Begin(vp.m);
+        drawn += buffer.Rasterize(asset.occluders);
+        buffer.Finish();
+        rasterMs.add(ms_since(t));
+
+        t = clock_type::now();
+        trisOccluded += RemoveOccludedMeshlets(asset.meshlets, buffer, visible);
+        testMs.add(ms_since(t));
+        afterOcclusion += visible.size();
+
+        if (!check) continue;
+        ref.depth.assign((size_t)ref.width * ref.height, 0.f);
+        ref.id.assign(ref.depth.size(), ~0u);
+        for (uint32_t m=0; m<asset.meshlets.meshlets.size(); m++) {
+            const Meshlet& ml = asset.meshlets.meshlets[m];
+            for (uint32_t k=0; k<ml.triangleCount; k++) {
+                float c[3][4];
+                for (int j=0; j<3; j++) {
+                    const Float3& p = corner[asset.meshlets.FirstIndex(ml) + k*3 + j];
+                    for (int q=0; q<4; q++) c[j][q] = p.x*vp.m[q] + p.y*vp.m[4 + q] + p.z*vp.m[8 + q] + vp.m[12 + q];
+                }
+                reference_clipped(ref, c, m);
+            }
+        }
+        std::vector<uint32_t> seen(ref.id);
+        std::sort(seen.begin(), seen.end());
+        seen.erase(std::unique(seen.begin(), seen.end()), seen.end());
+        for (uint32_t m : seen) {
+            if (m == ~0u || !std::binary_search(before.begin(), before.end(), m) ||
+                std::binary_search(visible.begin(), visible.end(), m)) continue;
+            if (failures++ < 10) std::printf("  frame %d: meshlet %u visible in reference but culled\n", f, m);
+        }
+    }
+
+    std::printf("buffer %dx%d, %d frames, %zu occluder triangles drawn per frame\n",
+                buffer.Width(), buffer.Height(), frames, drawn / frames);
+    std::printf("  meshlets after frustum/cone %.1f, after occlusion %.1f (triangles %.0f -> %.0f)\n",
+                (double)afterFrustum / frames, (double)afterOcclusion / frames,
+                (double)trisFrustum / frames, (double)(trisFrustum - trisOccluded) / frames);
+    std::printf("  ms per frame avg/max: frustum %.3f/%.3f, occluders %.3f/%.3f, boxes %.3f/%.3f\n",
+                frustumMs.sum / frames, frustumMs.max, rasterMs.sum / frames, rasterMs.max,
+                testMs.sum / frames, testMs.max);
+    if (check) std::printf("  reference check at %dx%d: %s (%d false occlusions)\n",
+                           ref.width, ref.height, failures ? "FAILED" : "ok", failures);
+
+    if (synthetic && !keep) {
+        std::error_code ec;
+        fs::remove(obj, ec);
+        fs::remove(meshcache::cache_path(obj, "cg4"), ec);
+        fs::remove(meshlod::cache_path(obj), ec);
+    }
+    return failures ? 1 : 0;
+}
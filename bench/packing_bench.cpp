@@ -0,0 +1,145 @@
+// Проверка упаковки вершин CG4 (VertexPacking): unorm16 позиции и октаэдрические нормали 2x16 бит.
+//
+//   packing_bench [--samples 1000000]
+//
+// Позиции: случайные точки бокса с сильно разными сторонами, его углы и плоский меш (размах 0
+// по одной оси). Ошибка по каждой оси не больше половины шага квантования extent / 65535.
+// Нормали: случайные направления на сфере, оси, диагонали октантов, шов z = 0 и окрестность -z.
+// Угол после кодирования не больше kMaxNormalDegrees, декодированная нормаль единичная,
+// оси кодируются точно. MeasureQuantizeError сообщает то же расстояние и укладывается в тот же угол.
+// Нарушение - код возврата 1 (ctest packing_check).
+#include "VertexPacking.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// шаг сетки октаэдра 1/32767 по u, v: до ~0.007 градуса там, где развёртка сильнее всего растянута
+constexpr double kMaxNormalDegrees = 0.01;
+constexpr double kRadToDeg = 57.29577951308232;
+
+int g_failures = 0;
+
+void expect(bool ok, const char* what) {
+    std::printf("  %-60s %s\n", what, ok ? "ok" : "FAILED");
+    if (!ok) g_failures++;
+}
+
+// угол между векторами в градусах; через хорду, acos у единицы теряет точность
+double angle_degrees(const Float3& a, const Float3& b) {
+    const double la = std::sqrt((double)a.x*a.x + (double)a.y*a.y + (double)a.z*a.z);
+    const double lb = std::sqrt((double)b.x*b.x + (double)b.y*b.y + (double)b.z*b.z);
+    const double dx = a.x/la - b.x/lb, dy = a.y/la - b.y/lb, dz = a.z/la - b.z/lb;
+    return 2.0 * std::asin(std::min(1.0, std::sqrt(dx*dx + dy*dy + dz*dz) * 0.5)) * kRadToDeg;
+}
+
+void check_positions(const char* name, const std::vector<MeshVertex>& v, const Float3& lo, const Float3& hi) {
+    const QuantizeBounds b = MakeQuantizeBounds(lo, hi);
+    const std::vector<PackedVertex> packed = PackVertices(v.data(), v.size(), b);
+    const float ext[3] = { hi.x - lo.x, hi.y - lo.y, hi.z - lo.z };
+    double worstSteps = 0, worst = 0, worstDist = 0;
+    bool ok = true;
+    for (size_t i=0; i<v.size(); i++) {
+        const MeshVertex u = UnpackVertex(packed[i], b);
+        const float in[3] = { v[i].pos.x, v[i].pos.y, v[i].pos.z }, out[3] = { u.pos.x, u.pos.y, u.pos.z };
+        double dist = 0;
+        for (int a=0; a<3; a++) {
+            const double err = std::fabs((double)out[a] - in[a]);
+            // половина шага плюс округление float самой координаты
+            const double limit = 0.5 * ext[a] / 65535.0 + 2.0 * std::ldexp(std::fabs(in[a]) + std::fabs(ext[a]), -24);
+            if (err > limit) ok = false;
+            worst = std::max(worst, err);
+            if (ext[a] > 0) worstSteps = std::max(worstSteps, err / (ext[a] / 65535.0));
+            dist += err * err;
+        }
+        worstDist = std::max(worstDist, std::sqrt(dist));
+    }
+    const QuantizeError q = MeasureQuantizeError(v.data(), packed.data(), v.size(), b);
+    std::printf("%s: %zu positions, max error per axis %.3g (%.3f steps), distance %.3g, "
+                "MeasureQuantizeError %.3g\n", name, v.size(), worst, worstSteps, worstDist, q.maxPosition);
+    expect(ok, "every axis within half a quantization step");
+    // MeasureQuantizeError считает расстояние во float
+    expect(std::fabs(q.maxPosition - worstDist) <= 1e-5 * worstDist + 1e-12, "MeasureQuantizeError agrees");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t samples = 1000000;
+    for (int i=1; i<argc; i++) {
+        std::string a = argv[i];
+        if (a == "--samples" && i + 1 < argc) samples = (size_t)std::max(1, std::atoi(argv[++i]));
+        else { std::fprintf(stderr, "неизвестный ключ %s\n", a.c_str()); return 2; }
+    }
+
+    std::mt19937 rng(12345);
+
+    // ---- позиции ----
+    {
+        const Float3 lo(-3.f, 0.f, -100.f), hi(7.f, 0.001f, 100.f);
+        std::uniform_real_distribution<float> ux(lo.x, hi.x), uy(lo.y, hi.y), uz(lo.z, hi.z);
+        std::vector<MeshVertex> v(samples);
+        for (MeshVertex& p : v) p.pos = Float3(ux(rng), uy(rng), uz(rng));
+        for (int c=0; c<8; c++)
+            v.push_back({ Float3(c & 1 ? hi.x : lo.x, c & 2 ? hi.y : lo.y, c & 4 ? hi.z : lo.z), Float3(0, 1, 0) });
+        check_positions("box 10 x 0.001 x 200", v, lo, hi);
+
+        // плоский меш: по y размах 0, позиция должна вернуться точно
+        for (MeshVertex& p : v) p.pos.y = 2.5f;
+        check_positions("flat y = 2.5", v, Float3(lo.x, 2.5f, lo.z), Float3(hi.x, 2.5f, hi.z));
+    }
+
+    // ---- нормали ----
+    {
+        std::vector<Float3> n;
+        std::normal_distribution<float> g;
+        for (size_t i=0; i<samples; i++) {
+            Float3 d(g(rng), g(rng), g(rng));
+            if (d.x == 0 && d.y == 0 && d.z == 0) d.z = 1;
+            n.push_back(d);
+        }
+        const Float3 axes[6] = { {1,0,0}, {-1,0,0}, {0,1,0}, {0,-1,0}, {0,0,1}, {0,0,-1} };
+        for (const Float3& a : axes) n.push_back(a);
+        for (int c=0; c<8; c++) n.push_back(Float3(c & 1 ? 1.f : -1.f, c & 2 ? 1.f : -1.f, c & 4 ? 1.f : -1.f));
+        for (int i=0; i<3600; i++) {        // шов развёртки z = 0 и окрестность -z
+            const float t = 6.2831853f * i / 3600;
+            n.push_back(Float3(std::cos(t), std::sin(t), 0.f));
+            n.push_back(Float3(1e-3f * std::cos(t), 1e-3f * std::sin(t), -1.f));
+            n.push_back(Float3(std::cos(t), std::sin(t), -1e-4f));
+        }
+
+        double worst = 0, worstLen = 0;
+        bool axesExact = true;
+        std::vector<MeshVertex> v(n.size());
+        for (size_t i=0; i<n.size(); i++) {
+            int16_t e[2];
+            EncodeOctahedral(n[i], e);
+            const Float3 d = DecodeOctahedral(e);
+            worst = std::max(worst, angle_degrees(n[i], d));
+            worstLen = std::max(worstLen, std::fabs(std::sqrt((double)d.x*d.x + (double)d.y*d.y + (double)d.z*d.z) - 1.0));
+            if (i >= samples && i < samples + 6)
+                axesExact = axesExact && d.x == n[i].x && d.y == n[i].y && d.z == n[i].z;
+            const double l = std::sqrt((double)n[i].x*n[i].x + (double)n[i].y*n[i].y + (double)n[i].z*n[i].z);
+            v[i].normal = Float3((float)(n[i].x / l), (float)(n[i].y / l), (float)(n[i].z / l));
+        }
+        const QuantizeBounds b = MakeQuantizeBounds(Float3(0, 0, 0), Float3(1, 1, 1));
+        const std::vector<PackedVertex> packed = PackVertices(v.data(), v.size(), b);
+        const QuantizeError q = MeasureQuantizeError(v.data(), packed.data(), v.size(), b);
+
+        std::printf("octahedral: %zu normals, max error %.5f deg (limit %.3f), max |len - 1| %.2g, "
+                    "MeasureQuantizeError %.5f deg\n", n.size(), worst, kMaxNormalDegrees, worstLen, q.maxNormalDegrees);
+        expect(worst <= kMaxNormalDegrees, "angle after round trip within limit");
+        expect(worstLen <= 1e-6, "decoded normals are unit length");
+        expect(axesExact, "axes round-trip exactly");
+        expect(q.maxNormalDegrees <= kMaxNormalDegrees, "MeasureQuantizeError within limit");
+    }
+
+    std::printf("%s\n", g_failures ? "FAILED" : "all checks ok");
+    return g_failures ? 1 : 0;
+}
@@ -0,0 +1,144 @@
+// Проверка разрезания на 16-битные подмеши CG4 (SplitMesh16) без DirectX.
+//
+//   submesh_bench [--grid 400] [obj ...]
+//
+// Меши: синтетическая сетка (grid+1)^2 вершин (по умолчанию 160k, больше 65535) в исходном
+// порядке и с перемешанными треугольниками - тогда окна слишком разрежены и подмеши собираются
+// из копий вершин; каждый OBJ из аргументов (ParseObj, без кэша) - с лимитом по умолчанию
+// и с лимитом 256 вершин, чтобы резался и маленький меш вроде головы CG3.
+//
+// Для каждого случая:
+//   - отсортированное мультимножество треугольников (три вершины целиком) совпадает до и после;
+//   - подмеши идут подряд и покрывают весь буфер, в каждом меньше 65536 вершин;
+//   - каждый индекс помещается в 16 бит, не равен 0xFFFF и меньше vertexCount своего подмеша;
+//   - FindSubmesh16 находит подмеш каждого индекса.
+// Нарушение - код возврата 1 (ctest submesh_split_check).
+#include "ObjParser.h"
+#include "SubmeshSplitter.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Triangle = std::array<MeshVertex, 3>;
+
+bool less(const Triangle& a, const Triangle& b) { return std::memcmp(a.data(), b.data(), sizeof(Triangle)) < 0; }
+bool same(const Triangle& a, const Triangle& b) { return std::memcmp(a.data(), b.data(), sizeof(Triangle)) == 0; }
+
+std::vector<Triangle> sorted_triangles(const std::vector<MeshVertex>& v, const std::vector<uint32_t>& idx) {
+    std::vector<Triangle> t(idx.size() / 3);
+    for (size_t i=0; i<t.size(); i++)
+        t[i] = { v[idx[i*3]], v[idx[i*3 + 1]], v[idx[i*3 + 2]] };
+    std::sort(t.begin(), t.end(), less);
+    return t;
+}
+
+// false и причина в stdout - разрезание неверно
+bool check(const char* name, std::vector<MeshVertex> vertices, const std::vector<uint32_t>& indices,
+           uint32_t maxVertices) {
+    const std::vector<Triangle> before = sorted_triangles(vertices, indices);
+    const size_t inputVertices = vertices.size();
+
+    const auto t0 = std::chrono::steady_clock::now();
+    SplitMesh16Result r = SplitMesh16(vertices, indices.data(), indices.size(), maxVertices);
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+    int errors = 0;
+    auto fail = [&](const char* what, size_t at) {
+        if (errors++ < 10) std::printf("  %s: %s at %zu\n", name, what, at);
+    };
+
+    if (r.indices.size() != indices.size()) fail("index count differs", r.indices.size());
+    if (vertices.size() != inputVertices + r.duplicatedVertices) fail("vertex count differs from duplicates", vertices.size());
+
+    // подмеши подряд, вершины каждого помещаются в 16 бит и в массив
+    std::vector<uint32_t> global(indices.size());
+    size_t next = 0, largest = 0;
+    for (size_t s=0; s<r.submeshes.size(); s++) {
+        const Submesh16& sm = r.submeshes[s];
+        if (sm.firstIndex != next || sm.indexCount % 3) fail("submesh range", s);
+        if (sm.vertexCount >= 65536 || sm.vertexCount > maxVertices) fail("submesh vertex count", s);
+        if (sm.baseVertex < 0 || (size_t)sm.baseVertex + sm.vertexCount > vertices.size()) fail("submesh base vertex", s);
+        largest = std::max<size_t>(largest, sm.vertexCount);
+        for (uint32_t i=sm.firstIndex; i<sm.firstIndex + sm.indexCount && i < r.indices.size(); i++) {
+            const uint32_t local = r.indices[i];
+            if (local == 0xFFFF || local >= sm.vertexCount) { fail("index out of submesh", i); continue; }
+            if (FindSubmesh16(r.submeshes, i) != s) fail("FindSubmesh16", i);
+            global[i] = (uint32_t)(sm.baseVertex + (int32_t)local);
+        }
+        next = sm.firstIndex + sm.indexCount;
+    }
+    if (next != indices.size()) fail("submeshes do not cover the buffer", next);
+
+    if (!errors) {
+        const std::vector<Triangle> after = sorted_triangles(vertices, global);
+        for (size_t i=0; i<before.size(); i++)
+            if (!same(before[i], after[i])) { fail("triangle multiset differs", i); break; }
+    }
+
+    std::printf("%-18s %8zu verts %8zu tris -> %5zu submeshes (largest %zu verts), %zu duplicated, %.2f ms: %s\n",
+                name, inputVertices, indices.size() / 3, r.submeshes.size(), largest, r.duplicatedVertices, ms,
+                errors ? "FAILED" : "ok");
+    return errors == 0;
+}
+
+void make_grid(int n, std::vector<MeshVertex>& v, std::vector<uint32_t>& idx) {
+    v.resize((size_t)(n + 1) * (n + 1));
+    for (int y=0; y<=n; y++)
+        for (int x=0; x<=n; x++) {
+            MeshVertex& p = v[(size_t)y * (n + 1) + x];
+            p.pos = Float3((float)x, (float)((x * 7 + y * 13) % 5) * 0.1f, (float)y);
+            p.normal = Float3(0, 1, 0);
+        }
+    idx.clear();
+    for (int y=0; y<n; y++)
+        for (int x=0; x<n; x++) {
+            const uint32_t a = (uint32_t)(y * (n + 1) + x), b = a + 1, c = a + n + 1, d = c + 1;
+            idx.insert(idx.end(), { a, c, b, b, c, d });
+        }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int grid = 400;
+    std::vector<std::string> files;
+    for (int i=1; i<argc; i++) {
+        std::string a = argv[i];
+        if (a == "--grid" && i + 1 < argc) grid = std::max(1, std::atoi(argv[++i]));
+        else if (!a.empty() && a[0] == '-') { std::fprintf(stderr, "неизвестный ключ %s\n", a.c_str()); return 2; }
+        else files.push_back(a);
+    }
+
+    bool ok = true;
+    std::vector<MeshVertex> v;
+    std::vector<uint32_t> idx;
+    make_grid(grid, v, idx);
+    ok &= check("grid", v, idx, 65535);
+
+    // треугольники вразброс: окно почти всегда шире лимита, подмеши из копий
+    std::vector<uint32_t> tri(idx.size() / 3);
+    for (uint32_t i=0; i<tri.size(); i++) tri[i] = i;
+    std::shuffle(tri.begin(), tri.end(), std::mt19937(12345));
+    std::vector<uint32_t> shuffled(idx.size());
+    for (size_t i=0; i<tri.size(); i++)
+        std::copy_n(&idx[(size_t)tri[i] * 3], 3, &shuffled[i * 3]);
+    ok &= check("grid shuffled", v, shuffled, 65535);
+
+    for (const std::string& path : files) {
+        ObjParseResult parsed;
+        if (!ParseObj(path, parsed)) { std::fprintf(stderr, "%s: не прочитан\n", path.c_str()); return 2; }
+        const std::string name = path.substr(path.find_last_of("/\\") + 1);
+        ok &= check(name.c_str(), parsed.vertices, parsed.indices, 65535);
+        ok &= check((name + " /256").c_str(), parsed.vertices, parsed.indices, 256);
+    }
+    return ok ? 0 : 1;
+}
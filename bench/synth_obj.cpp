@@ -0,0 +1,174 @@
+#include "synth_obj.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace synth {
+
+namespace {
+
+struct FormName { Form form; const char* name; };
+const FormName kForms[] = {
+    { Form::V, "v" }, { Form::VT, "v/vt" }, { Form::VN, "v//vn" }, { Form::VTN, "v/vt/vn" },
+    { Form::Quad, "quad" }, { Form::Negative, "negative" },
+};
+
+// буферизованная запись без printf: генерация 50M треугольников упирается в диск, а не в формат
+class Writer {
+public:
+    explicit Writer(FILE* f) : f_(f) { buf_.resize(1 << 20); }
+    ~Writer() { flush(); }
+
+    void put(char c) { reserve(1); buf_[n_++] = c; }
+    void put(std::string_view s) { reserve(s.size()); for (char c : s) buf_[n_++] = c; }
+    void num(long long v) {
+        reserve(24);
+        n_ = (size_t)(std::to_chars(buf_.data() + n_, buf_.data() + buf_.size(), v).ptr - buf_.data());
+    }
+    void num(float v) {
+        reserve(32);
+        n_ = (size_t)(std::to_chars(buf_.data() + n_, buf_.data() + buf_.size(), v).ptr - buf_.data());
+    }
+    void flush() {
+        if (n_) { bytes_ += std::fwrite(buf_.data(), 1, n_, f_); n_ = 0; }
+    }
+    uint64_t bytes() { flush(); return bytes_; }
+
+private:
+    void reserve(size_t k) { if (n_ + k > buf_.size()) flush(); }
+
+    FILE* f_;
+    std::vector<char> buf_;
+    size_t n_ = 0;
+    uint64_t bytes_ = 0;
+};
+
+// детерминированный шум высоты
+float noise(uint64_t i) {
+    i ^= i >> 33; i *= 0xff51afd7ed558ccdull; i ^= i >> 33;
+    return (float)(i & 0xFFFF) / 65535.0f;
+}
+
+} // namespace
+
+const char* form_name(Form f) {
+    for (auto& n : kForms) if (n.form == f) return n.name;
+    return "?";
+}
+
+bool parse_form(std::string_view name, Form& out) {
+    for (auto& n : kForms) if (name == n.name) { out = n.form; return true; }
+    return false;
+}
+
+bool write_obj(const std::string& path, uint64_t triangles, Form form, Info& info) {
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+
+    const uint64_t quads = std::max<uint64_t>(1, (triangles + 1) / 2);
+    const uint64_t cols = std::max<uint64_t>(1, (uint64_t)std::ceil(std::sqrt((double)quads)));
+    const uint64_t rows = (quads + cols - 1) / cols;
+    const uint64_t nv = (rows + 1) * (cols + 1);
+    const bool uv = form != Form::V && form != Form::VN;
+    const bool nrm = form != Form::V && form != Form::VT;
+
+    Writer w(f);
+    w.put("# synthetic grid "); w.num((long long)rows); w.put(" x "); w.num((long long)cols); w.put("\n");
+    for (uint64_t r = 0; r <= rows; r++)
+        for (uint64_t c = 0; c <= cols; c++) {
+            w.put("v "); w.num((float)c * 0.01f);
+            w.put(' ');  w.num(noise(r * (cols + 1) + c) * 0.05f);
+            w.put(' ');  w.num((float)r * 0.01f);
+            w.put('\n');
+        }
+    if (uv)
+        for (uint64_t r = 0; r <= rows; r++)
+            for (uint64_t c = 0; c <= cols; c++) {
+                w.put("vt "); w.num((float)c / (float)cols);
+                w.put(' ');   w.num((float)r / (float)rows);
+                w.put('\n');
+            }
+    if (nrm)
+        for (uint64_t i = 0; i < nv; i++) {
+            w.put("vn "); w.num(noise(i * 7 + 1) * 0.2f - 0.1f);
+            w.put(" 1 "); w.num(noise(i * 7 + 2) * 0.2f - 0.1f);
+            w.put('\n');
+        }
+
+    auto corner = [&](uint64_t i) {
+        // все массивы записаны до граней: -1 - последний элемент
+        long long k = form == Form::Negative ? (long long)i - (long long)nv - 1 : (long long)i;
+        w.put(' ');
+        w.num(k);
+        if (uv || nrm) {
+            w.put('/');
+            if (uv) w.num(k);
+            if (nrm) { w.put('/'); w.num(k); }
+        }
+    };
+
+    for (uint64_t r = 0; r < rows; r++)
+        for (uint64_t c = 0; c < cols; c++) {
+            const uint64_t a = r * (cols + 1) + c + 1, b = a + 1, d = a + cols + 1, e = d + 1;
+            if (form == Form::Quad) {
+                w.put('f'); corner(a); corner(b); corner(e); corner(d); w.put('\n');
+            } else {
+                w.put('f'); corner(a); corner(b); corner(e); w.put('\n');
+                w.put('f'); corner(a); corner(e); corner(d); w.put('\n');
+            }
+        }
+
+    info.triangles = rows * cols * 2;
+    info.vertices = nv;
+    info.bytes = w.bytes();
+    return std::fclose(f) == 0;
+}
+
+bool write_city(const std::string& path, bool blockMaterials) {
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+    int nv = 0;
+    // прямоугольник a + u*i/n + v*j/n, разбитый на n x n клеток; bump - шум по y внутри
+    auto quad = [&](float ax, float ay, float az, float ux, float uy, float uz,
+                    float vx, float vy, float vz, int n, float bump = 0.f) {
+        const int base = nv + 1;
+        for (int j=0; j<=n; j++)
+            for (int i=0; i<=n; i++) {
+                float s = (float)i / n, t = (float)j / n;
+                float dy = i > 0 && i < n && j > 0 && j < n ? noise(nv + j*(n+1) + i) * bump : 0.f;
+                std::fprintf(f, "v %g %g %g\n", ax + ux*s + vx*t, ay + uy*s + vy*t + dy, az + uz*s + vz*t);
+            }
+        for (int j=0; j<n; j++)
+            for (int i=0; i<n; i++) {
+                int a = base + j*(n+1) + i, b = a + 1, c = a + n + 1, d = c + 1;
+                std::fprintf(f, "f %d %d %d\nf %d %d %d\n", a, c, b, b, c, d);
+            }
+        nv += (n+1) * (n+1);
+    };
+
+    if (blockMaterials) std::fprintf(f, "usemtl ground\n");
+    quad(-60, 0, -60, 120, 0, 0, 0, 0, 120, 32);       // земля
+    unsigned seed = 12345;
+    for (int gz=0; gz<12; gz++)
+        for (int gx=0; gx<12; gx++) {
+            float cx = -55.f + gx*10.f, cz = -55.f + gz*10.f;
+            seed = seed * 1664525u + 1013904223u;
+            float h = 8.f + (float)(seed >> 8 & 0xffff) / 65535.f * 22.f;
+            if (cx*cx + cz*cz < 20.f*20.f) continue;       // площадь
+            if (blockMaterials) std::fprintf(f, "usemtl block_%d_%d\n", gx, gz);
+            float x0 = cx - 3, x1 = cx + 3, z0 = cz - 3, z1 = cz + 3;
+            const int n = 10;
+            quad(x0, 0, z0, 6, 0, 0, 0, h, 0, n);
+            quad(x1, 0, z1, -6, 0, 0, 0, h, 0, n);
+            quad(x1, 0, z0, 0, 0, 6, 0, h, 0, n);
+            quad(x0, 0, z1, 0, 0, -6, 0, h, 0, n);
+            // с материалами крыши неровные: у упрощения крыш ненулевая ошибка, и уровень
+            // зависит от расстояния, а не только от плоскости
+            quad(x0, h, z0, 6, 0, 0, 0, 0, 6, n, blockMaterials ? 0.03f : 0.f);
+        }
+    return std::fclose(f) == 0;
+}
+
+} // namespace synth
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Синтетические OBJ для замеров: сетка rows x cols квадратов с шумом по высоте (загрузчики)
+// и город из коробок (отсечение мешлетов и перекрытых).
+namespace synth {
+
+// форма углов грани
+enum class Form {
+    V,          // f 1 2 3
+    VT,         // f 1/1 2/2 3/3
+    VN,         // f 1//1 2//2 3//3
+    VTN,        // f 1/1/1 2/2/2 3/3/3
+    Quad,       // четырёхугольники v/vt/vn, загрузчик режет веером
+    Negative,   // v/vt/vn с отрицательными (относительными) индексами
+};
+
+const char* form_name(Form f);
+bool parse_form(std::string_view name, Form& out);
+
+struct Info {
+    uint64_t triangles = 0;     // после триангуляции
+    uint64_t vertices = 0;
+    uint64_t bytes = 0;
+};
+
+// не меньше triangles треугольников; false - файл не записан
+bool write_obj(const std::string& path, uint64_t triangles, Form form, Info& info);
+
+// кварталы из разбитых на сетку коробок вокруг пустой площади радиуса 20, земля 120 x 120;
+// 134k треугольников, только v и f; blockMaterials - земля и каждая коробка под своим usemtl
+// (батчи CG4, как у Sponza). false - файл не записан
+bool write_city(const std::string& path, bool blockMaterials = false);
+
+} // namespace synth
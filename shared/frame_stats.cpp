@@ -0,0 +1,102 @@
+#include "frame_stats.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+namespace framestats {
+
+Collector::Collector(const Params& params) {
+    ring_.assign(std::max<size_t>(1, params.window), 0.0);
+    hist_.assign(std::max<size_t>(1, params.bins), 0);
+    binMs_ = params.binMs > 0.0 ? params.binMs : 0.5;
+    invBinMs_ = 1.0 / binMs_;
+    lastBin_ = (double)(hist_.size() - 1);
+}
+
+void Collector::clear() {
+    std::fill(hist_.begin(), hist_.end(), 0u);
+    head_ = 0;
+    count_ = 0;
+    total_ = 0;
+}
+
+std::vector<double> Collector::samples() const {
+    std::vector<double> out(count_);
+    const size_t first = (head_ + ring_.size() - count_) % ring_.size();
+    for (size_t i=0; i<count_; i++) out[i] = ring_[(first + i) % ring_.size()];
+    return out;
+}
+
+Summary Collector::summary() const {
+    Summary s;
+    s.count = count_;
+    s.total = total_;
+    if (count_ == 0) return s;
+
+    std::vector<double> v(ring_.begin(), ring_.begin() + count_);   // порядок не важен
+    double sum = 0;
+    for (double ms : v) sum += ms;
+    s.avgMs = sum / (double)count_;
+
+    // ранги по возрастанию: каждый nth_element сужает диапазон для следующего и может
+    // переставить элемент на предыдущем ранге, поэтому значение читается сразу
+    auto rank = [&](double p) { return (size_t)std::max(1.0, std::ceil(p * (double)count_)) - 1; };
+    const size_t r50 = rank(0.50), r95 = rank(0.95), r99 = rank(0.99);
+    std::nth_element(v.begin(), v.begin() + r50, v.end());
+    s.p50Ms = v[r50];
+    s.minMs = *std::min_element(v.begin(), v.begin() + r50 + 1);
+    std::nth_element(v.begin() + r50, v.begin() + r95, v.end());
+    s.p95Ms = v[r95];
+    std::nth_element(v.begin() + r95, v.begin() + r99, v.end());
+    s.p99Ms = v[r99];
+    s.maxMs = *std::max_element(v.begin() + r99, v.end());
+    return s;
+}
+
+bool Collector::write_csv(const std::string& path) const {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) return false;
+    char line[64];
+    out << "frame,ms\n";
+    const std::vector<double> v = samples();
+    const uint64_t first = total_ - v.size();
+    for (size_t i=0; i<v.size(); i++) {
+        std::snprintf(line, sizeof(line), "%llu,%.4f\n", (unsigned long long)(first + i), v[i]);
+        out << line;
+    }
+    return (bool)out;
+}
+
+bool Collector::write_json(const std::string& path) const {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) return false;
+    const Summary s = summary();
+    char buf[512];
+    std::snprintf(buf, sizeof(buf),
+        "{\n  \"frames\": %llu,\n  \"window\": %zu,\n"
+        "  \"min_ms\": %.4f,\n  \"avg_ms\": %.4f,\n  \"max_ms\": %.4f,\n"
+        "  \"p50_ms\": %.4f,\n  \"p95_ms\": %.4f,\n  \"p99_ms\": %.4f,\n"
+        "  \"bin_ms\": %.4f,\n  \"histogram\": [",
+        (unsigned long long)s.total, s.count, s.minMs, s.avgMs, s.maxMs,
+        s.p50Ms, s.p95Ms, s.p99Ms, binMs_);
+    out << buf;
+    for (size_t i=0; i<hist_.size(); i++) out << (i ? ", " : "") << hist_[i];
+    out << "],\n  \"samples_ms\": [";
+    const std::vector<double> v = samples();
+    for (size_t i=0; i<v.size(); i++) {
+        std::snprintf(buf, sizeof(buf), "%s%.4f", i ? ", " : "", v[i]);
+        out << buf;
+    }
+    out << "]\n}\n";
+    return (bool)out;
+}
+
+std::string format(const Summary& s) {
+    char buf[160];
+    std::snprintf(buf, sizeof(buf), "avg %.2f ms (%.1f fps) p50 %.2f p95 %.2f p99 %.2f min %.2f max %.2f",
+                  s.avgMs, s.avgMs > 0 ? 1000.0 / s.avgMs : 0.0, s.p50Ms, s.p95Ms, s.p99Ms, s.minMs, s.maxMs);
+    return buf;
+}
+
+} // namespace framestats
@@ -0,0 +1,74 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Статистика времени кадра, общая для CG3 и CG4: скользящее окно последних кадров,
+// min/avg/max, перцентили, гистограмма и выгрузка в CSV/JSON.
+// add() только пишет в кольцо и сдвигает два счётчика гистограммы - около 3 нс (frame_stats_bench);
+// сортировка для перцентилей делается при запросе сводки, а не на каждом кадре.
+namespace framestats {
+
+struct Params {
+    size_t window = 1024;           // кадров в окне
+    double binMs = 0.5;             // ширина корзины гистограммы
+    size_t bins = 100;              // последняя корзина собирает всё, что длиннее
+};
+
+struct Summary {
+    size_t   count = 0;             // кадров в окне
+    uint64_t total = 0;             // кадров с начала
+    double minMs = 0, avgMs = 0, maxMs = 0;
+    double p50Ms = 0, p95Ms = 0, p99Ms = 0;
+};
+
+class Collector {
+public:
+    explicit Collector(const Params& params = {});
+
+    void add(double seconds) {
+        const double ms = seconds * 1000.0;
+        if (count_ == ring_.size()) hist_[bin(ring_[head_])]--;
+        else count_++;
+        ring_[head_] = ms;
+        hist_[bin(ms)]++;
+        head_ = head_ + 1 == ring_.size() ? 0 : head_ + 1;
+        total_++;
+    }
+    void clear();
+
+    // перцентиль - ближайший ранг: p99 - время, которого не превысили 99% кадров окна
+    Summary summary() const;
+    // кадры окна от старого к новому, мс
+    std::vector<double> samples() const;
+    const std::vector<uint32_t>& histogram() const { return hist_; }
+    double bin_ms() const { return binMs_; }
+    size_t count() const { return count_; }
+    uint64_t total() const { return total_; }
+
+    // CSV: frame,ms по кадрам окна; JSON: сводка, гистограмма и кадры окна
+    bool write_csv(const std::string& path) const;
+    bool write_json(const std::string& path) const;
+
+private:
+    size_t bin(double ms) const {
+        const double b = ms * invBinMs_;
+        if (!(b > 0.0)) return 0;   // и NaN
+        return b < lastBin_ ? (size_t)b : (size_t)lastBin_;
+    }
+
+    std::vector<double> ring_;
+    std::vector<uint32_t> hist_;
+    size_t head_ = 0;               // куда пишется следующий кадр
+    size_t count_ = 0;
+    uint64_t total_ = 0;
+    double binMs_ = 0.5;
+    double invBinMs_ = 2.0;
+    double lastBin_ = 0;
+};
+
+// "avg 16.67 ms (60.0 fps) p50 16.5 p95 18.1 p99 25.3 min 15.9 max 33.0" - для консоли и заголовка окна
+std::string format(const Summary& s);
+
+} // namespace framestats
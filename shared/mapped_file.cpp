@@ -0,0 +1,78 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// для пустого файла отображать нечего, отдаём пустой буфер
+static const char kEmpty[1] = {0};
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::filesystem::path& path) {
+    close();
+    HANDLE f = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                           OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (f == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER sz{};
+    if (!GetFileSizeEx(f, &sz)) { CloseHandle(f); return false; }
+    file_ = f;
+    size_ = (size_t)sz.QuadPart;
+    if (size_ == 0) { data_ = kEmpty; return true; }
+
+    HANDLE m = CreateFileMappingA(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m) { close(); return false; }
+    mapping_ = m;
+
+    data_ = (const char*)MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+    if (!data_) { close(); return false; }
+    return true;
+}
+
+void MappedFile::close() {
+    if (data_ && data_ != kEmpty) UnmapViewOfFile(data_);
+    if (mapping_) CloseHandle((HANDLE)mapping_);
+    if (file_) CloseHandle((HANDLE)file_);
+    data_ = nullptr; mapping_ = nullptr; file_ = nullptr;
+    size_ = 0;
+}
+
+#else
+
+bool MappedFile::open(const std::filesystem::path& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0) { ::close(fd); return false; }
+    fd_ = fd;
+    size_ = (size_t)st.st_size;
+    if (size_ == 0) { data_ = kEmpty; return true; }
+
+    void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) { close(); return false; }
+    data_ = (const char*)p;
+    return true;
+}
+
+void MappedFile::close() {
+    if (data_ && data_ != kEmpty) munmap((void*)data_, size_);
+    if (fd_ >= 0) ::close(fd_);
+    data_ = nullptr; fd_ = -1;
+    size_ = 0;
+}
+
+#endif
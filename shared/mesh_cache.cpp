@@ -0,0 +1,160 @@
+#include "mesh_cache.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <system_error>
+
+namespace meshcache {
+
+uint32_t vertex_stride(uint32_t format) {
+    uint32_t s = 0;
+    if (format & Position) s += 12;
+    if (format & Normal)   s += 12;
+    if (format & TexCoord) s += 8;
+    return s;
+}
+
+int attribute_offset(uint32_t format, VertexFormat attr) {
+    if (!(format & attr)) return -1;
+    int off = 0;
+    if (attr == Position) return off;
+    if (format & Position) off += 12;
+    if (attr == Normal) return off;
+    if (format & Normal) off += 12;
+    return off;
+}
+
+static uint64_t fnv1a(uint64_t h, const char* p, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        h ^= (uint8_t)p[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+bool stamp_source(const std::filesystem::path& src, SourceStamp& out) {
+    std::error_code ec;
+    auto mt = std::filesystem::last_write_time(src, ec);
+    if (ec) return false;
+
+    MappedFile f;
+    if (!f.open(src)) return false;
+
+    // полный хэш стоил бы столько же, сколько чтение OBJ; берём три блока по 64 КБ,
+    // остальное ловят размер и mtime
+    const size_t block = 64*1024;
+    size_t n = f.size();
+    uint64_t h = 14695981039346656037ull;
+    if (n <= 3*block) {
+        h = fnv1a(h, f.data(), n);
+    } else {
+        h = fnv1a(h, f.data(), block);
+        h = fnv1a(h, f.data() + n/2 - block/2, block);
+        h = fnv1a(h, f.data() + n - block, block);
+    }
+
+    out.size = n;
+    out.mtime = (int64_t)mt.time_since_epoch().count();
+    out.hash = h;
+    return true;
+}
+
+std::filesystem::path cache_path(const std::filesystem::path& src, const char* tag) {
+    std::filesystem::path p = src;
+    p += ".";
+    p += tag;
+    p += ".cgmb";
+    return p;
+}
+
+static uint64_t align_up(uint64_t v) { return (v + kAlign - 1) / kAlign * kAlign; }
+
+bool write(const std::filesystem::path& path, const SourceStamp& src, uint32_t vertexFormat,
+           const float bboxMin[3], const float bboxMax[3], const StreamData* streams, int count) {
+    if (count > kMaxStreams) return false;
+
+    Header h{};
+    std::memcpy(h.magic, "CGMB", 4);
+    h.version = kVersion;
+    h.vertexFormat = vertexFormat;
+    h.streamCount = (uint32_t)count;
+    h.source = src;
+    for (int i = 0; i < 3; i++) { h.bboxMin[i] = bboxMin[i]; h.bboxMax[i] = bboxMax[i]; }
+
+    uint64_t off = sizeof(Header);
+    for (int i = 0; i < count; i++) {
+        Stream& s = h.streams[i];
+        s.kind = (uint32_t)streams[i].kind;
+        s.stride = streams[i].stride;
+        s.count = streams[i].count;
+        s.offset = off;
+        off = align_up(off + s.stride * s.count);
+    }
+
+    // своё имя у каждого писателя: процессы, одновременно строящие кэш одного OBJ
+    // (воркеры sort-first), иначе пишут в один .tmp и переименовывают чужой недописанный
+    static std::atomic<uint32_t> seq{0};
+    const uint32_t salt = std::random_device{}() ^ (uint32_t)std::chrono::steady_clock::now().time_since_epoch().count();
+    std::filesystem::path tmp = path;
+    tmp += ".";
+    tmp += std::to_string(salt);
+    tmp += ".";
+    tmp += std::to_string(seq++);
+    tmp += ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+
+        static const char zeros[kAlign] = {};
+        out.write((const char*)&h, sizeof(h));
+        uint64_t pos = sizeof(h);
+        for (int i = 0; i < count; i++) {
+            const Stream& s = h.streams[i];
+            out.write(zeros, (std::streamsize)(s.offset - pos));
+            out.write((const char*)streams[i].data, (std::streamsize)(s.stride * s.count));
+            pos = s.offset + s.stride * s.count;
+        }
+        out.write(zeros, (std::streamsize)(off - pos));
+        if (!out) { out.close(); std::error_code ec; std::filesystem::remove(tmp, ec); return false; }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) { std::filesystem::remove(tmp, ec); return false; }
+    return true;
+}
+
+bool Reader::open(const std::filesystem::path& path, const SourceStamp& expected) {
+    close();
+    if (!file_.open(path)) return false;
+    if (file_.size() < sizeof(Header)) { close(); return false; }
+
+    const Header* h = (const Header*)file_.data();
+    if (std::memcmp(h->magic, "CGMB", 4) != 0 || h->version != kVersion ||
+        h->streamCount > (uint32_t)kMaxStreams || !(h->source == expected)) {
+        close();
+        return false;
+    }
+    for (uint32_t i = 0; i < h->streamCount; i++) {
+        const Stream& s = h->streams[i];
+        if (s.offset % kAlign != 0 || s.offset > file_.size() ||
+            s.count > (file_.size() - s.offset) / (s.stride ? s.stride : 1)) {
+            close();
+            return false;
+        }
+    }
+    header_ = h;
+    return true;
+}
+
+const Stream* Reader::stream(StreamKind kind) const {
+    if (!header_) return nullptr;
+    for (uint32_t i = 0; i < header_->streamCount; i++)
+        if (header_->streams[i].kind == (uint32_t)kind) return &header_->streams[i];
+    return nullptr;
+}
+
+} // namespace meshcache
@@ -0,0 +1,103 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include "mapped_file.h"
+
+// Двоичный кэш меша CGMB, общий для CG3 и CG4.
+// Заголовок, bbox и таблица потоков; каждый поток выровнен на 64 байта,
+// поэтому после отображения файла данные используются как есть, без разбора.
+// Кэш лежит рядом с OBJ (<obj>.<программа>.cgmb) и годен, пока у OBJ совпадают размер, mtime и хэш.
+// Раскладка потоков у CG3 и CG4 разная (CG3 - свои индексы у uv и нормалей, CG4 - сваренные
+// вершины с нормалями), поэтому у каждой программы свой файл и они не перезаписывают друг друга.
+namespace meshcache {
+
+constexpr uint32_t kVersion = 4;
+constexpr uint32_t kAlign = 64;
+constexpr int kMaxStreams = 8;
+
+// состав вершины в потоке Vertices, атрибуты идут подряд в этом порядке
+enum VertexFormat : uint32_t {
+    Position = 1,   // float3
+    Normal   = 2,   // float3
+    TexCoord = 4,   // float2
+};
+
+uint32_t vertex_stride(uint32_t format);
+// смещение атрибута внутри вершины, -1 если его нет
+int attribute_offset(uint32_t format, VertexFormat attr);
+
+enum class StreamKind : uint32_t {
+    None = 0,
+    Vertices,       // вершины по vertexFormat
+    Indices,        // uint32, по 3 на треугольник
+    TexCoords,      // float2, отдельный массив uv (CG3: свой индекс у uv)
+    TexIndices,     // uint32, по 3 на треугольник в TexCoords
+    Normals,        // float3, отдельный массив нормалей
+    NormalIndices,  // uint32, по 3 на треугольник в Normals
+    LodLevels,      // meshlod::Level {first, count, error}, уровни поверх Indices
+    Materials,      // char, строки "mtllib"/"usemtl" (objmat::Usage::serialize)
+    Batches,        // objmat::Batch {material, first, count}, грани сгруппированы по материалам
+    LodGroups,      // meshlod::Level, диапазоны групп на каждом уровне LOD
+};
+
+struct Stream {
+    uint32_t kind = 0;
+    uint32_t stride = 0;
+    uint64_t count = 0;
+    uint64_t offset = 0;    // от начала файла, кратно kAlign
+};
+
+// отпечаток исходного OBJ
+struct SourceStamp {
+    uint64_t size = 0;
+    int64_t  mtime = 0;
+    uint64_t hash = 0;      // FNV-1a по началу, середине и концу файла
+
+    bool operator==(const SourceStamp& o) const { return size == o.size && mtime == o.mtime && hash == o.hash; }
+};
+
+struct Header {
+    char     magic[4];      // "CGMB"
+    uint32_t version;
+    uint32_t vertexFormat;
+    uint32_t streamCount;
+    SourceStamp source;
+    float    bboxMin[3];
+    float    bboxMax[3];
+    Stream   streams[kMaxStreams];
+};
+static_assert(sizeof(Header) % kAlign == 0, "header must keep streams aligned");
+
+bool stamp_source(const std::filesystem::path& src, SourceStamp& out);
+// tag - программа-владелец раскладки: "cg3", "cg4"
+std::filesystem::path cache_path(const std::filesystem::path& src, const char* tag);
+
+// описание потока для записи
+struct StreamData {
+    StreamKind kind;
+    uint32_t stride;
+    uint64_t count;
+    const void* data;
+};
+
+// пишет во временный файл и переименовывает, чтобы недописанный кэш не был прочитан
+bool write(const std::filesystem::path& path, const SourceStamp& src, uint32_t vertexFormat,
+           const float bboxMin[3], const float bboxMax[3], const StreamData* streams, int count);
+
+// отображённый кэш; open() проверяет формат, границы потоков и отпечаток источника
+class Reader {
+public:
+    bool open(const std::filesystem::path& path, const SourceStamp& expected);
+    void close() { file_.close(); header_ = nullptr; }
+
+    const Header& header() const { return *header_; }
+    const Stream* stream(StreamKind kind) const;
+    const void* data(const Stream& s) const { return file_.data() + s.offset; }
+
+private:
+    MappedFile file_;
+    const Header* header_ = nullptr;
+};
+
+} // namespace meshcache
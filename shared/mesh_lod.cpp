@@ -0,0 +1,409 @@
+#include "mesh_lod.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <queue>
+
+namespace meshlod {
+
+namespace {
+
+struct Vec3 { double x, y, z; };
+
+Vec3 sub(const Vec3& a, const Vec3& b) { return { a.x-b.x, a.y-b.y, a.z-b.z }; }
+Vec3 cross(const Vec3& a, const Vec3& b) { return { a.y*b.z-a.z*b.y, a.z*b.x-a.x*b.z, a.x*b.y-a.y*b.x }; }
+double dot(const Vec3& a, const Vec3& b) { return a.x*b.x + a.y*b.y + a.z*b.z; }
+
+// симметричная 4x4: xx xy xz xw yy yz yw zz zw ww; w - суммарная площадь плоскостей
+struct Quadric {
+    double m[10] = {};
+    double w = 0;
+
+    void add_plane(const Vec3& n, double d, double area) {
+        double p[4] = { n.x, n.y, n.z, d };
+        int k = 0;
+        for (int i=0; i<4; i++)
+            for (int j=i; j<4; j++) m[k++] += area * p[i] * p[j];
+        w += area;
+    }
+    void add(const Quadric& q) {
+        for (int i=0; i<10; i++) m[i] += q.m[i];
+        w += q.w;
+    }
+    double eval(const Vec3& p) const {
+        return m[0]*p.x*p.x + 2*m[1]*p.x*p.y + 2*m[2]*p.x*p.z + 2*m[3]*p.x
+             + m[4]*p.y*p.y + 2*m[5]*p.y*p.z + 2*m[6]*p.y
+             + m[7]*p.z*p.z + 2*m[8]*p.z
+             + m[9];
+    }
+};
+
+struct Candidate {
+    float cost;
+    uint32_t u, v;          // u схлопывается в v
+    uint32_t verU, verV;
+    bool operator>(const Candidate& o) const { return cost > o.cost; }
+};
+
+class Simplifier {
+public:
+    Simplifier(const float* positions, size_t stride, size_t vertexCount,
+               const uint32_t* indices, size_t indexCount)
+        : nv_(vertexCount), idx_(indices, indices + indexCount) {
+        pos_.resize(nv_);
+        for (size_t i=0; i<nv_; i++) {
+            const float* p = (const float*)((const char*)positions + i*stride);
+            pos_[i] = { p[0], p[1], p[2] };
+        }
+        nf_ = idx_.size() / 3;
+        alive_.assign(nf_, 1);
+        live_ = nf_;
+        dead_.assign(nv_, 0);
+        version_.assign(nv_, 0);
+
+        // битые и вырожденные треугольники сразу выбрасываем
+        for (size_t f=0; f<nf_; f++) {
+            uint32_t a = idx_[f*3], b = idx_[f*3+1], c = idx_[f*3+2];
+            if (a >= nv_ || b >= nv_ || c >= nv_ || a == b || b == c || a == c) { alive_[f] = 0; live_--; }
+        }
+
+        lock_borders_and_seams();
+        build_adjacency();
+        build_quadrics();
+    }
+
+    size_t live() const { return live_; }
+    float max_error() const { return maxErr_; }
+
+    void snapshot(std::vector<uint32_t>& out) const {
+        for (size_t f=0; f<nf_; f++)
+            if (alive_[f]) out.insert(out.end(), { idx_[f*3], idx_[f*3+1], idx_[f*3+2] });
+    }
+
+    void seed() {
+        for (size_t f=0; f<nf_; f++) {
+            if (!alive_[f]) continue;
+            for (int e=0; e<3; e++) {
+                uint32_t a = idx_[f*3+e], b = idx_[f*3+(e+1)%3];
+                push(a, b);
+                push(b, a);
+            }
+        }
+    }
+
+    // схлопывает рёбра, пока живых треугольников больше target; false - кандидаты кончились
+    bool run(size_t target) {
+        while (live_ > target) {
+            if (heap_.empty()) return false;
+            Candidate c = heap_.top();
+            heap_.pop();
+            if (dead_[c.u] || dead_[c.v]) continue;
+            if (c.verU != version_[c.u] || c.verV != version_[c.v]) { push(c.u, c.v); continue; }
+            if (!collapse(c.u, c.v)) continue;
+            maxErr_ = std::max(maxErr_, c.cost);
+        }
+        return true;
+    }
+
+private:
+    void lock_borders_and_seams() {
+        locked_.assign(nv_, 0);
+
+        // сварка по точной позиции: вершины шва делят позицию, но не атрибуты
+        std::vector<uint32_t> order(nv_);
+        for (size_t i=0; i<nv_; i++) order[i] = (uint32_t)i;
+        auto less = [&](uint32_t a, uint32_t b) {
+            const Vec3& p = pos_[a]; const Vec3& q = pos_[b];
+            if (p.x != q.x) return p.x < q.x;
+            if (p.y != q.y) return p.y < q.y;
+            return p.z < q.z;
+        };
+        std::sort(order.begin(), order.end(), less);
+        std::vector<uint32_t> group(nv_);
+        for (size_t i=0, g=0; i<nv_; i++) {
+            if (i > 0 && less(order[i-1], order[i])) g++;
+            group[order[i]] = (uint32_t)g;
+            if (i > 0 && !less(order[i-1], order[i])) { locked_[order[i]] = 1; locked_[order[i-1]] = 1; }
+        }
+
+        // граница: ребро (по сваренным вершинам) ровно у одного треугольника; больше двух - неманифолд
+        std::vector<uint64_t> edges;
+        edges.reserve(live_*3);
+        for (size_t f=0; f<nf_; f++) {
+            if (!alive_[f]) continue;
+            for (int e=0; e<3; e++) {
+                uint32_t a = group[idx_[f*3+e]], b = group[idx_[f*3+(e+1)%3]];
+                if (a > b) std::swap(a, b);
+                edges.push_back((uint64_t)a << 32 | b);
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        std::vector<uint8_t> lockGroup(nv_, 0);
+        for (size_t i=0; i<edges.size(); ) {
+            size_t j = i;
+            while (j < edges.size() && edges[j] == edges[i]) j++;
+            if (j - i != 2) { lockGroup[edges[i] >> 32] = 1; lockGroup[edges[i] & 0xffffffffu] = 1; }
+            i = j;
+        }
+        for (size_t i=0; i<nv_; i++) if (lockGroup[group[i]]) locked_[i] = 1;
+    }
+
+    void build_adjacency() {
+        faces_.assign(nv_, {});
+        for (size_t f=0; f<nf_; f++) {
+            if (!alive_[f]) continue;
+            for (int e=0; e<3; e++) faces_[idx_[f*3+e]].push_back((uint32_t)f);
+        }
+    }
+
+    void build_quadrics() {
+        q_.assign(nv_, Quadric{});
+        for (size_t f=0; f<nf_; f++) {
+            if (!alive_[f]) continue;
+            const Vec3& a = pos_[idx_[f*3]];
+            Vec3 n = cross(sub(pos_[idx_[f*3+1]], a), sub(pos_[idx_[f*3+2]], a));
+            double len = std::sqrt(dot(n, n));
+            if (len <= 0) continue;
+            n = { n.x/len, n.y/len, n.z/len };
+            double d = -dot(n, a);
+            Quadric fq;
+            fq.add_plane(n, d, len * 0.5);
+            for (int e=0; e<3; e++) q_[idx_[f*3+e]].add(fq);
+        }
+    }
+
+    float cost(uint32_t u, uint32_t v) const {
+        Quadric q = q_[u];
+        q.add(q_[v]);
+        double e = q.eval(pos_[v]);
+        return (float)std::sqrt(std::max(0.0, e) / std::max(q.w, 1e-30));
+    }
+
+    void push(uint32_t u, uint32_t v) {
+        if (locked_[u] || u == v) return;
+        heap_.push(Candidate{ cost(u, v), u, v, version_[u], version_[v] });
+    }
+
+    bool collapse(uint32_t u, uint32_t v) {
+        // ребро ещё существует и ни один треугольник вокруг u не перевернётся
+        bool adjacent = false;
+        for (uint32_t f : faces_[u]) {
+            if (!alive_[f]) continue;
+            uint32_t* t = &idx_[f*3];
+            if (t[0] == v || t[1] == v || t[2] == v) { adjacent = true; continue; }
+
+            Vec3 p[3], r[3];
+            for (int k=0; k<3; k++) { p[k] = pos_[t[k]]; r[k] = t[k] == u ? pos_[v] : p[k]; }
+            Vec3 n0 = cross(sub(p[1], p[0]), sub(p[2], p[0]));
+            Vec3 n1 = cross(sub(r[1], r[0]), sub(r[2], r[0]));
+            if (dot(n0, n1) <= 0.2 * std::sqrt(dot(n0, n0) * dot(n1, n1))) return false;
+        }
+        if (!adjacent) return false;
+
+        for (uint32_t f : faces_[u]) {
+            if (!alive_[f]) continue;
+            uint32_t* t = &idx_[f*3];
+            if (t[0] == v || t[1] == v || t[2] == v) { alive_[f] = 0; live_--; continue; }
+            for (int k=0; k<3; k++) if (t[k] == u) t[k] = v;
+            faces_[v].push_back(f);
+        }
+        dead_[u] = 1;
+        faces_[u].clear();
+        faces_[u].shrink_to_fit();
+        q_[v].add(q_[u]);
+        version_[v]++;
+
+        // список v без мёртвых и повторов; новые кандидаты по рёбрам вокруг v
+        auto& fv = faces_[v];
+        std::sort(fv.begin(), fv.end());
+        fv.erase(std::unique(fv.begin(), fv.end()), fv.end());
+        fv.erase(std::remove_if(fv.begin(), fv.end(), [&](uint32_t f) { return !alive_[f]; }), fv.end());
+        for (uint32_t f : fv) {
+            for (int k=0; k<3; k++) {
+                uint32_t w = idx_[f*3+k];
+                if (w == v) continue;
+                push(v, w);
+                push(w, v);
+            }
+        }
+        return true;
+    }
+
+    size_t nv_ = 0, nf_ = 0, live_ = 0;
+    std::vector<Vec3> pos_;
+    std::vector<uint32_t> idx_;
+    std::vector<uint8_t> alive_, dead_, locked_;
+    std::vector<uint32_t> version_;
+    std::vector<std::vector<uint32_t>> faces_;
+    std::vector<Quadric> q_;
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> heap_;
+    float maxErr_ = 0;
+};
+
+} // namespace
+
+Chain build_chain(const float* positions, size_t stride, size_t vertexCount,
+                  const uint32_t* indices, size_t indexCount, const Params& params) {
+    Chain chain;
+    chain.indices.assign(indices, indices + indexCount);
+    chain.levels.push_back(Level{ 0, (uint32_t)indexCount, 0.f });
+
+    Simplifier s(positions, stride, vertexCount, indices, indexCount);
+    s.seed();
+
+    size_t prev = indexCount / 3;
+    while ((int)chain.levels.size() < params.maxLevels && !params.stop.stop_requested()) {
+        size_t target = (size_t)(prev * params.ratio);
+        if (target < params.minTriangles) break;
+
+        bool reached = s.run(target);
+        // застряли на замках и переворотах: уровень, почти равный предыдущему, не нужен
+        if (s.live() > prev * 0.9) break;
+
+        Level l;
+        l.first = (uint32_t)chain.indices.size();
+        s.snapshot(chain.indices);
+        l.count = (uint32_t)chain.indices.size() - l.first;
+        l.error = s.max_error();
+        chain.levels.push_back(l);
+        prev = s.live();
+        if (!reached) break;
+    }
+    return chain;
+}
+
+Chain build_chain(const float* positions, size_t stride, size_t vertexCount,
+                  const uint32_t* indices, size_t indexCount,
+                  const std::vector<uint32_t>& groupStarts, const Params& params) {
+    const size_t ng = groupStarts.size();
+    std::vector<Chain> parts(ng);
+    size_t nl = 0;
+    for (size_t g=0; g<ng; g++) {
+        size_t begin = groupStarts[g];
+        size_t end = g+1 < ng ? groupStarts[g+1] : indexCount;
+        parts[g] = build_chain(positions, stride, vertexCount, indices + begin, end - begin, params);
+        nl = std::max(nl, parts[g].levels.size());
+        if (params.stop.stop_requested()) return Chain{};
+    }
+
+    Chain chain;
+    for (size_t l=0; l<nl; l++) {
+        Level lv{ (uint32_t)chain.indices.size(), 0, 0.f };
+        for (const Chain& p : parts) {
+            const Level& src = p.levels[std::min(l, p.levels.size() - 1)];
+            chain.groups.push_back(Level{ (uint32_t)chain.indices.size(), src.count, src.error });
+            chain.indices.insert(chain.indices.end(), p.indices.begin() + src.first,
+                                 p.indices.begin() + src.first + src.count);
+            lv.error = std::max(lv.error, src.error);
+        }
+        lv.count = (uint32_t)chain.indices.size() - lv.first;
+        chain.levels.push_back(lv);
+    }
+    return chain;
+}
+
+float projected_radius(float radius, float distance, float fovY, float viewportHeight) {
+    if (distance <= radius) return viewportHeight;
+    return radius * viewportHeight / (2.f * std::tan(fovY * 0.5f) * distance);
+}
+
+int select_level(const Chain& chain, float radius, float distance,
+                 float fovY, float viewportHeight, float maxPixelError) {
+    if (distance <= radius || chain.levels.empty()) return 0;
+    float pxPerUnit = viewportHeight / (2.f * std::tan(fovY * 0.5f) * distance);
+    for (int i=(int)chain.levels.size()-1; i>0; i--)
+        if (chain.levels[i].error * pxPerUnit <= maxPixelError) return i;
+    return 0;
+}
+
+std::vector<Bounds> group_bounds(const Chain& chain, const float* positions, size_t stride) {
+    std::vector<Bounds> out;
+    if (chain.levels.empty()) return out;
+    const size_t ng = chain.groups.empty() ? 1 : chain.groups.size() / chain.levels.size();
+    out.resize(ng);
+    for (size_t g=0; g<ng; g++) {
+        const Level& range = chain.groups.empty() ? chain.levels[0] : chain.groups[g];
+        Bounds& b = out[g];
+        for (int k=0; k<3; k++) { b.min[k] = HUGE_VALF; b.max[k] = -HUGE_VALF; }
+        for (uint32_t i=range.first; i<range.first + range.count; i++) {
+            const float* p = (const float*)((const char*)positions + chain.indices[i] * stride);
+            for (int k=0; k<3; k++) {
+                b.min[k] = std::min(b.min[k], p[k]);
+                b.max[k] = std::max(b.max[k], p[k]);
+            }
+        }
+        if (range.count == 0) b = Bounds{};
+    }
+    return out;
+}
+
+float distance_to(const Bounds& box, const float point[3]) {
+    float d2 = 0.f;
+    for (int k=0; k<3; k++) {
+        float d = std::max(std::max(box.min[k] - point[k], point[k] - box.max[k]), 0.f);
+        d2 += d*d;
+    }
+    return std::sqrt(d2);
+}
+
+int select_group_level(const Chain& chain, size_t group, const Bounds& box, const float eye[3],
+                       float fovY, float viewportHeight, float maxPixelError) {
+    const float distance = distance_to(box, eye);
+    if (distance <= 0.f || chain.levels.empty()) return 0;
+    const size_t ng = chain.groups.empty() ? 1 : chain.groups.size() / chain.levels.size();
+    float pxPerUnit = viewportHeight / (2.f * std::tan(fovY * 0.5f) * distance);
+    for (int i=(int)chain.levels.size()-1; i>0; i--) {
+        const Level& lv = chain.groups.empty() ? chain.levels[i] : chain.groups[i*ng + group];
+        if (lv.error * pxPerUnit <= maxPixelError) return i;
+    }
+    return 0;
+}
+
+std::filesystem::path cache_path(const std::filesystem::path& src) {
+    std::filesystem::path p = src;
+    p += ".lod.cgmb";
+    return p;
+}
+
+bool save(const std::filesystem::path& path, const meshcache::SourceStamp& stamp, const Chain& chain) {
+    using namespace meshcache;
+    static_assert(sizeof(Level) == 12, "Level is stored as is");
+    const float zero[3] = { 0, 0, 0 };
+    const StreamData streams[] = {
+        { StreamKind::Indices,   sizeof(uint32_t), chain.indices.size(), chain.indices.data() },
+        { StreamKind::LodLevels, sizeof(Level),    chain.levels.size(),  chain.levels.data() },
+        { StreamKind::LodGroups, sizeof(Level),    chain.groups.size(),  chain.groups.data() },
+    };
+    return write(path, stamp, 0, zero, zero, streams, chain.groups.empty() ? 2 : 3);
+}
+
+bool load(const std::filesystem::path& path, const meshcache::SourceStamp& stamp, Chain& chain) {
+    using namespace meshcache;
+    Reader r;
+    if (!r.open(path, stamp)) return false;
+    const Stream* is = r.stream(StreamKind::Indices);
+    const Stream* ls = r.stream(StreamKind::LodLevels);
+    if (!is || !ls || is->stride != sizeof(uint32_t) || ls->stride != sizeof(Level) || ls->count == 0) return false;
+
+    const uint32_t* idx = (const uint32_t*)r.data(*is);
+    const Level* lv = (const Level*)r.data(*ls);
+    for (uint64_t i=0; i<ls->count; i++)
+        if (lv[i].count % 3 || (uint64_t)lv[i].first + lv[i].count > is->count) return false;
+
+    const Stream* gs = r.stream(StreamKind::LodGroups);
+    const Level* gv = nullptr;
+    if (gs) {
+        if (gs->stride != sizeof(Level) || gs->count % ls->count) return false;
+        gv = (const Level*)r.data(*gs);
+        for (uint64_t i=0; i<gs->count; i++)
+            if (gv[i].count % 3 || (uint64_t)gv[i].first + gv[i].count > is->count) return false;
+    }
+
+    chain.indices.assign(idx, idx + is->count);
+    chain.levels.assign(lv, lv + ls->count);
+    if (gv) chain.groups.assign(gv, gv + gs->count);
+    else    chain.groups.clear();
+    return true;
+}
+
+} // namespace meshlod
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <stop_token>
+#include <vector>
+#include "mesh_cache.h"
+
+// Упрощение меша по квадрикам ошибки (Garland-Heckbert) и цепочка LOD.
+// Схлопывание ребра u->v переносит u в позицию v, поэтому новых вершин нет:
+// все уровни - разные индексные буферы над одним и тем же массивом вершин.
+// Вершины на границе и на швах атрибутов (одна позиция, разные uv/нормали) не двигаются,
+// чтобы не рвать поверхность.
+namespace meshlod {
+
+struct Level {
+    uint32_t first = 0;     // начало в Chain::indices
+    uint32_t count = 0;     // индексов, по 3 на треугольник
+    float    error = 0;     // граница геометрической ошибки в единицах модели
+};
+
+struct Chain {
+    std::vector<uint32_t> indices;  // уровни подряд, уровень 0 - исходный меш
+    std::vector<Level> levels;
+    // только у цепочки по группам: groups[l * G + g] - диапазон группы g на уровне l
+    std::vector<Level> groups;
+};
+
+struct Params {
+    float    ratio = 0.5f;          // доля треугольников следующего уровня
+    int      maxLevels = 6;
+    uint32_t minTriangles = 64;
+    // запрос остановки проверяется перед каждым уровнем; остановленная цепочка неполная,
+    // у цепочки по группам - пустая
+    std::stop_token stop;
+};
+
+// positions - float3 с шагом stride байт
+Chain build_chain(const float* positions, size_t stride, size_t vertexCount,
+                  const uint32_t* indices, size_t indexCount, const Params& params = {});
+
+// Группы (например, материалы) упрощаются по отдельности: треугольники разных групп
+// не смешиваются, граница группы - край и не двигается. groupStarts - начала групп в indices
+// по возрастанию, первая с 0. Уровень l - уровни l всех групп подряд; группа, у которой
+// уровни кончились, повторяет последний. Ошибка уровня - наибольшая по группам.
+Chain build_chain(const float* positions, size_t stride, size_t vertexCount,
+                  const uint32_t* indices, size_t indexCount,
+                  const std::vector<uint32_t>& groupStarts, const Params& params = {});
+
+// Экранный выбор: самый грубый уровень, ошибка которого на экране не больше maxPixelError.
+// Проекция ошибки та же, что у ограничивающей сферы: px = err * viewportHeight / (2 tan(fovY/2) * distance).
+// Внутри сферы (distance <= radius) - всегда уровень 0.
+int select_level(const Chain& chain, float radius, float distance,
+                 float fovY, float viewportHeight, float maxPixelError = 1.f);
+
+// ограничивающий бокс группы в единицах позиций
+struct Bounds {
+    float min[3] = { 0.f, 0.f, 0.f };
+    float max[3] = { 0.f, 0.f, 0.f };
+};
+
+// боксы групп по их треугольникам уровня 0; у цепочки без групп - один бокс.
+// positions - те же вершины, что и у build_chain, chain.indices ещё не очищен
+std::vector<Bounds> group_bounds(const Chain& chain, const float* positions, size_t stride);
+
+// расстояние от точки до бокса, внутри - 0
+float distance_to(const Bounds& box, const float point[3]);
+
+// Выбор для группы g по её собственным ошибкам и расстоянию от глаза до её бокса:
+// дальние группы большой сцены грубеют, даже когда камера внутри сцены.
+// Глаз внутри бокса - уровень 0.
+int select_group_level(const Chain& chain, size_t group, const Bounds& box, const float eye[3],
+                       float fovY, float viewportHeight, float maxPixelError = 1.f);
+
+// радиус сферы в пикселях, для отчётов
+float projected_radius(float radius, float distance, float fovY, float viewportHeight);
+
+// цепочка в кэше CGMB рядом с OBJ (<obj>.lod.cgmb), тот же отпечаток источника
+std::filesystem::path cache_path(const std::filesystem::path& src);
+bool save(const std::filesystem::path& path, const meshcache::SourceStamp& stamp, const Chain& chain);
+bool load(const std::filesystem::path& path, const meshcache::SourceStamp& stamp, Chain& chain);
+
+} // namespace meshlod
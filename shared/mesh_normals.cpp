@@ -0,0 +1,169 @@
+#include "mesh_normals.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+namespace meshnormals {
+
+namespace {
+
+struct V3 { float x = 0, y = 0, z = 0; };
+
+V3 sub(const V3& a, const V3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+V3 cross(const V3& a, const V3& b) { return { a.y*b.z - a.z*b.y, a.z*b.x - a.x*b.z, a.x*b.y - a.y*b.x }; }
+float dot(const V3& a, const V3& b) { return a.x*b.x + a.y*b.y + a.z*b.z; }
+
+// atan2(y, x) при y >= 0, полином на [0, 1] с ошибкой ~1e-5 рад: для веса угла хватает,
+// а std::atan2 втрое дороже всего остального в первом проходе
+float angle(float y, float x) {
+    const float ax = std::fabs(x);
+    const bool swap = ax > y;
+    const float z = swap ? y / ax : (y > 0.f ? ax / y : 0.f);
+    const float z2 = z * z;
+    float a = z * (0.99997726f + z2*(-0.33262347f + z2*(0.19354346f + z2*(-0.11643287f + z2*(0.05265332f - 0.01172120f*z2)))));
+    a = swap ? a : 1.57079633f - a;       // угол от оси x в [0, pi/2]
+    return x < 0.f ? 3.14159265f - a : a;
+}
+
+template <class I>
+Result generate_impl(const float* positions, size_t stride, size_t vertexCount,
+                     const I* indices, size_t indexCount, const Params& params) {
+    Result r;
+    const size_t F = indexCount / 3;
+    const size_t C = F * 3;
+    r.corner.assign(C, 0);
+    if (F == 0 || vertexCount == 0) return r;
+
+    int threads = params.threads > 0 ? params.threads : (int)std::max(1u, std::thread::hardware_concurrency());
+    threads = std::clamp(threads, 1, (int)std::max<size_t>(1, F / 4096));
+    auto range = [&](size_t n, int t, size_t& b, size_t& e) {
+        b = n * t / threads;
+        e = n * (t+1) / threads;
+    };
+
+    auto vid = [&](size_t c) -> size_t {
+        long long i = (long long)indices[c];
+        return i < 0 || (size_t)i >= vertexCount ? SIZE_MAX : (size_t)i;
+    };
+    auto pos = [&](size_t v) {
+        const float* p = (const float*)((const char*)positions + v * stride);
+        return V3{ p[0], p[1], p[2] };
+    };
+
+    // 1. единичная нормаль грани и вес угла: площадь * угол при вершине (через atan2, точнее acos)
+    std::vector<V3> faceN(F);
+    std::vector<float> weight(C, 0.f);
+    parallel::run_threads(threads, [&](int t) {
+        size_t b, e; range(F, t, b, e);
+        for (size_t f=b; f<e; f++) {
+            size_t v[3] = { vid(f*3), vid(f*3 + 1), vid(f*3 + 2) };
+            if (v[0] == SIZE_MAX || v[1] == SIZE_MAX || v[2] == SIZE_MAX) continue;
+            V3 p[3] = { pos(v[0]), pos(v[1]), pos(v[2]) };
+            V3 n = cross(sub(p[1], p[0]), sub(p[2], p[0]));
+            float len = std::sqrt(dot(n, n));
+            if (!(len > 0.f)) continue;
+            faceN[f] = { n.x/len, n.y/len, n.z/len };
+            for (int k=0; k<3; k++) {
+                float d = dot(sub(p[(k+1)%3], p[k]), sub(p[(k+2)%3], p[k]));
+                weight[f*3 + k] = 0.5f * len * angle(len, d);
+            }
+        }
+    });
+
+    // 2. углы каждой вершины по возрастанию номера
+    std::vector<uint32_t> start(vertexCount + 1, 0);
+    for (size_t c=0; c<C; c++) if (size_t v = vid(c); v != SIZE_MAX) start[v + 1]++;
+    for (size_t v=0; v<vertexCount; v++) start[v + 1] += start[v];
+    std::vector<uint32_t> corners(start[vertexCount]);
+    {
+        std::vector<uint32_t> fill(start.begin(), start.end() - 1);
+        for (size_t c=0; c<C; c++) if (size_t v = vid(c); v != SIZE_MAX) corners[fill[v]++] = (uint32_t)c;
+    }
+
+    // 3. нормаль каждого угла, одинаковые внутри вершины сливаются.
+    // Вершины делятся между потоками поровну по числу углов
+    const float cosCrease = params.creaseDegrees >= 180.f ? -2.f
+                          : std::cos(params.creaseDegrees * 3.14159265358979f / 180.f);
+    std::vector<V3> unique(corners.size());         // нормали вершины v с позиции start[v]
+    std::vector<uint32_t> uniqueCount(vertexCount, 0);
+    std::vector<uint32_t> local(corners.size());    // номер нормали угла внутри вершины
+    std::vector<size_t> vbegin(threads + 1, vertexCount);
+    vbegin[0] = 0;
+    for (int t=1; t<threads; t++) {
+        uint32_t target = (uint32_t)((uint64_t)corners.size() * t / threads);
+        vbegin[t] = (size_t)(std::upper_bound(start.begin(), start.end(), target) - start.begin()) - 1;
+        vbegin[t] = std::max(vbegin[t], vbegin[t-1]);
+    }
+    parallel::run_threads(threads, [&](int t) {
+        std::vector<V3> fn;         // грани вершины подряд: в общем массиве они вразброс
+        std::vector<float> w;
+        for (size_t v=vbegin[t]; v<vbegin[t+1]; v++) {
+            const uint32_t b = start[v], d = start[v + 1] - b;
+            fn.resize(d);
+            w.resize(d);
+            bool smooth = true;
+            for (uint32_t i=0; i<d; i++) {
+                fn[i] = faceN[corners[b + i] / 3];
+                w[i] = weight[corners[b + i]];
+                for (uint32_t j=0; j<i && smooth; j++) smooth = dot(fn[i], fn[j]) >= cosCrease;
+            }
+
+            // нормаль угла i - сумма граней в пределах излома от его грани;
+            // у вырожденной грани своей нормали нет, ей достаются все грани вершины.
+            // Если излома у вершины нет, сумма у всех углов одна - считается один раз
+            uint32_t n = 0;
+            for (uint32_t i=0; i<d; i++) {
+                if (smooth && i > 0) { local[b + i] = 0; continue; }
+                const bool any = smooth || dot(fn[i], fn[i]) == 0.f;
+                V3 s;
+                for (uint32_t j=0; j<d; j++) {
+                    if (!any && dot(fn[j], fn[i]) < cosCrease) continue;
+                    s.x += fn[j].x * w[j]; s.y += fn[j].y * w[j]; s.z += fn[j].z * w[j];
+                }
+                float len = std::sqrt(dot(s, s));
+                s = len > 0.f ? V3{ s.x/len, s.y/len, s.z/len } : V3{ 0.f, 1.f, 0.f };
+
+                uint32_t k = 0;
+                while (k < n && std::memcmp(&unique[b + k], &s, sizeof(V3)) != 0) k++;
+                if (k == n) unique[b + n++] = s;
+                local[b + i] = k;
+            }
+            uniqueCount[v] = n;
+        }
+    });
+
+    // 4. сквозные номера: по вершинам, внутри вершины - по первому углу
+    std::vector<uint32_t> base(vertexCount + 1, 0);
+    for (size_t v=0; v<vertexCount; v++) base[v + 1] = base[v] + uniqueCount[v];
+    const size_t total = base[vertexCount];
+    r.normals.resize(total * 3);
+    r.vertex.resize(total);
+    parallel::run_threads(threads, [&](int t) {
+        for (size_t v=vbegin[t]; v<vbegin[t+1]; v++) {
+            for (uint32_t k=0; k<uniqueCount[v]; k++) {
+                const V3& n = unique[start[v] + k];
+                float* out = &r.normals[(size_t)(base[v] + k) * 3];
+                out[0] = n.x; out[1] = n.y; out[2] = n.z;
+                r.vertex[base[v] + k] = (uint32_t)v;
+            }
+            for (uint32_t i=start[v]; i<start[v + 1]; i++) r.corner[corners[i]] = base[v] + local[i];
+        }
+    });
+    return r;
+}
+
+} // namespace
+
+Result generate(const float* positions, size_t stride, size_t vertexCount,
+                const uint32_t* indices, size_t indexCount, const Params& params) {
+    return generate_impl(positions, stride, vertexCount, indices, indexCount, params);
+}
+
+Result generate(const float* positions, size_t stride, size_t vertexCount,
+                const int* indices, size_t indexCount, const Params& params) {
+    return generate_impl(positions, stride, vertexCount, indices, indexCount, params);
+}
+
+} // namespace meshnormals
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Гладкие нормали для мешей без vn, общие для CG3 и CG4.
+// Нормаль угла - сумма нормалей граней вершины с весом "площадь грани * угол при вершине";
+// в сумму входят только грани, отличающиеся от грани угла не больше чем на угол излома.
+// Одинаковые нормали одной вершины сливаются, поэтому на гладкой поверхности у вершины
+// одна нормаль, а на изломе - по одной на каждую сторону.
+namespace meshnormals {
+
+struct Params {
+    float creaseDegrees = 60.f;     // 180 и больше - без изломов
+    int   threads = 0;              // 0 - по числу ядер
+};
+
+struct Result {
+    std::vector<float> normals;     // xyz единичных нормалей
+    std::vector<uint32_t> vertex;   // вершина, которой принадлежит нормаль
+    std::vector<uint32_t> corner;   // номер нормали для каждого индекса
+    size_t count() const { return vertex.size(); }
+};
+
+// positions - float3 с шагом stride байт, индексы по 3 на треугольник и меньше vertexCount.
+// Нормали пронумерованы по вершинам, внутри вершины - по первому углу; результат
+// не зависит от числа потоков.
+Result generate(const float* positions, size_t stride, size_t vertexCount,
+                const uint32_t* indices, size_t indexCount, const Params& params = {});
+Result generate(const float* positions, size_t stride, size_t vertexCount,
+                const int* indices, size_t indexCount, const Params& params = {});
+
+} // namespace meshnormals
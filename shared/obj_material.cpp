@@ -0,0 +1,151 @@
+#include "obj_material.h"
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <numeric>
+
+namespace objmat {
+
+static std::string_view trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r')) s.remove_suffix(1);
+    return s;
+}
+
+// "tag rest" -> tag и rest без пробелов по краям
+static std::string_view split_tag(std::string_view line, std::string_view& rest) {
+    line = trim(line);
+    size_t sp = line.find_first_of(" \t");
+    if (sp == std::string_view::npos) { rest = {}; return line; }
+    rest = trim(line.substr(sp));
+    return line.substr(0, sp);
+}
+
+static void parse_floats(std::string_view s, float* out, int n) {
+    const char* p = s.data();
+    const char* e = p + s.size();
+    for (int i = 0; i < n; i++) {
+        while (p < e && (*p == ' ' || *p == '\t')) p++;
+        auto r = std::from_chars(p, e, out[i]);
+        if (r.ec != std::errc()) return;
+        p = r.ptr;
+    }
+}
+
+void Usage::add_lib(std::string_view file) {
+    if (std::find(libs.begin(), libs.end(), file) == libs.end()) libs.emplace_back(file);
+}
+
+uint32_t Usage::use(std::string_view name) {
+    auto it = std::find(names.begin(), names.end(), name);
+    if (it != names.end()) return (uint32_t)(it - names.begin());
+    names.emplace_back(name);
+    return (uint32_t)names.size() - 1;
+}
+
+std::string Usage::serialize() const {
+    std::string s;
+    for (auto& l : libs)  s += "mtllib " + l + "\n";
+    for (auto& n : names) s += "usemtl " + n + "\n";
+    return s;
+}
+
+Usage Usage::parse(std::string_view text) {
+    Usage u;
+    while (!text.empty()) {
+        size_t n = text.find('\n');
+        std::string_view line = text.substr(0, n);
+        text = n == std::string_view::npos ? std::string_view() : text.substr(n + 1);
+        std::string_view rest;
+        std::string_view tag = split_tag(line, rest);
+        if (tag == "mtllib") u.libs.emplace_back(rest);
+        // имя может быть пустым (грани до первого usemtl), поэтому без use()
+        else if (tag == "usemtl") u.names.emplace_back(rest);
+    }
+    return u;
+}
+
+bool load_mtl(const std::filesystem::path& path, std::vector<Material>& out) {
+    std::ifstream in(path);
+    if (!in) return false;
+
+    Material* m = nullptr;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::string_view rest;
+        std::string_view tag = split_tag(line, rest);
+        if (tag == "newmtl") {
+            out.emplace_back();
+            m = &out.back();
+            m->name = rest;
+        }
+        else if (!m) continue;
+        else if (tag == "Ka") parse_floats(rest, m->ambient, 3);
+        else if (tag == "Kd") parse_floats(rest, m->diffuse, 3);
+        else if (tag == "Ks") parse_floats(rest, m->specular, 3);
+        else if (tag == "Ns") parse_floats(rest, &m->shininess, 1);
+        else if (tag == "d")  parse_floats(rest, &m->opacity, 1);
+        else if (tag == "Tr") { float tr = 0; parse_floats(rest, &tr, 1); m->opacity = 1.f - tr; }
+        else if (tag == "map_Kd") {
+            // опции (-s, -o, ...) не поддерживаем: путь - последнее слово
+            size_t sp = rest.find_last_of(" \t");
+            m->diffuseMap = sp == std::string_view::npos ? rest : rest.substr(sp + 1);
+        }
+    }
+    return true;
+}
+
+std::vector<Material> resolve(const std::filesystem::path& objPath, const Usage& usage) {
+    std::vector<Material> lib;
+    const std::filesystem::path dir = objPath.parent_path();
+    for (auto& l : usage.libs) load_mtl(dir / l, lib);
+
+    std::vector<Material> out(usage.names.size());
+    for (size_t i = 0; i < usage.names.size(); i++) {
+        auto it = std::find_if(lib.begin(), lib.end(), [&](const Material& m) { return m.name == usage.names[i]; });
+        if (it != lib.end()) out[i] = *it;
+        out[i].name = usage.names[i];
+        // текстура рядом с OBJ, как и .mtl
+        if (!out[i].diffuseMap.empty()) out[i].diffuseMap = (dir / out[i].diffuseMap).string();
+    }
+    return out;
+}
+
+std::vector<Batch> group_faces(const std::vector<uint32_t>& faceMaterial,
+                               const std::vector<Material>& materials, std::vector<uint32_t>& order) {
+    const size_t nm = materials.size();
+
+    // порядок материалов: по текстуре, цвету и имени
+    std::vector<uint32_t> rank(nm);
+    {
+        std::vector<uint32_t> byState(nm);
+        std::iota(byState.begin(), byState.end(), 0u);
+        std::stable_sort(byState.begin(), byState.end(), [&](uint32_t a, uint32_t b) {
+            const Material& x = materials[a];
+            const Material& y = materials[b];
+            if (x.diffuseMap != y.diffuseMap) return x.diffuseMap < y.diffuseMap;
+            if (!std::equal(x.diffuse, x.diffuse + 3, y.diffuse))
+                return std::lexicographical_compare(x.diffuse, x.diffuse + 3, y.diffuse, y.diffuse + 3);
+            return x.name < y.name;
+        });
+        for (size_t r = 0; r < nm; r++) rank[byState[r]] = (uint32_t)r;
+    }
+
+    // сортировка подсчётом по рангу материала - устойчива, порядок внутри батча исходный
+    std::vector<uint32_t> start(nm + 1, 0);
+    for (uint32_t m : faceMaterial) start[rank[m] + 1]++;
+    for (size_t r = 0; r < nm; r++) start[r + 1] += start[r];
+
+    std::vector<uint32_t> fill(start.begin(), start.end() - 1);
+    order.resize(faceMaterial.size());
+    for (size_t f = 0; f < faceMaterial.size(); f++) order[fill[rank[faceMaterial[f]]]++] = (uint32_t)f;
+
+    std::vector<Batch> batches;
+    std::vector<uint32_t> byRank(nm);
+    for (size_t m = 0; m < nm; m++) byRank[rank[m]] = (uint32_t)m;
+    for (size_t r = 0; r < nm; r++)
+        if (start[r + 1] > start[r]) batches.push_back({ byRank[r], start[r], start[r + 1] - start[r] });
+    return batches;
+}
+
+} // namespace objmat
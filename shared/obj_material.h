@@ -0,0 +1,66 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Материалы OBJ (mtllib/usemtl) и группировка треугольников по материалам, общие для CG3 и CG4.
+// Загрузчики запоминают только имена; свойства читаются из .mtl при каждой загрузке,
+// поэтому правка .mtl видна и при чтении меша из кэша.
+namespace objmat {
+
+struct Material {
+    std::string name;
+    float ambient[3]  = { 0.f, 0.f, 0.f };     // Ka
+    float diffuse[3]  = { .8f, .8f, .8f };     // Kd
+    float specular[3] = { 0.f, 0.f, 0.f };     // Ks
+    float shininess = 0.f;                      // Ns
+    float opacity = 1.f;                        // d или 1 - Tr
+    std::string diffuseMap;                     // map_Kd, путь относительно OBJ
+};
+
+// подряд идущие треугольники одного материала
+struct Batch {
+    uint32_t material = 0;
+    uint32_t first = 0;     // в треугольниках
+    uint32_t count = 0;
+};
+
+// mtllib и usemtl в порядке появления; номер материала - номер имени в names
+struct Usage {
+    std::vector<std::string> libs;
+    std::vector<std::string> names;
+
+    void add_lib(std::string_view file);
+    uint32_t use(std::string_view name);
+    bool empty() const { return names.empty(); }
+
+    // строки "mtllib x" / "usemtl y" - для потока Materials кэша
+    std::string serialize() const;
+    static Usage parse(std::string_view text);
+};
+
+// дописывает материалы из .mtl; false - файл не открылся
+bool load_mtl(const std::filesystem::path& path, std::vector<Material>& out);
+
+// Материалы по именам из usage, файлы .mtl ищутся рядом с OBJ.
+// Имя без описания получает свойства по умолчанию.
+std::vector<Material> resolve(const std::filesystem::path& objPath, const Usage& usage);
+
+// Стабильная группировка: order[i] - исходный номер треугольника на месте i.
+// Батчи упорядочены по (map_Kd, Kd, имя), одинаковое состояние идёт подряд.
+std::vector<Batch> group_faces(const std::vector<uint32_t>& faceMaterial,
+                               const std::vector<Material>& materials, std::vector<uint32_t>& order);
+
+// переставляет тройки индексов по order из group_faces
+template <class T>
+void reorder_faces(std::vector<T>& idx, const std::vector<uint32_t>& order) {
+    std::vector<T> out(idx.size());
+    for (size_t i = 0; i < order.size(); i++)
+        for (int c = 0; c < 3; c++) out[i*3 + c] = idx[(size_t)order[i]*3 + c];
+    idx.swap(out);
+}
+
+} // namespace objmat
@@ -0,0 +1,67 @@
+#pragma once
+#include <charconv>
+#include <cstring>
+#include <cstddef>
+
+// Разбор OBJ прямо по буферу файла: без временных строк, потоков и sscanf. Общий для CG3 и CG4.
+namespace obj {
+
+inline const char* skip_ws(const char* p, const char* e) {
+    while (p < e && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+    return p;
+}
+
+inline const char* line_end(const char* p, const char* e) {
+    const char* n = (const char*)std::memchr(p, '\n', (size_t)(e - p));
+    return n ? n : e;
+}
+
+// тег строки ("v", "vt", "f", ...) - p сдвигается за тег
+inline bool tag(const char*& p, const char* e, const char* t) {
+    size_t n = std::strlen(t);
+    if ((size_t)(e - p) < n || std::memcmp(p, t, n) != 0) return false;
+    if (p + n < e && p[n] != ' ' && p[n] != '\t') return false;
+    p += n;
+    return true;
+}
+
+inline bool parse_float(const char*& p, const char* e, float& out) {
+    p = skip_ws(p, e);
+    if (p < e && *p == '+') p++;
+    auto r = std::from_chars(p, e, out);
+    if (r.ec != std::errc()) return false;
+    p = r.ptr;
+    return true;
+}
+
+inline bool parse_int(const char*& p, const char* e, long& out) {
+    if (p < e && *p == '+') p++;
+    auto r = std::from_chars(p, e, out);
+    if (r.ec != std::errc()) return false;
+    p = r.ptr;
+    return true;
+}
+
+// угол грани: v, v/vt, v//vn, v/vt/vn; отсутствующие индексы = 0
+inline bool parse_corner(const char*& p, const char* e, long& v, long& vt, long& vn) {
+    v = vt = vn = 0;
+    p = skip_ws(p, e);
+    if (!parse_int(p, e, v)) return false;
+    if (p < e && *p == '/') {
+        p++;
+        if (p < e && *p != '/') parse_int(p, e, vt);
+        if (p < e && *p == '/') { p++; parse_int(p, e, vn); }
+    }
+    // мусор в токене пропускаем до пробела
+    while (p < e && *p != ' ' && *p != '\t' && *p != '\r') p++;
+    return true;
+}
+
+// 1-based или отрицательный (от конца) индекс -> 0-based, -1 если индекса нет
+inline int fix_index(long idx, size_t count) {
+    if (idx > 0) return (int)(idx - 1);
+    if (idx < 0) return (int)((long)count + idx);
+    return -1;
+}
+
+} // namespace obj
@@ -0,0 +1,158 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Параллельные шаги, общие для CG3 и CG4: запуск потоков на время шага и дедупликация
+// углов граней (CG3 index_mesh, CG4 ParseObj) с номерами по первому вхождению.
+namespace parallel {
+
+// fn(t) для t = 0..threads-1; поток 0 - вызывающий
+template <class Fn>
+void run_threads(int threads, Fn fn) {
+    std::vector<std::thread> pool;
+    for (int t=1; t<threads; t++) pool.emplace_back(fn, t);
+    fn(0);
+    for (auto& th : pool) th.join();
+}
+
+// номер части угла хранится в байте
+constexpr int kMaxDedupThreads = 64;
+
+struct Dedup {
+    std::vector<uint32_t> index;    // на угол: номер вершины; пропущенный угол - 0
+    std::vector<size_t>   first;    // на вершину: её первый угол, по возрастанию
+};
+
+namespace detail {
+
+// ключ и номер в одной ячейке, линейное пробирование, без удаления
+template <class Key>
+class FlatTable {
+public:
+    explicit FlatTable(size_t expected) {
+        size_t cap = 16;
+        while (cap < expected * 2) cap <<= 1;
+        slots_.assign(cap, Slot{});
+        mask_ = cap - 1;
+    }
+
+    // номер найденного ключа или newId, если ключ новый
+    uint32_t find_or_insert(const Key& key, uint64_t h, uint32_t newId) {
+        for (size_t i = (size_t)h & mask_; ; i = (i + 1) & mask_) {
+            Slot& s = slots_[i];
+            if (s.id == UINT32_MAX) { s = Slot{ key, newId }; return newId; }
+            if (s.key == key) return s.id;
+        }
+    }
+
+private:
+    struct Slot { Key key{}; uint32_t id = UINT32_MAX; };
+    std::vector<Slot> slots_;
+    size_t mask_ = 0;
+};
+
+} // namespace detail
+
+// Параллельная дедупликация count углов: старшие биты хэша выбирают часть, у каждого потока
+// своя плоская таблица. Углы раскладываются по частям (часть - подряд, внутри неё куски по
+// порядку), поэтому поток видит только свои углы и в порядке углов. Номер вершины - число
+// первых вхождений до угла, как у последовательного обхода, и от числа потоков не зависит.
+// key(c) - ключ угла (сравнивается через ==), hash(c) - его 64-битный хэш,
+// skip(c) - угол без вершины. threads - от 1 до kMaxDedupThreads.
+template <class KeyFn, class HashFn, class SkipFn>
+Dedup dedup(size_t count, int threads, KeyFn key, HashFn hash, SkipFn skip) {
+    using Key = std::decay_t<decltype(key(size_t{}))>;
+    constexpr uint8_t kSkip = 0xFF;
+    const size_t C = count;
+    threads = threads < 1 ? 1 : threads > kMaxDedupThreads ? kMaxDedupThreads : threads;
+    const size_t T = (size_t)threads;
+    auto chunk = [&](int t, size_t& b, size_t& e) {
+        b = C * t / T;
+        e = C * (t+1) / T;
+    };
+
+    // 1. хэш и часть каждого угла, число углов каждой части в каждом куске
+    std::vector<uint64_t> h(C);
+    std::vector<uint8_t> part(C);
+    std::vector<size_t> bucketOffset(T * T, 0);     // [кусок][часть]
+    run_threads(threads, [&](int t) {
+        size_t b, e; chunk(t, b, e);
+        size_t* cnt = &bucketOffset[t * T];
+        for (size_t c=b; c<e; c++) {
+            if (skip(c)) { part[c] = kSkip; continue; }
+            h[c] = hash(c);
+            part[c] = (uint8_t)((h[c] >> 40) % T);
+            cnt[part[c]]++;
+        }
+    });
+
+    // 2. углы по частям
+    std::vector<size_t> partBegin(T + 1, 0);
+    size_t bucketed = 0;
+    for (size_t p=0; p<T; p++) {
+        partBegin[p] = bucketed;
+        for (size_t t=0; t<T; t++) {
+            size_t n = bucketOffset[t * T + p];
+            bucketOffset[t * T + p] = bucketed;
+            bucketed += n;
+        }
+    }
+    partBegin[T] = bucketed;
+    std::vector<size_t> bucket(bucketed);
+    run_threads(threads, [&](int t) {
+        size_t b, e; chunk(t, b, e);
+        size_t* offset = &bucketOffset[t * T];
+        for (size_t c=b; c<e; c++)
+            if (part[c] != kSkip) bucket[offset[part[c]]++] = c;
+    });
+
+    // 3. каждый поток дедуплицирует свою часть в порядке углов
+    std::vector<uint32_t> local(C);
+    std::vector<uint8_t> isFirst(C, 0);
+    std::vector<std::vector<size_t>> firsts(T);
+    run_threads(threads, [&](int t) {
+        detail::FlatTable<Key> table(partBegin[t+1] - partBegin[t]);
+        std::vector<size_t>& fc = firsts[t];
+        for (size_t i=partBegin[t]; i<partBegin[t+1]; i++) {
+            size_t c = bucket[i];
+            uint32_t id = table.find_or_insert(key(c), h[c], (uint32_t)fc.size());
+            if (id == fc.size()) { fc.push_back(c); isFirst[c] = 1; }
+            local[c] = id;
+        }
+    });
+
+    // 4. номер вершины = число первых вхождений до угла (префиксная сумма по кускам)
+    std::vector<uint32_t> rank(C);
+    std::vector<size_t> chunkBase(T + 1, 0);
+    run_threads(threads, [&](int t) {
+        size_t b, e; chunk(t, b, e);
+        size_t s = 0;
+        for (size_t c=b; c<e; c++) s += isFirst[c];
+        chunkBase[t+1] = s;
+    });
+    for (size_t t=0; t<T; t++) chunkBase[t+1] += chunkBase[t];
+    run_threads(threads, [&](int t) {
+        size_t b, e; chunk(t, b, e);
+        uint32_t s = (uint32_t)chunkBase[t];
+        for (size_t c=b; c<e; c++) { rank[c] = s; s += isFirst[c]; }
+    });
+
+    // 5. первые углы вершин и номера всех углов
+    Dedup out;
+    out.first.resize(chunkBase[T]);
+    out.index.resize(C);
+    run_threads(threads, [&](int t) {
+        for (size_t c : firsts[t]) out.first[rank[c]] = c;
+    });
+    run_threads(threads, [&](int t) {
+        size_t b, e; chunk(t, b, e);
+        for (size_t c=b; c<e; c++)
+            out.index[c] = part[c] == kSkip ? 0 : rank[firsts[part[c]][local[c]]];
+    });
+    return out;
+}
+
+} // namespace parallel